@@ -1,5 +1,6 @@
 #include "ais_contact.h"
 #include "backgroundraster.h"
+#include "gz4d_geo.h"
 #include <QPainter>
 
 AISContactDetails::AISContactDetails()
@@ -25,8 +26,7 @@ AISContactState::AISContactState()
 AISContactState::AISContactState(const marine_msgs::Contact::ConstPtr& message)
 {
   timestamp = message->header.stamp;
-  location.location.setLatitude(message->position.latitude);
-  location.location.setLongitude(message->position.longitude);
+  location.location = GeoPoint(message->position.latitude, message->position.longitude);
   if(message->heading < 0)
     heading = message->cog*180.0/M_PI;
   else
@@ -66,10 +66,57 @@ AISContact::~AISContact()
 
 }
 
-void AISContact::updateView()
+namespace
 {
-  prepareGeometryChange();
-  m_displayTime = ros::Time::now();
+  // Seconds of history drawn behind a contact.
+  const double historyLength = 300.0;
+
+  // Slower contacts are drawn where they were reported.
+  const float movingSpeed = 0.05;
+}
+
+void AISContact::shownStates(ros::Time const &displayTime, ros::Time &first, ros::Time &last) const
+{
+  first = last = ros::Time();
+  auto begin = m_states.lower_bound(displayTime - ros::Duration(historyLength));
+  auto end = m_states.upper_bound(displayTime);
+  if(begin == end)
+    return;
+  first = begin->first;
+  last = (--end)->first;
+}
+
+bool AISContact::needsUpdate(ros::Time const &displayTime) const
+{
+  if(m_dirty)
+    return true;
+  ros::Time first, last;
+  shownStates(displayTime, first, last);
+  if(first != m_firstShown || last != m_lastShown)
+    return true;
+  return !last.isZero() && m_states.at(last).sog > movingSpeed;
+}
+
+void AISContact::updateView(ros::Time const &displayTime)
+{
+  m_displayTime = displayTime;
+  m_dirty = false;
+  shownStates(displayTime, m_firstShown, m_lastShown);
+
+  QPainterPath shape = buildShape();
+  QPainterPath prediction = buildPredictionShape();
+  if(shape == m_shape && prediction == m_predictionShape)
+    return;
+  QRectF bounds;
+  if(!shape.isEmpty() || !prediction.isEmpty())
+    bounds = (shape.boundingRect()|prediction.boundingRect()).marginsAdded(QMarginsF(2,2,2,2));
+  if(bounds != m_bounds)
+  {
+    prepareGeometryChange();
+    m_bounds = bounds;
+  }
+  m_shape.swap(shape);
+  m_predictionShape.swap(prediction);
   update();
 }
 
@@ -90,6 +137,7 @@ void AISContact::newReport(AISReport *report)
     m_states[report->timestamp].location.pos = geoToPixel(report->location.location, bg);
     setLabelPosition(m_states[report->timestamp].location.pos);
   }
+  m_dirty = true;
 }
 
 void AISContact::updateLabel()
@@ -117,11 +165,12 @@ void AISContact::updateProjectedPoints()
     s.second.location.pos = geoToPixel(s.second.location.location, bg);
   if (!m_states.empty())
     setLabelPosition(m_states.rbegin()->second.location.pos);
+  m_dirty = true;
 }
 
 QRectF AISContact::boundingRect() const
 {
-  return (shape().boundingRect()|predictionShape().boundingRect()).marginsAdded(QMargins(2,2,2,2));
+  return m_bounds;
 }
 
 void AISContact::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
@@ -133,24 +182,34 @@ void AISContact::paint(QPainter* painter, const QStyleOptionGraphicsItem* option
   p.setColor(Qt::blue);
   p.setWidth(2);
   painter->setPen(p);
-  painter->drawPath(shape());
+  painter->drawPath(m_shape);
 
   p.setColor(QColor(128, 128, 128, 128));
   
   painter->setPen(p);
-  painter->drawPath(predictionShape());
+  painter->drawPath(m_predictionShape);
 
   painter->restore();
 }
 
 QPainterPath AISContact::shape() const
+{
+  return m_shape;
+}
+
+QPainterPath AISContact::predictionShape() const
+{
+  return m_predictionShape;
+}
+
+QPainterPath AISContact::buildShape() const
 {
   QPainterPath ret;
   // History length should be configurable and displayTime could be set
   // somwhere else to support rewinding time
   if(!m_displayTime.isZero())
   {
-    ros::Time historyStartTime = m_displayTime - ros::Duration(300);
+    ros::Time historyStartTime = m_displayTime - ros::Duration(historyLength);
 
     auto state = m_states.lower_bound(historyStartTime);
     if(state != m_states.end() && state->first <= m_displayTime)
@@ -189,7 +248,7 @@ QPainterPath AISContact::shape() const
   return ret;
 }
 
-QPainterPath AISContact::predictionShape() const
+QPainterPath AISContact::buildPredictionShape() const
 {
   QPainterPath ret;
   if(!m_displayTime.isZero())
@@ -200,9 +259,13 @@ QPainterPath AISContact::predictionShape() const
     if(state != m_states.rend())
     {
       ret.moveTo(state->second.location.pos);
-      QGeoCoordinate futureLocation = state->second.location.location.atDistanceAndAzimuth(state->second.sog*300, state->second.cog);
       ros::Duration timeSinceReport = m_displayTime - state->first;
-      QGeoCoordinate predicatedLocation = state->second.location.location.atDistanceAndAzimuth(state->second.sog*timeSinceReport.toSec(), state->second.cog);
+      double azimuths[2] = {state->second.cog, state->second.cog};
+      double distances[2] = {state->second.sog*300, state->second.sog*timeSinceReport.toSec()};
+      double latitudes[2], longitudes[2];
+      gz4d::LocalTangent(state->second.location.location.latitude(), state->second.location.location.longitude()).direct(azimuths, distances, latitudes, longitudes, 2);
+      GeoPoint futureLocation(latitudes[0], longitudes[0]);
+      GeoPoint predicatedLocation(latitudes[1], longitudes[1]);
       BackgroundRaster* bg = findParentBackgroundRaster();
       if(bg)
       {
@@ -56,9 +56,16 @@ public:
 
   void newReport(AISReport* report);
 
+  // True if the shapes drawn at displayTime would differ from the cached
+  // ones: a report or reprojection since the last update, a prediction
+  // still moving, or reports entering or leaving the history shown.
+  bool needsUpdate(ros::Time const &displayTime) const;
+  // Rebuilds the cached shapes for displayTime. The scene is only told of
+  // a geometry change if the bounds moved.
+  void updateView(ros::Time const &displayTime);
+
 public slots:
   void updateProjectedPoints();
-  void updateView();
 
 protected:
   void hoverEnterEvent(QGraphicsSceneHoverEvent * event) override;
@@ -66,9 +73,20 @@ protected:
 
 private:
   void updateLabel();
+  QPainterPath buildShape() const;
+  QPainterPath buildPredictionShape() const;
+  // Oldest and newest reports shown at displayTime, null if none.
+  void shownStates(ros::Time const &displayTime, ros::Time &first, ros::Time &last) const;
   
   std::map<ros::Time, AISContactState> m_states;
   ros::Time m_displayTime;
+
+  QPainterPath m_shape;
+  QPainterPath m_predictionShape;
+  QRectF m_bounds;
+  bool m_dirty = true;
+  ros::Time m_firstShown;
+  ros::Time m_lastShown;
 };
 
 #endif
\ No newline at end of file
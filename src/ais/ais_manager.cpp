@@ -2,6 +2,13 @@
 #include "ui_ais_manager.h"
 #include <QTimer>
 #include "backgroundraster.h"
+#include <cmath>
+
+namespace
+{
+  // Side of the grid's cells, in background pixels.
+  const double gridCellSize = 512.0;
+}
 
 AISManager::AISManager(QWidget* parent):
   QWidget(parent),
@@ -16,6 +23,7 @@ AISManager::AISManager(QWidget* parent):
   m_scan_timer->start(1000);
 
   m_update_timer = new QTimer(this);
+  connect(m_update_timer, &QTimer::timeout, this, &AISManager::updateContacts);
   m_update_timer->start(200);
 }
 
@@ -57,24 +65,114 @@ void AISManager::addAisReport(AISReport* report)
   if(m_contacts.find(report->mmsi) == m_contacts.end())
   {
     m_contacts[report->mmsi] = new AISContact(report, this, m_background);
-    connect(m_update_timer, &QTimer::timeout, m_contacts[report->mmsi], &AISContact::updateView);
     m_ui->contactListWidget->addItem(QString::number(report->mmsi));
   }
   m_contacts[report->mmsi]->newReport(report);
+  m_changed.insert(report->mmsi);
+}
+
+void AISManager::updateContacts()
+{
+  ros::Time now = ros::Time::now();
+
+  // Changed contacts are always redrawn, so they are filed under the right
+  // cells. Those in view are redrawn when their shapes would change, or
+  // all of them after a pan or zoom, as symbols are sized to the scale.
+  std::set<uint32_t> due;
+  due.swap(m_changed);
+  for(auto mmsi: visibleContacts())
+    if(m_viewport_changed || m_contacts[mmsi]->needsUpdate(now))
+      due.insert(mmsi);
+  m_viewport_changed = false;
+
+  for(auto mmsi: due)
+  {
+    m_contacts[mmsi]->updateView(now);
+    index(mmsi);
+  }
+}
+
+void AISManager::index(uint32_t mmsi)
+{
+  AISContact *contact = m_contacts[mmsi];
+  QRectF bounds = contact->mapRectToParent(contact->boundingRect());
+  QRect cells;
+  if(!bounds.isNull())
+    cells = QRect(QPoint(std::floor(bounds.left()/gridCellSize), std::floor(bounds.top()/gridCellSize)), QPoint(std::floor(bounds.right()/gridCellSize), std::floor(bounds.bottom()/gridCellSize)));
+
+  auto filed = m_contact_cells.find(mmsi);
+  if(filed != m_contact_cells.end())
+  {
+    if(filed->second == cells)
+      return;
+    for(int x = filed->second.left(); x <= filed->second.right(); x++)
+      for(int y = filed->second.top(); y <= filed->second.bottom(); y++)
+      {
+        auto cell = m_grid.find(GridKey(x, y));
+        cell->second.erase(mmsi);
+        if(cell->second.empty())
+          m_grid.erase(cell);
+      }
+    m_contact_cells.erase(filed);
+  }
+  if(cells.isNull())
+    return;
+  for(int x = cells.left(); x <= cells.right(); x++)
+    for(int y = cells.top(); y <= cells.bottom(); y++)
+      m_grid[GridKey(x, y)].insert(mmsi);
+  m_contact_cells[mmsi] = cells;
+}
+
+std::set<uint32_t> AISManager::visibleContacts() const
+{
+  std::set<uint32_t> ret;
+  if(m_viewport.isNull() || !m_background)
+  {
+    // Nothing to cull against yet.
+    for(auto const &c: m_contacts)
+      ret.insert(c.first);
+    return ret;
+  }
+  QRectF view = m_background->mapRectFromScene(m_viewport);
+  int left = std::floor(view.left()/gridCellSize);
+  int right = std::floor(view.right()/gridCellSize);
+  int top = std::floor(view.top()/gridCellSize);
+  int bottom = std::floor(view.bottom()/gridCellSize);
+  // Zoomed far out, walking the grid beats walking its cells.
+  if(double(right-left+1)*(bottom-top+1) > m_grid.size())
+  {
+    for(auto const &cell: m_grid)
+      if(cell.first.first >= left && cell.first.first <= right && cell.first.second >= top && cell.first.second <= bottom)
+        ret.insert(cell.second.begin(), cell.second.end());
+    return ret;
+  }
+  for(int x = left; x <= right; x++)
+    for(int y = top; y <= bottom; y++)
+    {
+      auto cell = m_grid.find(GridKey(x, y));
+      if(cell != m_grid.end())
+        ret.insert(cell->second.begin(), cell->second.end());
+    }
+  return ret;
 }
 
 void AISManager::updateBackground(BackgroundRaster * bg)
 {
   m_background = bg;
+  // Bounds are in the old background's pixels, everything is filed again.
+  m_grid.clear();
+  m_contact_cells.clear();
   for(auto c: m_contacts)
   {
     c.second->setParentItem(bg);
     c.second->updateProjectedPoints();
+    m_changed.insert(c.first);
   }
 
 }
 
 void AISManager::updateViewport(QPointF ll, QPointF ur)
 {
-  //ROS_INFO_STREAM( "viewport: " << ll.x() << ", " << ll.y() << " - " << ur.x() << ", " << ur.y());
+  m_viewport = QRectF(ll, ur).normalized();
+  m_viewport_changed = true;
 }
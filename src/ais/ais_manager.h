@@ -1,6 +1,8 @@
 #ifndef CAMP_AIS_MANAGER_H
 #define CAMP_AIS_MANAGER_H
 
+#include <set>
+#include <QRect>
 #include <QWidget>
 #include "ros/ros.h"
 #include "marine_msgs/Contact.h"
@@ -13,6 +15,10 @@ class AISManager;
 
 class BackgroundRaster;
 
+// Follows AIS contacts from every marine_msgs/Contact topic. Contacts are
+// redrawn in one pass per update period, which only visits those with new
+// reports and those near the viewport, found through a grid of the
+// background's pixels.
 class AISManager: public QWidget
 {
   Q_OBJECT
@@ -31,9 +37,16 @@ public slots:
 private slots:
   void scanForSources();
   void addAisReport(AISReport *report);
+  void updateContacts();
 
 private:
+  typedef std::pair<int,int> GridKey;
+
   void contactCallback(const marine_msgs::Contact::ConstPtr& message);
+  // Files a contact under the grid cells its bounds cover.
+  void index(uint32_t mmsi);
+  // Contacts filed under the cells the viewport covers.
+  std::set<uint32_t> visibleContacts() const;
 
   Ui::AISManager* m_ui;
   std::map<std::string, ros::Subscriber> m_sources;
@@ -41,6 +54,16 @@ private:
   QTimer* m_update_timer;
   std::map<uint32_t, AISContact*> m_contacts;
 
+  std::map<GridKey, std::set<uint32_t> > m_grid;
+  // range of cells each contact is filed under
+  std::map<uint32_t, QRect> m_contact_cells;
+  // contacts with reports or projections not drawn yet
+  std::set<uint32_t> m_changed;
+
+  // scene area shown, null until the view reports it
+  QRectF m_viewport;
+  bool m_viewport_changed = false;
+
   BackgroundRaster* m_background = nullptr;
 };
 
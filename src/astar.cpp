@@ -106,7 +106,7 @@ double  AStar::extendedPathAverageDepth(Context const &c, Position const& positi
     // If the node is a Moore Neighboor, check the cell on either side of desired cell
     {
         // If either cell next to the desired cell is an obstacle, the path is not valid
-        if ((c.map->getDepth(position.x,newPosition.y) < c.minDepth) || (c.map->getDepth(newPosition.x,position.y) < c.minDepth))
+        if (c.isObstacle(position.x,newPosition.y) || c.isObstacle(newPosition.x,position.y))
             return 0.0; // Path is invalid)
         return c.map->getDepth(newPosition.x,newPosition.y);
     }
@@ -144,7 +144,7 @@ double  AStar::extendedPathAverageDepth(Context const &c, Position const& positi
                 int ceil_x = int(ceil(x));
 
                 // If either cell is an obstacle, the path is not valid
-                if ( c.map->getDepth(floor_x,y) < c.minDepth || c.map->getDepth(ceil_x,y) < c.minDepth)
+                if ( c.isObstacle(floor_x,y) || c.isObstacle(ceil_x,y))
                 {
                     return 0.0; // Path is invalid
                 }
@@ -171,7 +171,7 @@ double  AStar::extendedPathAverageDepth(Context const &c, Position const& positi
                 //  is an obstacle, the path is not valid
                 int floor_y = int(floor(y));
                 int ceil_y = int(ceil(y));
-                if ( c.map->getDepth(x,floor_y) < c.minDepth || c.map->getDepth(x,ceil_y) < c.minDepth)
+                if ( c.isObstacle(x,floor_y) || c.isObstacle(x,ceil_y))
                 {
                     return 0.0; // Path is invalid
                 }
@@ -229,7 +229,7 @@ std::vector<Position> AStar::search(Context const &c)
                 Position newPosition = position + candidate;
                 // Place the node in the frontier if the neighbor is within the
                 //  map dimensions, not an obstacle, and not closed.
-                if(newPosition.isWithinBounds(*c.map) && c.map->getDepth(newPosition.x, newPosition.y) > c.minDepth && nodeMap.find(newPosition) == nodeMap.end())
+                if(newPosition.isWithinBounds(*c.map) && c.map->getDepth(newPosition.x, newPosition.y) > c.minDepth && c.map->getCost(newPosition.x, newPosition.y) < c.blockingCost && nodeMap.find(newPosition) == nodeMap.end())
                 {
                     // Check to see if the extended path goes through obstacles
                     // Also calculate the average depth from the parent node to this
@@ -61,12 +61,21 @@ bool operator<(const Position &lhs, const Position &rhs);
 
 struct Context
 {
-    Context():depthWeightValue(0.11)
+    Context():depthWeightValue(0.11),costWeightValue(20.0),blockingCost(0.8)
     {}
     
+    // Cells too shallow, or too costly to cross according to the map's
+    // cost overlay, are obstacles.
+    bool isObstacle(int x, int y) const
+    {
+        return map->getDepth(x,y) < minDepth || map->getCost(x,y) >= blockingCost;
+    }
+    
     BackgroundRaster *map;
     Position start, finish;
     float depthWeightValue;
+    float costWeightValue;
+    float blockingCost;
     double shipDraft;
     double maxDepth;
     double minDepth;
@@ -84,16 +93,17 @@ The cost for each node can be determined with 3 different methods:
 class Node
 {
 public:
-    Node():m_G(0),m_H(0),m_depth(0)
+    Node():m_G(0),m_H(0),m_depth(0),m_cost(0)
     {
     }
             
-    Node(Context const &c, Position position, double depth, Node const &parent) :m_position(position), m_parentPosition(parent.m_position), m_depth(depth)
+    Node(Context const &c, Position position, double depth, Node const &parent) :m_position(position), m_parentPosition(parent.m_position), m_depth(depth), m_cost(c.map->getCost(position.x, position.y))
     {
         // Calculate the total cost, g, due to a move to this node, as the sum of the
         // cost to get to the parent node, plus the distance to
-        // the node and the cost assocated with the average depth to the node.
-        m_G = parent.G() + position.distanceFrom(m_parentPosition) + (1 + depthCostfraction(c));
+        // the node and the cost assocated with the average depth to the node
+        // and with obstacles near it.
+        m_G = parent.G() + position.distanceFrom(m_parentPosition) + (1 + depthCostfraction(c)) + c.costWeightValue*m_cost;
         
         // Estimate the remaining cost to go to the destination (heuristic - straight line distance)
         m_H = position.distanceFrom(c.finish);
@@ -103,7 +113,7 @@ public:
     
     bool updateParent(Context const &c, Node const & potentialNewParent)
     {
-        double potentialNewG = potentialNewParent.G() + m_position.distanceFrom(potentialNewParent.getPosition()) + (1 + depthCostfraction(c));
+        double potentialNewG = potentialNewParent.G() + m_position.distanceFrom(potentialNewParent.getPosition()) + (1 + depthCostfraction(c)) + c.costWeightValue*m_cost;
         if(potentialNewG < m_G)
         {
             m_parentPosition = potentialNewParent.getPosition();
@@ -140,6 +150,7 @@ private:
     double m_G, m_H;
     
     double m_depth;
+    double m_cost;
 };
 
 /* --------------------------------------------------------------------------
@@ -27,6 +27,7 @@
 #include "behavior.h"
 
 #include "roslink.h"
+#include "lineordering.h"
 
 #include <iostream>
 #include <sstream>
@@ -48,6 +49,8 @@ AutonomousVehicleProject::AutonomousVehicleProject(QObject *parent) : QAbstractI
     connect(this,&AutonomousVehicleProject::selectRadarColor,m_ROSLink, &ROSLink::selectRadarColor);
     connect(this,&AutonomousVehicleProject::showTail,m_ROSLink, &ROSLink::showTail);
     connect(this,&AutonomousVehicleProject::followRobot,m_ROSLink, &ROSLink::followRobot);
+    connect(this,&AutonomousVehicleProject::mapScaleUpdated,m_ROSLink, &ROSLink::updateMapScale);
+    connect(this,&AutonomousVehicleProject::currentPlaformUpdated,this,&AutonomousVehicleProject::updateETELabels);
 }
 
 AutonomousVehicleProject::~AutonomousVehicleProject()
@@ -288,7 +291,6 @@ SurveyPattern * AutonomousVehicleProject::createSurveyPattern(MissionItem* paren
         sp = potentialParentItemFor("SurveyPattern")->createMissionItem<SurveyPattern>(label, row);
     else
         sp = parent->createMissionItem<SurveyPattern>(label, row);
-    connect(this,&AutonomousVehicleProject::currentPlaformUpdated,sp,&GeoGraphicsMissionItem::onCurrentPlatformUpdated);
     connect(this,&AutonomousVehicleProject::updatingBackground,sp,&SurveyPattern::updateBackground);
     emit layoutChanged();
     return sp;
@@ -312,7 +314,6 @@ SurveyArea * AutonomousVehicleProject::createSurveyArea(MissionItem* parent, int
         sa = potentialParentItemFor("SurveyArea")->createMissionItem<SurveyArea>(label, row);
     else
         sa = parent->createMissionItem<SurveyArea>(label, row);
-    connect(this,&AutonomousVehicleProject::currentPlaformUpdated,sa,&GeoGraphicsMissionItem::onCurrentPlatformUpdated);
     return sa;
 }
 
@@ -420,6 +421,8 @@ QJsonDocument AutonomousVehicleProject::generateMissionPlan(const QModelIndex& i
     topLevel["DEFAULT_PARAMETERS"] = defaultParameters;
     QJsonArray navArray;
     item->writeToMissionPlan(navArray);
+    if(m_optimizeLineOrder)
+        lineordering::reorderNavArray(navArray, lineOrderStart());
     topLevel["NAVIGATION"] = navArray;
     plan.setObject(topLevel);
     return plan;
@@ -453,6 +456,8 @@ QJsonDocument AutonomousVehicleProject::generateMissionTask(const QModelIndex& i
     }
     QJsonObject miObject;
     mi->write(miObject);
+    if(m_optimizeLineOrder)
+        lineordering::reorderTask(miObject, lineOrderStart());
     topArray.append(miObject);
     plan.setArray(topArray);
     
@@ -558,8 +563,10 @@ void AutonomousVehicleProject::setCurrent(const QModelIndex &index)
         Platform *p = qobject_cast<Platform*>(m_currentSelected);
         if(p && p != m_currentPlatform)
         {
+            if(m_currentPlatform)
+                disconnect(m_currentPlatform,&Platform::speedChanged,this,&AutonomousVehicleProject::currentPlaformUpdated);
             m_currentPlatform = p;
-            connect(m_currentPlatform,&Platform::speedChanged,[=](){emit currentPlaformUpdated();});
+            connect(m_currentPlatform,&Platform::speedChanged,this,&AutonomousVehicleProject::currentPlaformUpdated);
             emit currentPlaformUpdated();
         }
         Group *g = qobject_cast<Group*>(m_currentSelected);
@@ -848,11 +855,46 @@ ROSLink * AutonomousVehicleProject::rosLink() const
     return m_ROSLink;
 }
 
+void AutonomousVehicleProject::updateETELabels()
+{
+    // One walk of the tree relabels every item from its cached distance.
+    std::vector<MissionItem*> items;
+    items.push_back(m_root);
+    while(!items.empty())
+    {
+        MissionItem *item = items.back();
+        items.pop_back();
+        GeoGraphicsMissionItem *gmi = qobject_cast<GeoGraphicsMissionItem*>(item);
+        if(gmi)
+            gmi->updateETELabel();
+        for(auto child: item->childMissionItems())
+            items.push_back(child);
+    }
+}
+
+bool AutonomousVehicleProject::optimizeLineOrder() const
+{
+    return m_optimizeLineOrder;
+}
+
+void AutonomousVehicleProject::setOptimizeLineOrder(bool optimize)
+{
+    m_optimizeLineOrder = optimize;
+}
+
+QGeoCoordinate AutonomousVehicleProject::lineOrderStart() const
+{
+    if(m_ROSLink)
+        return m_ROSLink->location();
+    return QGeoCoordinate();
+}
+
 void AutonomousVehicleProject::updateMapScale(qreal scale)
 {
     if(m_currentBackground)
         m_currentBackground->updateMapScale(scale);
     m_map_scale = scale;
+    emit mapScaleUpdated(scale);
     
 }
 
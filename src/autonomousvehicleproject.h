@@ -95,6 +95,8 @@ public:
 
     QJsonDocument generateMissionPlan(QModelIndex const &index);
     QJsonDocument generateMissionTask(QModelIndex const &index);
+
+    bool optimizeLineOrder() const;
     
 signals:
     void currentPlaformUpdated();
@@ -105,6 +107,7 @@ signals:
     void selectRadarColor();
     void showTail(bool show);
     void followRobot(bool follow);
+    void mapScaleUpdated(qreal scale);
 
 public slots:
 
@@ -121,6 +124,8 @@ public slots:
     void deleteItem(MissionItem *item);
     void updateMapScale(qreal scale);
     void setContextMode(bool);
+    void setOptimizeLineOrder(bool optimize);
+    void updateETELabels();
 
 
 private:
@@ -138,6 +143,10 @@ private:
 
     bool m_contextMode = false;    
 
+    // Reorder survey lines to reduce transits and turns when generating missions.
+    bool m_optimizeLineOrder = false;
+    QGeoCoordinate lineOrderStart() const;
+
     void setCurrentBackground(BackgroundRaster *bgr);
     QString generateUniqueLabel(std::string const &prefix);
 
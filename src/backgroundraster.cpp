@@ -225,13 +225,55 @@ bool BackgroundRaster::canAcceptChildType(const std::string& childType) const
     return false;
 }
 
+void BackgroundRaster::setDepthOverlay(DepthModel* overlay)
+{
+    if(overlay == m_depth_overlay)
+        return;
+    if(m_depth_overlay)
+    {
+        disconnect(m_depth_overlay, &DepthModel::depthChanged, this, &BackgroundRaster::depthChanged);
+        QRect dropped = m_depth_overlay->bounds();
+        if(!dropped.isNull())
+            emit depthChanged(dropped);
+    }
+    m_depth_overlay = overlay;
+    if(m_depth_overlay)
+        connect(m_depth_overlay, &DepthModel::depthChanged, this, &BackgroundRaster::depthChanged);
+}
+
 float BackgroundRaster::getDepth(int x, int y) const
 {
+    float depth;
+    if(m_depth_overlay && x >= 0 && x < m_width && y >= 0 && y < m_height && m_depth_overlay->depth(x, y, depth))
+        return depth;
     if(depthValid() && x >= 0 && x < m_width && y >= 0 && y < m_height)
         return m_depth_data[y*m_width+x];
     return nan("");
 }
 
+void BackgroundRaster::setCostOverlay(RadarOccupancy* overlay)
+{
+    if(overlay == m_cost_overlay)
+        return;
+    if(m_cost_overlay)
+    {
+        disconnect(m_cost_overlay, &RadarOccupancy::costChanged, this, &BackgroundRaster::costChanged);
+        QRect dropped = m_cost_overlay->bounds();
+        if(!dropped.isNull())
+            emit costChanged(dropped);
+    }
+    m_cost_overlay = overlay;
+    if(m_cost_overlay)
+        connect(m_cost_overlay, &RadarOccupancy::costChanged, this, &BackgroundRaster::costChanged);
+}
+
+float BackgroundRaster::getCost(int x, int y) const
+{
+    if(m_cost_overlay && x >= 0 && x < m_width && y >= 0 && y < m_height)
+        return m_cost_overlay->cost(x, y);
+    return 0.0;
+}
+
 float BackgroundRaster::getDepth(QGeoCoordinate const &location) const
 {
     auto index = geoToPixel(location);
@@ -5,6 +5,9 @@
 #include <QGraphicsItem>
 #include "georeferenced.h"
 #include <QPixmap>
+#include <QPointer>
+#include "depth_model.h"
+#include "radar_occupancy.h"
 
 class QPainter;
 
@@ -33,11 +36,25 @@ public:
     bool valid() const;
     bool depthValid() const;
 
+    // Depths from the overlay, where it has them, take precedence over
+    // the raster's own.
+    void setDepthOverlay(DepthModel *overlay);
     float getDepth(int x, int y) const;
     float getDepth(QGeoCoordinate const &location) const;
+
+    // Extra cost of crossing a pixel, from obstacles the raster doesn't
+    // know about. 0 without a cost overlay.
+    void setCostOverlay(RadarOccupancy *overlay);
+    float getCost(int x, int y) const;
     
     int width() const {return m_width;}
     int height() const {return m_height;}
+signals:
+    // Pixels whose depth changed since the raster was loaded.
+    void depthChanged(QRect const &pixels);
+    // Pixels whose cost changed.
+    void costChanged(QRect const &pixels);
+
 public slots:
     void updateMapScale(qreal scale); 
 
@@ -52,6 +69,8 @@ private:
     int m_width;
     int m_height;
     std::vector<float> m_depth_data;
+    QPointer<DepthModel> m_depth_overlay;
+    QPointer<RadarOccupancy> m_cost_overlay;
 
 };
 
@@ -0,0 +1,241 @@
+#include "coverage_mask.h"
+#include <algorithm>
+#include <cmath>
+#include <QPainter>
+
+namespace
+{
+  int floorDiv(int value, int divisor)
+  {
+    return value >= 0 ? value/divisor : -((-value+divisor-1)/divisor);
+  }
+
+  // Calls span(row, first, last) for each run of cells, first to last
+  // inclusive, whose centers are inside polygon using the nonzero winding
+  // rule. polygon is in cell units, only rows and columns within limit are
+  // visited.
+  template<typename F> void scanPolygon(QPolygonF const &polygon, QRect const &limit, F span)
+  {
+    int n = polygon.size();
+    if(n < 3 || limit.isEmpty())
+      return;
+    std::vector<std::pair<double, int> > crossings;
+    for(int row = limit.top(); row <= limit.bottom(); row++)
+    {
+      double y = row+0.5;
+      crossings.clear();
+      for(int i = 0; i < n; i++)
+      {
+        QPointF const &a = polygon[i];
+        QPointF const &b = polygon[(i+1)%n];
+        int direction = 0;
+        if(a.y() <= y && b.y() > y)
+          direction = 1;
+        else if(b.y() <= y && a.y() > y)
+          direction = -1;
+        if(direction)
+          crossings.push_back(std::make_pair(a.x()+(y-a.y())*(b.x()-a.x())/(b.y()-a.y()), direction));
+      }
+      std::sort(crossings.begin(), crossings.end());
+      int winding = 0;
+      double start = 0.0;
+      for(auto const &c: crossings)
+      {
+        int was = winding;
+        winding += c.second;
+        if(was == 0 && winding != 0)
+          start = c.first;
+        else if(was != 0 && winding == 0)
+        {
+          int first = std::max(limit.left(), int(std::ceil(start-0.5)));
+          int last = std::min(limit.right(), int(std::ceil(c.first-0.5))-1);
+          if(first <= last)
+            span(row, first, last);
+        }
+      }
+    }
+  }
+}
+
+CoverageMask::CoverageMask(double cellSize):m_cellSize(cellSize > 0.0 ? cellSize : 1.0)
+{
+}
+
+void CoverageMask::setCellSize(double cellSize)
+{
+  if(cellSize <= 0.0)
+    cellSize = 1.0;
+  if(cellSize != m_cellSize)
+  {
+    m_cellSize = cellSize;
+    clear();
+  }
+}
+
+double CoverageMask::cellSize() const
+{
+  return m_cellSize;
+}
+
+void CoverageMask::clear()
+{
+  m_tiles.clear();
+  m_bounds = QRect();
+}
+
+bool CoverageMask::empty() const
+{
+  return m_bounds.isNull();
+}
+
+QRect CoverageMask::cellRect(QRectF const &rect) const
+{
+  QRectF cells(rect.topLeft()/m_cellSize, rect.bottomRight()/m_cellSize);
+  cells = cells.normalized();
+  return QRect(QPoint(std::floor(cells.left()), std::floor(cells.top())), QPoint(std::ceil(cells.right()), std::ceil(cells.bottom())));
+}
+
+CoverageMask::Tile &CoverageMask::tile(int column, int row)
+{
+  Tile &t = m_tiles[TileKey(column, row)];
+  if(t.cells.empty())
+    t.cells.resize(TileSize*TileSize, 0);
+  return t;
+}
+
+uint8_t const *CoverageMask::tileCells(int column, int row) const
+{
+  auto t = m_tiles.find(TileKey(column, row));
+  if(t == m_tiles.end())
+    return nullptr;
+  return t->second.cells.data();
+}
+
+QRectF CoverageMask::add(QPolygonF const &polygon, QRectF const &limit)
+{
+  if(polygon.size() < 3)
+    return QRectF();
+  QRect cells = cellRect(polygon.boundingRect());
+  if(limit.isValid())
+    cells &= cellRect(limit);
+  if(cells.isEmpty())
+    return QRectF();
+
+  QPolygonF scaled;
+  scaled.reserve(polygon.size());
+  for(auto const &p: polygon)
+    scaled << p/m_cellSize;
+
+  QRect marked;
+  Tile *current = nullptr;
+  int currentColumn = 0, currentRow = 0;
+  scanPolygon(scaled, cells, [&](int row, int first, int last)
+  {
+    int tileRow = floorDiv(row, TileSize);
+    int y = row-tileRow*TileSize;
+    int x = first;
+    while(x <= last)
+    {
+      int tileColumn = floorDiv(x, TileSize);
+      if(!current || tileColumn != currentColumn || tileRow != currentRow)
+      {
+        current = &tile(tileColumn, tileRow);
+        currentColumn = tileColumn;
+        currentRow = tileRow;
+      }
+      int end = std::min(last, (tileColumn+1)*TileSize-1);
+      uint8_t *cell = current->cells.data()+y*TileSize+(x-tileColumn*TileSize);
+      std::fill(cell, cell+(end-x+1), uint8_t(1));
+      current->imageValid = false;
+      x = end+1;
+    }
+    marked |= QRect(QPoint(first, row), QPoint(last, row));
+  });
+
+  if(marked.isNull())
+    return QRectF();
+  m_bounds |= marked;
+  return QRectF(marked.left()*m_cellSize, marked.top()*m_cellSize, marked.width()*m_cellSize, marked.height()*m_cellSize);
+}
+
+QRectF CoverageMask::bounds() const
+{
+  if(m_bounds.isNull())
+    return QRectF();
+  return QRectF(m_bounds.left()*m_cellSize, m_bounds.top()*m_cellSize, m_bounds.width()*m_cellSize, m_bounds.height()*m_cellSize);
+}
+
+void CoverageMask::paint(QPainter *painter, QRectF const &exposed, QColor const &color) const
+{
+  double tileExtent = TileSize*m_cellSize;
+  QRgb rgb = color.rgba();
+  QRgb premultiplied = qPremultiply(rgb);
+  for(auto const &t: m_tiles)
+  {
+    QRectF target(t.first.first*tileExtent, t.first.second*tileExtent, tileExtent, tileExtent);
+    if(!target.intersects(exposed))
+      continue;
+    Tile const &tile = t.second;
+    if(!tile.imageValid || tile.imageColor != rgb)
+    {
+      if(tile.image.isNull())
+        tile.image = QImage(TileSize, TileSize, QImage::Format_ARGB32_Premultiplied);
+      for(int y = 0; y < TileSize; y++)
+      {
+        QRgb *line = reinterpret_cast<QRgb*>(tile.image.scanLine(y));
+        uint8_t const *cells = tile.cells.data()+y*TileSize;
+        for(int x = 0; x < TileSize; x++)
+          line[x] = cells[x] ? premultiplied : 0;
+      }
+      tile.imageColor = rgb;
+      tile.imageValid = true;
+    }
+    painter->drawImage(target, tile.image);
+  }
+}
+
+CoverageMask::Summary CoverageMask::summarize(QPolygonF const &area) const
+{
+  Summary ret;
+  if(area.size() < 3)
+    return ret;
+  QPolygonF scaled;
+  scaled.reserve(area.size());
+  for(auto const &p: area)
+    scaled << p/m_cellSize;
+  scanPolygon(scaled, cellRect(area.boundingRect()), [&](int row, int first, int last)
+  {
+    int tileRow = floorDiv(row, TileSize);
+    int y = row-tileRow*TileSize;
+    int gapStart = 0;
+    bool inGap = false;
+    for(int x = first; x <= last;)
+    {
+      int tileColumn = floorDiv(x, TileSize);
+      int end = std::min(last, (tileColumn+1)*TileSize-1);
+      uint8_t const *cells = tileCells(tileColumn, tileRow);
+      if(cells)
+        cells += y*TileSize;
+      for(; x <= end; x++)
+      {
+        bool covered = cells && cells[x-tileColumn*TileSize];
+        if(covered)
+          ret.covered++;
+        if(!covered && !inGap)
+        {
+          gapStart = x;
+          inGap = true;
+        }
+        else if(covered && inGap)
+        {
+          ret.gaps.addRect(gapStart*m_cellSize, row*m_cellSize, (x-gapStart)*m_cellSize, m_cellSize);
+          inGap = false;
+        }
+      }
+    }
+    if(inGap)
+      ret.gaps.addRect(gapStart*m_cellSize, row*m_cellSize, (last+1-gapStart)*m_cellSize, m_cellSize);
+    ret.cells += last-first+1;
+  });
+  return ret;
+}
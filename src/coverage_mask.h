@@ -0,0 +1,82 @@
+#ifndef CAMP_COVERAGE_MASK_H
+#define CAMP_COVERAGE_MASK_H
+
+#include <map>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <QColor>
+#include <QImage>
+#include <QPainterPath>
+#include <QPolygonF>
+#include <QRect>
+
+class QPainter;
+
+// Covered area accumulated in a raster of cells, in the layer's coordinates
+// (background pixels). Cells are stored in square tiles allocated on first
+// use, so memory follows the surveyed area rather than the chart's size.
+// Adding a polygon only touches the cells inside a given limit, which lets
+// a growing swath update just its new end. Each tile keeps an image of its
+// covered cells, rebuilt only after the tile changes.
+class CoverageMask
+{
+public:
+  static const int TileSize = 256;
+
+  struct Summary
+  {
+    std::size_t cells = 0;
+    std::size_t covered = 0;
+    // Uncovered cells inside the queried area, in layer units.
+    QPainterPath gaps;
+
+    double fraction() const {return cells ? double(covered)/double(cells) : 0.0;}
+  };
+
+  // cellSize is the side of a cell in layer units.
+  explicit CoverageMask(double cellSize = 1.0);
+
+  // Changing the cell size clears the mask.
+  void setCellSize(double cellSize);
+  double cellSize() const;
+
+  void clear();
+  bool empty() const;
+
+  // Marks the cells whose centers are inside polygon, only within limit if
+  // it is valid. Returns the area of the cells marked, in layer units.
+  QRectF add(QPolygonF const &polygon, QRectF const &limit = QRectF());
+
+  // Area holding covered cells, in layer units.
+  QRectF bounds() const;
+
+  void paint(QPainter *painter, QRectF const &exposed, QColor const &color) const;
+
+  // Covered and total cell counts inside area, with its gaps.
+  Summary summarize(QPolygonF const &area) const;
+
+  std::size_t tileCount() const {return m_tiles.size();}
+
+private:
+  struct Tile
+  {
+    std::vector<uint8_t> cells;
+    mutable QImage image;
+    mutable QRgb imageColor = 0;
+    mutable bool imageValid = false;
+  };
+
+  typedef std::pair<int,int> TileKey;
+
+  QRect cellRect(QRectF const &rect) const;
+  Tile &tile(int column, int row);
+  uint8_t const *tileCells(int column, int row) const;
+
+  double m_cellSize;
+  std::map<TileKey, Tile> m_tiles;
+  // Covered cells, in cell coordinates.
+  QRect m_bounds;
+};
+
+#endif
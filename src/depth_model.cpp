@@ -0,0 +1,242 @@
+#include "depth_model.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <QThread>
+
+namespace
+{
+  int floorDiv(int value, int divisor)
+  {
+    return value >= 0 ? value/divisor : -((-value+divisor-1)/divisor);
+  }
+
+  // Batches waiting beyond this are dropped, oldest first.
+  const std::size_t maximumPending = 64;
+}
+
+void DepthGrid::add(Batch const &batch, QTransform const &mapToPixel, QSize const &rasterSize)
+{
+  TileKey currentKey;
+  Tile *current = nullptr;
+  for(std::size_t i = 0; i < batch.depth.size(); i++)
+  {
+    if(!std::isfinite(batch.depth[i]))
+      continue;
+    QPointF p = mapToPixel.map(QPointF(batch.east[i], batch.north[i]));
+    if(!std::isfinite(p.x()) || !std::isfinite(p.y()))
+      continue;
+    int x = std::floor(p.x());
+    int y = std::floor(p.y());
+    if(x < 0 || y < 0 || x >= rasterSize.width() || y >= rasterSize.height())
+      continue;
+    TileKey key(floorDiv(x, TileSize), floorDiv(y, TileSize));
+    if(!current || key != currentKey)
+    {
+      current = &m_tiles[key];
+      if(current->empty())
+        current->assign(TileSize*TileSize, Cell{0.0f, 0.0f, 0});
+      currentKey = key;
+      m_dirty.insert(key);
+    }
+    double dx = p.x()-x-0.5;
+    double dy = p.y()-y-0.5;
+    float weight = 1.0/(1.0+dx*dx+dy*dy);
+    Cell &cell = (*current)[(y-key.second*TileSize)*TileSize+x-key.first*TileSize];
+    cell.weight += weight;
+    cell.mean += weight*(batch.depth[i]-cell.mean)/cell.weight;
+    cell.count++;
+  }
+}
+
+void DepthGrid::takeChanges(std::map<TileKey, Tile> &changes)
+{
+  for(auto const &key: m_dirty)
+    changes[key] = m_tiles[key];
+  m_dirty.clear();
+}
+
+QRect DepthGrid::apply(std::map<TileKey, Tile> &changes)
+{
+  QRect ret;
+  for(auto &t: changes)
+  {
+    m_tiles[t.first].swap(t.second);
+    ret |= QRect(t.first.first*TileSize, t.first.second*TileSize, TileSize, TileSize);
+  }
+  m_lastTile = nullptr;
+  return ret;
+}
+
+void DepthGrid::clear()
+{
+  m_tiles.clear();
+  m_dirty.clear();
+  m_lastTile = nullptr;
+}
+
+bool DepthGrid::depth(int x, int y, int minimumSoundings, float &depth) const
+{
+  TileKey key(floorDiv(x, TileSize), floorDiv(y, TileSize));
+  // Lookups come in runs over neighbouring cells, planners especially.
+  if(!m_lastTile || key != m_lastKey)
+  {
+    auto t = m_tiles.find(key);
+    if(t == m_tiles.end())
+      return false;
+    m_lastKey = key;
+    m_lastTile = &t->second;
+  }
+  Cell const &cell = (*m_lastTile)[(y-key.second*TileSize)*TileSize+x-key.first*TileSize];
+  if(cell.count < uint32_t(minimumSoundings))
+    return false;
+  depth = cell.mean;
+  return true;
+}
+
+QRect DepthGrid::bounds() const
+{
+  QRect ret;
+  for(auto const &t: m_tiles)
+    ret |= QRect(t.first.first*TileSize, t.first.second*TileSize, TileSize, TileSize);
+  return ret;
+}
+
+DepthModel::DepthModel(QObject *parent):QObject(parent)
+{
+  connect(this, &DepthModel::tilesReady, this, &DepthModel::publish, Qt::QueuedConnection);
+  m_thread = QThread::create(std::bind(&DepthModel::run, this));
+  m_thread->start();
+}
+
+DepthModel::~DepthModel()
+{
+  {
+    QMutexLocker lock(&m_mutex);
+    m_stop = true;
+    m_condition.wakeAll();
+  }
+  m_thread->wait();
+  delete m_thread;
+}
+
+void DepthModel::setMapToPixel(QTransform const &mapToPixel, QSize const &rasterSize)
+{
+  {
+    QMutexLocker lock(&m_mutex);
+    if(m_haveMapToPixel && mapToPixel == m_mapToPixel && rasterSize == m_rasterSize)
+      return;
+    m_mapToPixel = mapToPixel;
+    m_rasterSize = rasterSize;
+    m_haveMapToPixel = true;
+    m_generation++;
+    m_pending.clear();
+    m_ready.clear();
+  }
+  QRect dropped = bounds();
+  m_published.clear();
+  if(!dropped.isNull())
+    emit depthChanged(dropped);
+}
+
+void DepthModel::clearMapToPixel()
+{
+  {
+    QMutexLocker lock(&m_mutex);
+    if(!m_haveMapToPixel)
+      return;
+    m_haveMapToPixel = false;
+    m_generation++;
+    m_pending.clear();
+    m_ready.clear();
+  }
+  QRect dropped = bounds();
+  m_published.clear();
+  if(!dropped.isNull())
+    emit depthChanged(dropped);
+}
+
+void DepthModel::setMinimumSoundings(int count)
+{
+  m_minimumSoundings = std::max(1, count);
+  QRect all = bounds();
+  if(!all.isNull())
+    emit depthChanged(all);
+}
+
+void DepthModel::addSoundings(std::vector<double> east, std::vector<double> north, std::vector<float> depth)
+{
+  QMutexLocker lock(&m_mutex);
+  if(!m_haveMapToPixel)
+    return;
+  if(m_pending.size() >= maximumPending)
+    m_pending.pop_front();
+  m_pending.push_back(DepthGrid::Batch{std::move(east), std::move(north), std::move(depth)});
+  m_condition.wakeOne();
+}
+
+void DepthModel::run()
+{
+  while(true)
+  {
+    std::deque<DepthGrid::Batch> batches;
+    QTransform mapToPixel;
+    QSize rasterSize;
+    uint64_t generation;
+    {
+      QMutexLocker lock(&m_mutex);
+      while(m_pending.empty() && !m_stop)
+        m_condition.wait(&m_mutex);
+      if(m_stop)
+        return;
+      batches.swap(m_pending);
+      mapToPixel = m_mapToPixel;
+      rasterSize = m_rasterSize;
+      generation = m_generation;
+    }
+    if(generation != m_workerGeneration)
+    {
+      m_grid.clear();
+      m_workerGeneration = generation;
+    }
+
+    for(auto const &batch: batches)
+      m_grid.add(batch, mapToPixel, rasterSize);
+
+    std::map<TileKey, Tile> changed;
+    m_grid.takeChanges(changed);
+    if(changed.empty())
+      continue;
+    {
+      QMutexLocker lock(&m_mutex);
+      // The mapping changed while gridding, these cells are stale.
+      if(generation != m_generation)
+        continue;
+      for(auto &t: changed)
+        m_ready[t.first].swap(t.second);
+    }
+    emit tilesReady();
+  }
+}
+
+void DepthModel::publish()
+{
+  std::map<TileKey, Tile> ready;
+  {
+    QMutexLocker lock(&m_mutex);
+    ready.swap(m_ready);
+  }
+  QRect dirty = m_published.apply(ready);
+  if(!dirty.isNull())
+    emit depthChanged(dirty);
+}
+
+bool DepthModel::depth(int x, int y, float &depth) const
+{
+  return m_published.depth(x, y, m_minimumSoundings, depth);
+}
+
+QRect DepthModel::bounds() const
+{
+  return m_published.bounds();
+}
@@ -0,0 +1,140 @@
+#ifndef CAMP_DEPTH_MODEL_H
+#define CAMP_DEPTH_MODEL_H
+
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+#include <cstdint>
+#include <QObject>
+#include <QMutex>
+#include <QRect>
+#include <QSize>
+#include <QTransform>
+#include <QWaitCondition>
+
+class QThread;
+
+// Depths gridded on the cells of a raster, as a running weighted mean per
+// cell in square tiles allocated on first use. Tiles changed since they
+// were last taken are collected for publishing to another grid, the one
+// lookups are served from. Not thread safe.
+class DepthGrid
+{
+public:
+  static const int TileSize = 64;
+
+  struct Cell
+  {
+    float mean;
+    float weight;
+    uint32_t count;
+  };
+
+  typedef std::pair<int,int> TileKey;
+  typedef std::vector<Cell> Tile;
+
+  // Soundings in map frame meters, depths positive down.
+  struct Batch
+  {
+    std::vector<double> east;
+    std::vector<double> north;
+    std::vector<float> depth;
+  };
+
+  // Grids a batch on the cells of a raster of the given size. Soundings
+  // near a cell's center count for more than those near its edges.
+  void add(Batch const &batch, QTransform const &mapToPixel, QSize const &rasterSize);
+  // Copies the tiles changed since they were last taken into changes.
+  void takeChanges(std::map<TileKey, Tile> &changes);
+  // Installs changes taken from another grid, returns the pixels they cover.
+  QRect apply(std::map<TileKey, Tile> &changes);
+  void clear();
+
+  // Mean depth of a raster pixel, false if fewer than minimumSoundings
+  // fell in it.
+  bool depth(int x, int y, int minimumSoundings, float &depth) const;
+  // Area covered by tiles, in raster pixels.
+  QRect bounds() const;
+  std::size_t tileCount() const {return m_tiles.size();}
+
+private:
+  std::map<TileKey, Tile> m_tiles;
+  std::set<TileKey> m_dirty;
+  mutable TileKey m_lastKey;
+  mutable Tile const *m_lastTile = nullptr;
+};
+
+// Depths measured during the mission, gridded on the cells of a depth
+// raster so they can stand in for the raster's own depths. Soundings are
+// queued from any thread and gridded into a DepthGrid on a worker thread.
+// Tiles the worker changed are handed to the GUI thread, where lookups are
+// served without locking, and depthChanged() reports the raster pixels
+// they cover.
+class DepthModel: public QObject
+{
+  Q_OBJECT
+public:
+  static const int TileSize = DepthGrid::TileSize;
+
+  explicit DepthModel(QObject *parent = nullptr);
+  ~DepthModel();
+
+  // Maps map frame coordinates, in meters, to raster pixels, for a raster
+  // of the given size. Changing it drops everything gridded so far.
+  void setMapToPixel(QTransform const &mapToPixel, QSize const &rasterSize);
+  void clearMapToPixel();
+
+  // Cells need this many soundings before their depth is reported.
+  void setMinimumSoundings(int count);
+
+  // Queues soundings in map frame meters, depths positive down. Can be
+  // called from any thread.
+  void addSoundings(std::vector<double> east, std::vector<double> north, std::vector<float> depth);
+
+  // Gridded depth of a raster pixel, false if too few soundings fell in it.
+  // GUI thread only.
+  bool depth(int x, int y, float &depth) const;
+
+  // Bounds of the gridded area, in raster pixels.
+  QRect bounds() const;
+
+signals:
+  // Raster pixels whose depth changed, emitted on the GUI thread.
+  void depthChanged(QRect const &pixels);
+
+  // Emitted by the worker when tiles are ready to publish.
+  void tilesReady();
+
+private slots:
+  void publish();
+
+private:
+  typedef DepthGrid::TileKey TileKey;
+  typedef DepthGrid::Tile Tile;
+
+  void run();
+
+  QThread *m_thread;
+  QMutex m_mutex;
+  QWaitCondition m_condition;
+  bool m_stop = false;
+
+  // guarded by m_mutex
+  std::deque<DepthGrid::Batch> m_pending;
+  QTransform m_mapToPixel;
+  QSize m_rasterSize;
+  bool m_haveMapToPixel = false;
+  uint64_t m_generation = 0;
+  std::map<TileKey, Tile> m_ready;
+
+  // worker only
+  DepthGrid m_grid;
+  uint64_t m_workerGeneration = 0;
+
+  // GUI thread only
+  DepthGrid m_published;
+  int m_minimumSoundings = 3;
+};
+
+#endif
@@ -46,6 +46,28 @@ QPointF GeoGraphicsItem::geoToPixel(const QGeoCoordinate &point, BackgroundRaste
     return QPointF();
 }
 
+QPointF GeoGraphicsItem::geoToPixel(const GeoPoint &point, AutonomousVehicleProject *p) const
+{
+    if(p)
+        return geoToPixel(point, p->getBackgroundRaster());
+    return QPointF();
+}
+
+QPointF GeoGraphicsItem::geoToPixel(const GeoPoint &point, BackgroundRaster *bg) const
+{
+    if(bg)
+    {
+        QPointF ret = bg->geoToPixel(point);
+        QGraphicsItem *pi = parentItem();
+        if(pi)
+        {
+            return ret - pi->scenePos();
+        }
+        return ret;
+    }
+    return QPointF();
+}
+
 void GeoGraphicsItem::prepareGeometryChange()
 {
     QGraphicsItem::prepareGeometryChange();
@@ -3,6 +3,7 @@
 
 #include <QGraphicsItem>
 #include <QGeoCoordinate>
+#include "geopoint.h"
 
 class AutonomousVehicleProject;
 class BackgroundRaster;
@@ -33,6 +34,8 @@ public:
     
     QPointF geoToPixel(QGeoCoordinate const &point, AutonomousVehicleProject *p) const;
     QPointF geoToPixel(QGeoCoordinate const &point, BackgroundRaster *bg) const;
+    QPointF geoToPixel(GeoPoint const &point, AutonomousVehicleProject *p) const;
+    QPointF geoToPixel(GeoPoint const &point, BackgroundRaster *bg) const;
     QGeoCoordinate pixelToGeo(QPointF const &point) const;
 
     void prepareGeometryChange();
@@ -2,6 +2,7 @@
 
 #include "backgroundraster.h"
 #include "platform.h"
+#include "gz4d_geo.h"
 #include <QDebug>
 #include <QVector2D>
 #include <QtMath>
@@ -106,15 +107,16 @@ void GeoGraphicsMissionItem::drawArrow(QPainterPath& path, const QPointF& from,
     
 }
 
-void GeoGraphicsMissionItem::drawTriangle(QPainterPath& path, const QGeoCoordinate& location, double heading_degrees, double scale) const
+void GeoGraphicsMissionItem::drawTriangle(QPainterPath& path, const GeoPoint& location, double heading_degrees, double scale) const
 {
-    QGeoCoordinate tip = location.atDistanceAndAzimuth(15*scale,heading_degrees);
-    QGeoCoordinate llcorner = location.atDistanceAndAzimuth(15*scale,heading_degrees-150);
-    QGeoCoordinate lrcorner = location.atDistanceAndAzimuth(15*scale,heading_degrees+150);
+    double azimuths[3] = {heading_degrees, heading_degrees-150, heading_degrees+150};
+    double distances[3] = {15*scale, 15*scale, 15*scale};
+    double latitudes[3], longitudes[3];
+    gz4d::LocalTangent(location.latitude(), location.longitude()).direct(azimuths, distances, latitudes, longitudes, 3);
 
-    QPointF ltip = geoToPixel(tip,autonomousVehicleProject());
-    QPointF lllocal = geoToPixel(llcorner,autonomousVehicleProject());
-    QPointF lrlocal = geoToPixel(lrcorner,autonomousVehicleProject());
+    QPointF ltip = geoToPixel(GeoPoint(latitudes[0], longitudes[0]),autonomousVehicleProject());
+    QPointF lllocal = geoToPixel(GeoPoint(latitudes[1], longitudes[1]),autonomousVehicleProject());
+    QPointF lrlocal = geoToPixel(GeoPoint(latitudes[2], longitudes[2]),autonomousVehicleProject());
 
     path.moveTo(ltip);
     path.lineTo(lllocal);
@@ -124,55 +126,118 @@ void GeoGraphicsMissionItem::drawTriangle(QPainterPath& path, const QGeoCoordina
 
 void GeoGraphicsMissionItem::updateETE()
 {
-    double cumulativeDistance = 0.0;
-    
-    QGeoCoordinate minPosition;
-    QGeoCoordinate maxPosition;
-    QGeoCoordinate lastPosition;
-    
     auto lines = getLines();
-    
-    for (auto l: lines)
-        if (l.length() > 1)
-        {
-            auto first = l.begin();
-            if (!minPosition.isValid())
-            {
-                minPosition = *first;
-                maxPosition = *first;
-            }
-            if (lastPosition.isValid())
-                cumulativeDistance += lastPosition.distanceTo(*first);
-            auto second = first;
-            second++;
-            while(second != l.end())
+
+    // The lines are walked in place, those of a single point are not part
+    // of the path.
+    std::size_t count = 0;
+    for(auto const &l: lines)
+        if(l.length() > 1)
+            count += l.length();
+    std::size_t cached = m_etePath.size();
+
+    // Points in the common prefix or suffix with the cached path keep their
+    // legs, so moving, inserting or removing a waypoint only recomputes the
+    // legs around it.
+    std::size_t prefix = 0;
+    [&]
+    {
+        for(auto const &l: lines)
+            if(l.length() > 1)
+                for(auto const &p: l)
+                {
+                    if(prefix == count || prefix == cached || GeoPoint(p) != m_etePath[prefix])
+                        return;
+                    prefix++;
+                }
+    }();
+    std::size_t suffix = 0;
+    [&]
+    {
+        for(auto l = lines.crbegin(); l != lines.crend(); ++l)
+            if(l->length() > 1)
+                for(auto p = l->crbegin(); p != l->crend(); ++p)
+                {
+                    if(suffix == count-prefix || suffix == cached-prefix || GeoPoint(*p) != m_etePath[cached-1-suffix])
+                        return;
+                    suffix++;
+                }
+    }();
+
+    std::vector<GeoPoint> changedPoints;
+    changedPoints.reserve(count-prefix-suffix);
+    std::size_t index = 0;
+    for(auto const &l: lines)
+        if(l.length() > 1)
+            for(auto const &p: l)
             {
-                minPosition.setLatitude(std::min(minPosition.latitude(), second->latitude()));
-                minPosition.setLongitude(std::min(minPosition.longitude(), second->longitude()));
-                maxPosition.setLatitude(std::max(maxPosition.latitude(), second->latitude()));
-                maxPosition.setLongitude(std::max(maxPosition.longitude(), second->longitude()));
-                cumulativeDistance += first->distanceTo(*second);
-                lastPosition = *second;
-                first++;
-                second++;
+                if(index >= prefix && index < count-suffix)
+                    changedPoints.push_back(GeoPoint(p));
+                index++;
             }
-        }
-        
-    double distanceInNMs = cumulativeDistance*0.000539957; // meters to NMs.
-    QString label = "Distance: "+QString::number(int(cumulativeDistance))+" (m), "+QString::number(distanceInNMs,'f',1)+" (nm)";
+
+    // The box only needs recomputing if a point it touched went away.
+    bool boxValid = cached > 0 && count > 0;
+    for(std::size_t i = prefix; i < cached-suffix && boxValid; i++)
+    {
+        GeoPoint const &p = m_etePath[i];
+        if(p.latitude() == m_eteMinPosition.latitude() || p.latitude() == m_eteMaxPosition.latitude() || p.longitude() == m_eteMinPosition.longitude() || p.longitude() == m_eteMaxPosition.longitude())
+            boxValid = false;
+    }
+
+    m_etePath.erase(m_etePath.begin()+prefix, m_etePath.begin()+(cached-suffix));
+    m_etePath.insert(m_etePath.begin()+prefix, changedPoints.begin(), changedPoints.end());
+
+    auto extendBox = [this](GeoPoint const &p)
+    {
+        m_eteMinPosition.setLatitude(std::min(m_eteMinPosition.latitude(), p.latitude()));
+        m_eteMinPosition.setLongitude(std::min(m_eteMinPosition.longitude(), p.longitude()));
+        m_eteMaxPosition.setLatitude(std::max(m_eteMaxPosition.latitude(), p.latitude()));
+        m_eteMaxPosition.setLongitude(std::max(m_eteMaxPosition.longitude(), p.longitude()));
+    };
+    if(boxValid)
+        for(auto const &p: changedPoints)
+            extendBox(p);
+    else if(m_etePath.empty())
+        m_eteMinPosition = m_eteMaxPosition = GeoPoint();
+    else
+    {
+        m_eteMinPosition = m_eteMaxPosition = m_etePath.front();
+        for(auto const &p: m_etePath)
+            extendBox(p);
+    }
+
+    // Leg i joins points i and i+1. Those from the last point of the prefix
+    // to the first of the suffix are replaced, and solved in one batch.
+    auto legCount = [](std::size_t points){return points > 0 ? points-1 : 0;};
+    std::size_t firstLeg = std::min(prefix > 0 ? prefix-1 : 0, legCount(count));
+    std::size_t oldLegsEnd = std::max(firstLeg, std::min(cached-suffix, legCount(cached)));
+    std::size_t newLegsEnd = std::max(firstLeg, std::min(count-suffix, legCount(count)));
+    std::vector<double> lat1, lon1, lat2, lon2;
+    for(std::size_t i = firstLeg; i < newLegsEnd; i++)
+    {
+        lat1.push_back(m_etePath[i].latitude());
+        lon1.push_back(m_etePath[i].longitude());
+        lat2.push_back(m_etePath[i+1].latitude());
+        lon2.push_back(m_etePath[i+1].longitude());
+    }
+    std::vector<double> azimuths(lat1.size()), distances(lat1.size());
+    gz4d::WGS84Ellipsoid::inverse(lat1.data(), lon1.data(), lat2.data(), lon2.data(), azimuths.data(), distances.data(), lat1.size());
+    m_eteLegLengths.erase(m_eteLegLengths.begin()+std::min(firstLeg, m_eteLegLengths.size()), m_eteLegLengths.begin()+std::min(oldLegsEnd, m_eteLegLengths.size()));
+    m_eteLegLengths.insert(m_eteLegLengths.begin()+std::min(firstLeg, m_eteLegLengths.size()), distances.begin(), distances.end());
+
+    double cumulativeDistance = 0.0;
+    for(auto l: m_eteLegLengths)
+        cumulativeDistance += l;
+    m_eteDistance = cumulativeDistance;
+    m_hasETE = true;
+
+    QGeoCoordinate minPosition = m_eteMinPosition.toQGeoCoordinate();
+    QGeoCoordinate maxPosition = m_eteMaxPosition.toQGeoCoordinate();
 
     AutonomousVehicleProject* avp = autonomousVehicleProject();
     if(avp)
     {
-        Platform *platform = avp->currentPlatform();
-        if(platform)
-        {
-            double time = distanceInNMs/platform->speed();
-            if(time < 1.0)
-                label += "\nETE: "+QString::number(int(time*60))+" (min)";
-            else
-                label += "\nETE: "+QString::number(time,'f',2)+" (h)";
-        }
         qreal scale = avp->mapScale();
         qreal distance = minPosition.distanceTo(maxPosition);
         qreal bearing = minPosition.azimuthTo(maxPosition);
@@ -185,12 +250,36 @@ void GeoGraphicsMissionItem::updateETE()
         setLabelPosition(QPointF(dx*scale, dy*scale));
     }
 
+    updateETELabel();
+}
+
+void GeoGraphicsMissionItem::updateETELabel()
+{
+    if(!m_hasETE)
+        return;
+    double distanceInNMs = m_eteDistance*0.000539957; // meters to NMs.
+    QString label = "Distance: "+QString::number(int(m_eteDistance))+" (m), "+QString::number(distanceInNMs,'f',1)+" (nm)";
+
+    AutonomousVehicleProject* avp = autonomousVehicleProject();
+    if(avp)
+    {
+        Platform *platform = avp->currentPlatform();
+        if(platform)
+        {
+            double time = distanceInNMs/platform->speed();
+            if(time < 1.0)
+                label += "\nETE: "+QString::number(int(time*60))+" (min)";
+            else
+                label += "\nETE: "+QString::number(time,'f',2)+" (h)";
+        }
+    }
+
     setLabel(label);
 }
 
 void GeoGraphicsMissionItem::onCurrentPlatformUpdated()
 {
-    updateETE();
+    updateETELabel();
 }
 
 void GeoGraphicsMissionItem::readChildren(const QJsonArray &json, int row)
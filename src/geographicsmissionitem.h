@@ -3,6 +3,9 @@
 
 #include "missionitem.h"
 #include "geographicsitem.h"
+#include "geopoint.h"
+#include <vector>
+#include <QGeoCoordinate>
 
 class BackgroundRaster;
 
@@ -18,10 +21,13 @@ public:
     bool locked() const;
     QList<GeoGraphicsMissionItem*> childrenGeoGraphicsMissionItems() const;
     void drawArrow(QPainterPath &path, QPointF const &from, QPointF const &to, bool drawAtBeginning = false) const;
-    void drawTriangle(QPainterPath &path, QGeoCoordinate const &location, double heading_degrees, double scale=1.0) const;
+    void drawTriangle(QPainterPath &path, GeoPoint const &location, double heading_degrees, double scale=1.0) const;
     
     virtual void readChildren(const QJsonArray &json, int row = -1) override;
 
+    // Refreshes the label text from the cached distance, without walking the lines.
+    void updateETELabel();
+
 public slots:
     void updateBackground(BackgroundRaster * bg);
     void lock();
@@ -38,6 +44,17 @@ protected:
     
 private:
     bool m_locked;
+
+    // Path used for distance and ETE, with the cached geodesic length of
+    // each leg and the path's bounding box, so only the changed span of the
+    // path needs recomputing.
+    std::vector<GeoPoint> m_etePath;
+    std::vector<qreal> m_eteLegLengths;
+    qreal m_eteDistance = 0.0;
+    GeoPoint m_eteMinPosition;
+    GeoPoint m_eteMaxPosition;
+    // Only items that have computed an ETE carry it in their label.
+    bool m_hasETE = false;
 };
 
 #endif // GEOGRAPHICSMISSIONITEM_H
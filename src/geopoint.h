@@ -0,0 +1,73 @@
+#ifndef CAMP_GEOPOINT_H
+#define CAMP_GEOPOINT_H
+
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <QGeoCoordinate>
+
+// Latitude and longitude in degrees, altitude in meters.
+// Unlike QGeoCoordinate, which holds a shared pointer to heap allocated data,
+// a GeoPoint is three doubles, so histories and line buffers of them copy
+// like plain memory. Accessors follow QGeoCoordinate's so it can be swapped
+// in where positions are stored in bulk.
+struct GeoPoint
+{
+    GeoPoint():m_latitude(std::numeric_limits<double>::quiet_NaN()),m_longitude(std::numeric_limits<double>::quiet_NaN()),m_altitude(std::numeric_limits<double>::quiet_NaN())
+    {}
+
+    GeoPoint(double latitude, double longitude, double altitude = std::numeric_limits<double>::quiet_NaN()):m_latitude(latitude),m_longitude(longitude),m_altitude(altitude)
+    {}
+
+    GeoPoint(QGeoCoordinate const &coordinate):m_latitude(coordinate.latitude()),m_longitude(coordinate.longitude()),m_altitude(coordinate.altitude())
+    {}
+
+    // Explicit, since building a QGeoCoordinate allocates, so conversions
+    // should show where they happen.
+    explicit operator QGeoCoordinate() const
+    {
+        return toQGeoCoordinate();
+    }
+
+    QGeoCoordinate toQGeoCoordinate() const
+    {
+        if(!isValid())
+            return QGeoCoordinate();
+        if(std::isnan(m_altitude))
+            return QGeoCoordinate(m_latitude, m_longitude);
+        return QGeoCoordinate(m_latitude, m_longitude, m_altitude);
+    }
+
+    double latitude() const {return m_latitude;}
+    double longitude() const {return m_longitude;}
+    double altitude() const {return m_altitude;}
+
+    void setLatitude(double latitude) {m_latitude = latitude;}
+    void setLongitude(double longitude) {m_longitude = longitude;}
+    void setAltitude(double altitude) {m_altitude = altitude;}
+
+    bool isValid() const
+    {
+        return m_latitude >= -90.0 && m_latitude <= 90.0 && m_longitude >= -180.0 && m_longitude <= 180.0;
+    }
+
+    bool operator==(GeoPoint const &other) const
+    {
+        return m_latitude == other.m_latitude && m_longitude == other.m_longitude && (m_altitude == other.m_altitude || (std::isnan(m_altitude) && std::isnan(other.m_altitude)));
+    }
+
+    bool operator!=(GeoPoint const &other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    double m_latitude;
+    double m_longitude;
+    double m_altitude;
+};
+
+static_assert(std::is_trivially_copyable<GeoPoint>::value, "GeoPoint must be trivially copyable");
+static_assert(sizeof(GeoPoint) == 24, "GeoPoint should be three doubles");
+
+#endif
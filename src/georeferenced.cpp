@@ -51,6 +51,11 @@ void Georeferenced::extractGeoreference(GDALDataset *dataset)
 }
 
 QPointF Georeferenced::project(const QGeoCoordinate &point) const
+{
+    return project(GeoPoint(point));
+}
+
+QPointF Georeferenced::project(const GeoPoint &point) const
 {
     if(m_projectTransformation)
     {
@@ -86,6 +91,36 @@ QPointF Georeferenced::geoToPixel(const QGeoCoordinate &point) const
     return projectedPointToPixel(project(point));
 }
 
+QPointF Georeferenced::geoToPixel(const GeoPoint &point) const
+{
+    return projectedPointToPixel(project(point));
+}
+
+void Georeferenced::geoToPixel(const GeoPoint *points, QPointF *pixels, std::size_t count) const
+{
+    if(!m_projectTransformation)
+    {
+        for(std::size_t i = 0; i < count; i++)
+            pixels[i] = QPointF();
+        return;
+    }
+    std::vector<double> x(count), y(count);
+    for(std::size_t i = 0; i < count; i++)
+    {
+        x[i] = points[i].latitude();
+        y[i] = points[i].longitude();
+    }
+    m_projectTransformation->Transform(count,x.data(),y.data());
+    bool geographic = m_projectTransformation->GetTargetCS()->IsGeographic();
+    for(std::size_t i = 0; i < count; i++)
+    {
+        if(geographic)
+            pixels[i] = projectedPointToPixel(QPointF(y[i],x[i]));
+        else
+            pixels[i] = projectedPointToPixel(QPointF(x[i],y[i]));
+    }
+}
+
 QGeoCoordinate Georeferenced::pixelToGeo(const QPointF &point) const
 {
     return unproject(pixelToProjectedPoint(point));
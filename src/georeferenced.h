@@ -3,6 +3,7 @@
 
 #include <QPointF>
 #include <QGeoCoordinate>
+#include "geopoint.h"
 class GDALDataset;
 class OGRCoordinateTransformation;
 
@@ -13,8 +14,12 @@ public:
     QPointF pixelToProjectedPoint(QPointF const &point) const;
     QPointF projectedPointToPixel(QPointF const &point) const;
     QPointF project(QGeoCoordinate const &point) const;
+    QPointF project(GeoPoint const &point) const;
     QGeoCoordinate unproject(QPointF const &point) const;
     QPointF geoToPixel(QGeoCoordinate const &point) const;
+    QPointF geoToPixel(GeoPoint const &point) const;
+    // Converts count points with a single call to the coordinate transformation.
+    void geoToPixel(GeoPoint const *points, QPointF *pixels, std::size_t count) const;
     QGeoCoordinate pixelToGeo(QPointF const &point) const;
     QString const &projection() const;
 protected:
@@ -1091,7 +1091,7 @@ namespace gz4d
                 /// @param latitude Latitude in radians.
                 static double M(double latitude)
                 {
-                    return S::a()*(1.0-S::e2())/pow((1.0-S::e2())*pow(sin(latitude),2.0),3.0/2.0);
+                    return S::a()*(1.0-S::e2())/pow(1.0-S::e2()*pow(sin(latitude),2.0),3.0/2.0);
                 }
                 
                 template<typename RT> static double M(Angle<double,Radian,RT> latitude){return M(latitude.value());}
@@ -1155,140 +1155,180 @@ namespace gz4d
                 /// @param distance distance in meters.
                 template <typename ET> static Point<double,ReferenceFrame<Geodetic<LatLon>,ET> > direct(Point<double,ReferenceFrame<Geodetic<LatLon>,ET> > const &p1, double azimuth, double distance)
                 {
-                    double phi1 = Radians(p1[0]);
-                    double alpha1 = Radians(azimuth);
+                    Point<double,ReferenceFrame<Geodetic<LatLon>,ET> > ret;
+                    direct(p1[0], p1[1], &azimuth, &distance, &ret[0], &ret[1], 1);
+                    ret[2] = p1[2];
+                    return ret;
+                }
+
+                /// Batched direct solution, projects count points from a single starting point.
+                /// Terms depending only on the starting point are computed once.
+                /// @param lat1,lon1 starting point in degrees
+                /// @param azimuth clockwise angles in degrees relative to north.
+                /// @param distance distances in meters.
+                /// @param lat2,lon2 resulting positions in degrees.
+                static void direct(double lat1, double lon1, double const *azimuth, double const *distance, double *lat2, double *lon2, std::size_t count)
+                {
+                    double phi1 = Radians(lat1);
+                    double lambda1 = Radians(lon1);
                     
                     double epsilon = 1e-12;
                     
+                    double a = S::a();
+                    double b = S::b();
+                    double f = S::f();
+
                     //U is 'reduced latitude'
-                    double tanU1 = (1.0-S::f())*tan(phi1);
+                    double tanU1 = (1.0-f)*tan(phi1);
                     double cosU1 = 1/sqrt(1+tanU1*tanU1);
                     double sinU1 = tanU1*cosU1;
 
-                    double cosAlpha1 = cos(alpha1);
-                    double sinAlpha1 = sin(alpha1);
+                    for(std::size_t i = 0; i < count; ++i)
+                    {
+                        double alpha1 = Radians(azimuth[i]);
 
-                    double sigma1 = atan2(tanU1, cosAlpha1); // angular distance on sphere from equator to P1 along geodesic
-                    double sinAlpha = cosU1*sinAlpha1;
-                    double cos2Alpha = 1.0-sinAlpha*sinAlpha;
-                    
-                    double a = S::a();
-                    double b = S::b();
-                    double f = S::f();
+                        double cosAlpha1 = cos(alpha1);
+                        double sinAlpha1 = sin(alpha1);
 
-                    double u2 = cos2Alpha*(a*a-b*b)/(b*b);
+                        double sigma1 = atan2(tanU1, cosAlpha1); // angular distance on sphere from equator to P1 along geodesic
+                        double sinAlpha = cosU1*sinAlpha1;
+                        double cos2Alpha = 1.0-sinAlpha*sinAlpha;
+                        
+                        double u2 = cos2Alpha*(a*a-b*b)/(b*b);
 
-                    double k1 = (sqrt(1.0+u2)-1.0)/(sqrt(1.0+u2)+1.0);
-                    double A = (1.0+k1*k1/4.0)/(1.0-k1);
-                    double B = k1*(1.0-3.0*k1*k1/8.0);
+                        double k1 = (sqrt(1.0+u2)-1.0)/(sqrt(1.0+u2)+1.0);
+                        double A = (1.0+k1*k1/4.0)/(1.0-k1);
+                        double B = k1*(1.0-3.0*k1*k1/8.0);
+
+                        double sigma = distance[i]/(b*A);
+                        double last_sigma;
+                        double cos2Sigmam;
+                        for(int iteration = 0; iteration < 100; ++iteration)
+                        {
+                            cos2Sigmam = cos(2.0*sigma1+sigma);
+                            double sinSigma = sin(sigma);
+                            double cosSigma = cos(sigma);
+            
+                            double deltaSigma = B*sinSigma*(cos2Sigmam+.25*B*(cosSigma*(-1.0+2.0*cos2Sigmam*cos2Sigmam)-(B/6.0)*cos2Sigmam*(-3.0+4.0*sinSigma*sinSigma)*(-3.0+4.0*cos2Sigmam*cos2Sigmam)));
+                            last_sigma = sigma;
+                            sigma = (distance[i]/(b*A))+deltaSigma;
+                            if (fabs(last_sigma-sigma) <= epsilon)
+                                break;
+                        }
 
-                    double sigma = distance/(b*A);
-                    double last_sigma;
-                    double cos2Sigmam;
-                    while (true)
-                    {
                         cos2Sigmam = cos(2.0*sigma1+sigma);
                         double sinSigma = sin(sigma);
                         double cosSigma = cos(sigma);
-        
-                        double deltaSigma = B*sinSigma*(cos2Sigmam+.25*B*(cosSigma*(-1.0+2.0*cos2Sigmam*cos2Sigmam)-(B/6.0)*cos2Sigmam*(-3.0+4.0*sinSigma*sinSigma)*(-3.0+4.0*cos2Sigmam*cos2Sigmam)));
-                        last_sigma = sigma;
-                        sigma = (distance/(b*A))+deltaSigma;
-                        if (fabs(last_sigma-sigma) <= epsilon)
-                            break;
-                    }
-
-                    cos2Sigmam = cos(2.0*sigma1+sigma);
-            
-                    double phi2 = atan2(sinU1*cos(sigma)+cosU1*sin(sigma)*cosAlpha1,(1-f)*sqrt(sinAlpha*sinAlpha+pow(sinU1*sin(sigma)-cosU1*cos(sigma)*cosAlpha1,2)));
-                    double l = atan2(sin(sigma)*sinAlpha1,cosU1*cos(sigma)-sinU1*sin(sigma)*cosAlpha1);
-                    double C = (f/16.0)*cos2Alpha*(4.0+f*(4.0-3.0*cos2Alpha));
-                    double L = l-(1.0-C)*f*sinAlpha*(sigma+C*sin(sigma)*(cos2Sigmam+C*cos(sigma)*(-1+2.0*cos2Sigmam*cos2Sigmam)));
+                
+                        double phi2 = atan2(sinU1*cosSigma+cosU1*sinSigma*cosAlpha1,(1-f)*sqrt(sinAlpha*sinAlpha+pow(sinU1*sinSigma-cosU1*cosSigma*cosAlpha1,2)));
+                        double l = atan2(sinSigma*sinAlpha1,cosU1*cosSigma-sinU1*sinSigma*cosAlpha1);
+                        double C = (f/16.0)*cos2Alpha*(4.0+f*(4.0-3.0*cos2Alpha));
+                        double L = l-(1.0-C)*f*sinAlpha*(sigma+C*sinSigma*(cos2Sigmam+C*cosSigma*(-1+2.0*cos2Sigmam*cos2Sigmam)));
 
-                    double lat2 = Degrees(phi2);
-                    double lon2 = Degrees(Radians(p1[1]) + L);
-                    
-                    Point<double,ReferenceFrame<Geodetic<LatLon>,ET> > ret;
-                    ret[0] = lat2;
-                    ret[1] = lon2;
-                    ret[2] = p1[2];
-                    return ret;
+                        lat2[i] = Degrees(phi2);
+                        lon2[i] = Degrees(lambda1 + L);
+                    }
                 }
                 
+                /// Batched direct solution for count starting points, each with its own azimuth and distance.
+                static void direct(double const *lat1, double const *lon1, double const *azimuth, double const *distance, double *lat2, double *lon2, std::size_t count)
+                {
+                    for(std::size_t i = 0; i < count; ++i)
+                        direct(lat1[i], lon1[i], &azimuth[i], &distance[i], &lat2[i], &lon2[i], 1);
+                }
+
                 /// Calculates the azimuth and distance from P1 to P2 on the WGS84 ellipsoid.
                 /// @param p1: Position P1 in degrees
                 /// @param p2: Position P2 in degrees
                 /// @return: azimuth in degrees, distance in meters
                 template <typename ET> static std::pair<double,double> inverse(Point<double,ReferenceFrame<Geodetic<LatLon>,ET> > const &p1,Point<double,ReferenceFrame<Geodetic<LatLon>,ET> > const &p2)
                 {
-                    if(p1 == p2)
-                        return std::pair<double,double>(0.0,0.0);
-                    
+                    std::pair<double,double> ret;
+                    inverse(&p1[0], &p1[1], &p2[0], &p2[1], &ret.first, &ret.second, 1);
+                    return ret;
+                }
+
+                /// Batched inverse solution for count pairs of positions, in degrees.
+                /// @return: azimuths in degrees, distances in meters
+                static void inverse(double const *lat1, double const *lon1, double const *lat2, double const *lon2, double *azimuth, double *distance, std::size_t count)
+                {
                     double a = S::a();
                     double b = S::b();
                     double f = S::f();
                     
                     double epsilon = 1e-12;   
-                    
-                    double phi1 = Radians(p1[0]);
-                    double phi2 = Radians(p2[0]);
-                    
-                    double L = Radians(p2[1]-p1[1]);
-
-                    double U1 = atan((1.0-f)*tan(phi1));
-                    double U2 = atan((1.0-f)*tan(phi2));
-                    double cosU1 = cos(U1);
-                    double cosU2 = cos(U2);
-                    double sinU1 = sin(U1);
-                    double sinU2 = sin(U2);
-    
-                    double l = L;
-                    double last_l = Nan<double>();
-                    double cosl;
-                    double sinl;
-                    double sinSigma;
-                    double cosSigma;
-                    double sigma;
-                    double cos2Alpha;
-                    double cos2Sigmam;
-
-                    while (true)
+
+                    for(std::size_t i = 0; i < count; ++i)
                     {
-                        cosl = cos(l);
-                        sinl = sin(l);
-    
-                        sinSigma = sqrt((pow((cosU2*sinl),2))+pow((cosU1*sinU2-sinU1*cosU2*cosl),2));
-                        cosSigma = sinU1*sinU2+cosU1*cosU2*cosl;
-                        sigma = atan2(sinSigma,cosSigma);
-                        double sinAlpha = (cosU1*cosU2*sinl)/sinSigma;
-
-                        cos2Alpha = 1-sinAlpha*sinAlpha;
-                        if (cos2Alpha == 0)
-                            cos2Sigmam = 0;
-                        else
-                            cos2Sigmam = cosSigma-((2.0*sinU1*sinU2)/cos2Alpha);
+                        if(lat1[i] == lat2[i] && lon1[i] == lon2[i])
+                        {
+                            azimuth[i] = 0.0;
+                            distance[i] = 0.0;
+                            continue;
+                        }
 
-                        if (!IsNan(last_l) && fabs(last_l - l) <= epsilon)
-                            break;
-                        last_l = l;
-            
-                        double C = (f/16.0)*cos2Alpha*(4.0+f*(4.0-3.0*cos2Alpha));
-                        l = L+(1.0-C)*f*sinAlpha*(sigma+C*sinSigma*(cos2Sigmam+C*cosSigma*(-1.0+2.0*pow(cos2Sigmam,2))));
-                    }
+                        double phi1 = Radians(lat1[i]);
+                        double phi2 = Radians(lat2[i]);
+                        
+                        double L = Radians(lon2[i]-lon1[i]);
+
+                        double U1 = atan((1.0-f)*tan(phi1));
+                        double U2 = atan((1.0-f)*tan(phi2));
+                        double cosU1 = cos(U1);
+                        double cosU2 = cos(U2);
+                        double sinU1 = sin(U1);
+                        double sinU2 = sin(U2);
+        
+                        double l = L;
+                        double last_l = Nan<double>();
+                        double cosl;
+                        double sinl;
+                        double sinSigma;
+                        double cosSigma;
+                        double sigma;
+                        double cos2Alpha;
+                        double cos2Sigmam;
+
+                        // Nearly antipodal points may not converge, so the iterations are capped.
+                        for(int iteration = 0; iteration < 200; ++iteration)
+                        {
+                            cosl = cos(l);
+                            sinl = sin(l);
+        
+                            sinSigma = sqrt((pow((cosU2*sinl),2))+pow((cosU1*sinU2-sinU1*cosU2*cosl),2));
+                            cosSigma = sinU1*sinU2+cosU1*cosU2*cosl;
+                            sigma = atan2(sinSigma,cosSigma);
+                            double sinAlpha = (cosU1*cosU2*sinl)/sinSigma;
+
+                            cos2Alpha = 1-sinAlpha*sinAlpha;
+                            if (cos2Alpha == 0)
+                                cos2Sigmam = 0;
+                            else
+                                cos2Sigmam = cosSigma-((2.0*sinU1*sinU2)/cos2Alpha);
 
-                    double u2 = cos2Alpha*(a*a-b*b)/(b*b);
-                    double k1 = (sqrt(1.0+u2)-1.0)/(sqrt(1.0+u2)+1.0);
-                    double A = (1.0+k1*k1/4.0)/(1.0-k1);
-                    double B = k1*(1.0-3.0*k1*k1/8.0);
-                    double deltaSigma = B*sinSigma*(cos2Sigmam+.25*B*(cosSigma*(-1.0+2.0*cos2Sigmam*cos2Sigmam)-(B/6.0)*cos2Sigmam*(-3.0+4.0*sinSigma*sinSigma)*(-3.0+4.0*cos2Sigmam*cos2Sigmam)));
-                    double s = b*A*(sigma-deltaSigma);
-                    double alpha1 = atan2(cosU2*sinl,cosU1*sinU2-sinU1*cosU2*cosl);
+                            if (!IsNan(last_l) && fabs(last_l - l) <= epsilon)
+                                break;
+                            last_l = l;
+                
+                            double C = (f/16.0)*cos2Alpha*(4.0+f*(4.0-3.0*cos2Alpha));
+                            l = L+(1.0-C)*f*sinAlpha*(sigma+C*sinSigma*(cos2Sigmam+C*cosSigma*(-1.0+2.0*pow(cos2Sigmam,2))));
+                        }
 
-                    double azimuth = Degrees(alpha1);
-                    if (azimuth < 0.0)
-                        azimuth += 360.0;
+                        double u2 = cos2Alpha*(a*a-b*b)/(b*b);
+                        double k1 = (sqrt(1.0+u2)-1.0)/(sqrt(1.0+u2)+1.0);
+                        double A = (1.0+k1*k1/4.0)/(1.0-k1);
+                        double B = k1*(1.0-3.0*k1*k1/8.0);
+                        double deltaSigma = B*sinSigma*(cos2Sigmam+.25*B*(cosSigma*(-1.0+2.0*cos2Sigmam*cos2Sigmam)-(B/6.0)*cos2Sigmam*(-3.0+4.0*sinSigma*sinSigma)*(-3.0+4.0*cos2Sigmam*cos2Sigmam)));
+                        double s = b*A*(sigma-deltaSigma);
+                        double alpha1 = atan2(cosU2*sinl,cosU1*sinU2-sinU1*cosU2*cosl);
+
+                        double az = Degrees(alpha1);
+                        if (az < 0.0)
+                            az += 360.0;
 
-                    return std::pair<double,double>(azimuth,s);
+                        azimuth[i] = az;
+                        distance[i] = s;
+                    }
                 }
         };
 
@@ -1418,11 +1458,88 @@ namespace gz4d
                     return Box2d(Vector<double,2>(min[1],min[0]),Vector<double,2>(max[1],max[0]));
                 }
         };
+
+        /// Fast approximation of the geodesic solutions near a reference point.
+        /// Positions are scaled by the meridional and transverse radii of
+        /// curvature at the reference latitude, so each point costs a few
+        /// multiplies and the loops have no data dependent branches. Errors
+        /// stay under a meter within a couple of kilometers of the reference,
+        /// suitable for outlines, symbols and other small shapes. Longitudes
+        /// are wrapped so shapes may straddle the antimeridian.
+        template <typename ET=WGS84::Ellipsoid> class LocalTangent
+        {
+            double m_latitude;
+            double m_longitude;
+            double m_metersPerDegreeLatitude;
+            double m_metersPerDegreeLongitude;
+
+            /// Wraps a longitude, or a difference of longitudes, to [-180, 180).
+            static double wrap(double longitude)
+            {
+                return longitude - 360.0*floor((longitude+180.0)/360.0);
+            }
+
+            public:
+                LocalTangent(double latitude, double longitude):m_latitude(latitude),m_longitude(longitude)
+                {
+                    double latr = Radians(latitude);
+                    m_metersPerDegreeLatitude = Radians(ET::M(latr));
+                    m_metersPerDegreeLongitude = Radians(ET::N(latr)*cos(latr));
+                }
+
+                /// Converts count positions in degrees to east and north offsets in meters.
+                void toLocal(double const *latitude, double const *longitude, double *east, double *north, std::size_t count) const
+                {
+                    for(std::size_t i = 0; i < count; ++i)
+                    {
+                        east[i] = wrap(longitude[i]-m_longitude)*m_metersPerDegreeLongitude;
+                        north[i] = (latitude[i]-m_latitude)*m_metersPerDegreeLatitude;
+                    }
+                }
+
+                /// Converts count east and north offsets in meters to positions in degrees.
+                void toGeodetic(double const *east, double const *north, double *latitude, double *longitude, std::size_t count) const
+                {
+                    for(std::size_t i = 0; i < count; ++i)
+                    {
+                        latitude[i] = m_latitude + north[i]/m_metersPerDegreeLatitude;
+                        longitude[i] = wrap(m_longitude + east[i]/m_metersPerDegreeLongitude);
+                    }
+                }
+
+                /// Projects count points from the reference point.
+                /// @param azimuth clockwise angles in degrees relative to north.
+                /// @param distance distances in meters.
+                void direct(double const *azimuth, double const *distance, double *latitude, double *longitude, std::size_t count) const
+                {
+                    for(std::size_t i = 0; i < count; ++i)
+                    {
+                        double az = Radians(azimuth[i]);
+                        latitude[i] = m_latitude + distance[i]*cos(az)/m_metersPerDegreeLatitude;
+                        longitude[i] = wrap(m_longitude + distance[i]*sin(az)/m_metersPerDegreeLongitude);
+                    }
+                }
+
+                /// Azimuths in degrees and distances in meters from the reference point to count positions.
+                void inverse(double const *latitude, double const *longitude, double *azimuth, double *distance, std::size_t count) const
+                {
+                    for(std::size_t i = 0; i < count; ++i)
+                    {
+                        double e = wrap(longitude[i]-m_longitude)*m_metersPerDegreeLongitude;
+                        double n = (latitude[i]-m_latitude)*m_metersPerDegreeLatitude;
+                        double az = Degrees(atan2(e,n));
+                        azimuth[i] = az + (az < 0.0)*360.0;
+                        distance[i] = sqrt(e*e+n*n);
+                    }
+                }
+        };
     }
     
     typedef geo::Point<double,gz4d::geo::WGS84::LatLon> GeoPointLatLong;
     typedef geo::Point<double, gz4d::geo::WGS84::ECEF> GeoPointECEF;
     typedef geo::LocalENU<> LocalENU;
+    typedef geo::LocalTangent<> LocalTangent;
+    typedef geo::WGS84::Ellipsoid WGS84Ellipsoid;
     
     template <typename T, std::size_t N> T norm2(Vector<T, N> const &v)
     {
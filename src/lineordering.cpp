@@ -0,0 +1,510 @@
+#include "lineordering.h"
+
+#include <cmath>
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <limits>
+
+namespace lineordering
+{
+
+namespace
+{
+
+const double earth_radius = 6371000.0;
+
+double wrapAngle(double a)
+{
+    while(a > M_PI)
+        a -= 2.0*M_PI;
+    while(a < -M_PI)
+        a += 2.0*M_PI;
+    return a;
+}
+
+Step flipped(Step const &s)
+{
+    return Step{s.line, !s.reversed};
+}
+
+}
+
+Sequencer::Sequencer(QList<QList<QGeoCoordinate> > const &lines, Parameters const &parameters):m_parameters(parameters),m_lineCount(lines.size()),m_endpointCount(2*lines.size())
+{
+    if(m_lineCount == 0)
+        return;
+
+    double lat = 0.0;
+    double lon = 0.0;
+    int count = 0;
+    for(auto const &l: lines)
+        if(!l.empty())
+        {
+            lat += l.front().latitude() + l.back().latitude();
+            lon += l.front().longitude() + l.back().longitude();
+            count += 2;
+        }
+    if(count)
+        m_reference = QGeoCoordinate(lat/count, lon/count);
+    else
+        m_reference = QGeoCoordinate(0.0, 0.0);
+
+    m_endpoints.resize(m_endpointCount, Point{0.0, 0.0});
+    m_headings.resize(m_endpointCount, std::nan(""));
+    for(int i = 0; i < m_lineCount; i++)
+    {
+        auto const &l = lines[i];
+        if(l.empty())
+            continue;
+        m_endpoints[2*i] = project(l.front());
+        m_endpoints[2*i+1] = project(l.back());
+        if(l.size() > 1)
+        {
+            Point p0 = project(l[0]);
+            Point p1 = project(l[1]);
+            m_headings[2*i] = atan2(p1.y-p0.y, p1.x-p0.x);
+            Point pn1 = project(l[l.size()-2]);
+            Point pn = m_endpoints[2*i+1];
+            m_headings[2*i+1] = atan2(pn.y-pn1.y, pn.x-pn1.x);
+        }
+    }
+
+    // Travel heading at an endpoint, forward lines exit at odd endpoints and
+    // enter at even ones, a reversed line travels the opposite way.
+    auto exitHeading = [&](int e)
+    {
+        return (e%2) ? m_headings[e] : m_headings[e]+M_PI;
+    };
+    auto entryHeading = [&](int e)
+    {
+        return (e%2) ? m_headings[e]+M_PI : m_headings[e];
+    };
+
+    m_costs.resize(m_endpointCount*m_endpointCount, 0.0);
+    for(int from = 0; from < m_endpointCount; from++)
+        for(int to = 0; to < m_endpointCount; to++)
+        {
+            if(from/2 == to/2)
+                continue;
+            double dx = m_endpoints[to].x - m_endpoints[from].x;
+            double dy = m_endpoints[to].y - m_endpoints[from].y;
+            double distance = sqrt(dx*dx+dy*dy);
+            double turn = 0.0;
+            double hout = exitHeading(from);
+            double hin = entryHeading(to);
+            if(!std::isnan(hout) && !std::isnan(hin))
+            {
+                if(distance < 1.0)
+                    turn = fabs(wrapAngle(hin-hout));
+                else
+                {
+                    double transit = atan2(dy, dx);
+                    turn = fabs(wrapAngle(transit-hout)) + fabs(wrapAngle(hin-transit));
+                }
+            }
+            m_costs[from*m_endpointCount+to] = distance + m_parameters.turnPenalty*turn/M_PI;
+        }
+}
+
+Sequencer::Point Sequencer::project(QGeoCoordinate const &coordinate) const
+{
+    double lat0 = m_reference.latitude()*M_PI/180.0;
+    double dlat = (coordinate.latitude()-m_reference.latitude())*M_PI/180.0;
+    double dlon = wrapAngle((coordinate.longitude()-m_reference.longitude())*M_PI/180.0);
+    return Point{dlon*cos(lat0)*earth_radius, dlat*earth_radius};
+}
+
+double Sequencer::cost(StartCosts const &startCosts, std::vector<Step> const &steps) const
+{
+    if(steps.empty())
+        return 0.0;
+    double ret = startCost(startCosts, steps.front());
+    for(int i = 1; i < steps.size(); i++)
+        ret += transition(steps[i-1], steps[i]);
+    return ret;
+}
+
+std::vector<Step> Sequencer::nearestNeighbor(Step first) const
+{
+    std::vector<Step> ret;
+    ret.reserve(m_lineCount);
+    std::vector<bool> used(m_lineCount, false);
+    ret.push_back(first);
+    used[first.line] = true;
+    while(ret.size() < m_lineCount)
+    {
+        Step best{-1, false};
+        double bestCost = std::numeric_limits<double>::max();
+        for(int i = 0; i < m_lineCount; i++)
+        {
+            if(used[i])
+                continue;
+            for(bool reversed: {false, true})
+            {
+                Step candidate{i, reversed};
+                double c = transition(ret.back(), candidate);
+                if(c < bestCost)
+                {
+                    bestCost = c;
+                    best = candidate;
+                }
+            }
+        }
+        ret.push_back(best);
+        used[best.line] = true;
+    }
+    return ret;
+}
+
+bool Sequencer::twoOpt(StartCosts const &startCosts, std::vector<Step> &steps) const
+{
+    // Costs are symmetric under reversal, so only the links at the ends of
+    // the reversed run change.
+    bool improved = false;
+    int n = steps.size();
+    for(int i = 0; i < n; i++)
+        for(int j = i; j < n; j++)
+        {
+            double before = 0.0;
+            double after = 0.0;
+            if(i == 0)
+            {
+                before += startCost(startCosts, steps[i]);
+                after += startCost(startCosts, flipped(steps[j]));
+            }
+            else
+            {
+                before += transition(steps[i-1], steps[i]);
+                after += transition(steps[i-1], flipped(steps[j]));
+            }
+            if(j < n-1)
+            {
+                before += transition(steps[j], steps[j+1]);
+                after += transition(flipped(steps[i]), steps[j+1]);
+            }
+            if(after < before - 1e-6)
+            {
+                std::reverse(steps.begin()+i, steps.begin()+j+1);
+                for(int k = i; k <= j; k++)
+                    steps[k].reversed = !steps[k].reversed;
+                improved = true;
+            }
+        }
+    return improved;
+}
+
+bool Sequencer::orOpt(StartCosts const &startCosts, std::vector<Step> &steps) const
+{
+    // link cost where a null from is the start and a null to is the end of the mission
+    auto link = [&](Step const *from, Step const *to)
+    {
+        if(!to)
+            return 0.0;
+        if(!from)
+            return startCost(startCosts, *to);
+        return transition(*from, *to);
+    };
+
+    bool improved = false;
+    for(int i = 0; i < steps.size(); i++)
+    {
+        Step moving = steps[i];
+        Step const *prev = i > 0 ? &steps[i-1] : nullptr;
+        Step const *next = i < steps.size()-1 ? &steps[i+1] : nullptr;
+        double removalGain = link(prev, &moving) + link(&moving, next) - link(prev, next);
+
+        std::vector<Step> remaining(steps);
+        remaining.erase(remaining.begin()+i);
+
+        double bestGain = 1e-6;
+        int bestSlot = -1;
+        Step bestStep = moving;
+        // Staying at slot i only gains anything when flipped, so it tries a
+        // reversal in place.
+        for(int slot = 0; slot <= remaining.size(); slot++)
+        {
+            Step const *a = slot > 0 ? &remaining[slot-1] : nullptr;
+            Step const *b = slot < remaining.size() ? &remaining[slot] : nullptr;
+            for(Step candidate: {moving, flipped(moving)})
+            {
+                double insertion = link(a, &candidate) + link(&candidate, b) - link(a, b);
+                double gain = removalGain - insertion;
+                if(gain > bestGain)
+                {
+                    bestGain = gain;
+                    bestSlot = slot;
+                    bestStep = candidate;
+                }
+            }
+        }
+        if(bestSlot >= 0)
+        {
+            remaining.insert(remaining.begin()+bestSlot, bestStep);
+            steps.swap(remaining);
+            improved = true;
+        }
+    }
+    return improved;
+}
+
+void Sequencer::improve(StartCosts const &startCosts, std::vector<Step> &steps) const
+{
+    for(int pass = 0; pass < m_parameters.maxPasses; pass++)
+    {
+        bool improved = twoOpt(startCosts, steps);
+        improved = orOpt(startCosts, steps) || improved;
+        if(!improved)
+            break;
+    }
+}
+
+std::vector<Step> Sequencer::solve(QGeoCoordinate const &start) const
+{
+    if(m_lineCount == 0)
+        return std::vector<Step>();
+
+    StartCosts startCosts;
+    if(start.isValid())
+    {
+        Point s = project(start);
+        startCosts.resize(m_endpointCount);
+        for(int e = 0; e < m_endpointCount; e++)
+        {
+            double dx = m_endpoints[e].x - s.x;
+            double dy = m_endpoints[e].y - s.y;
+            startCosts[e] = sqrt(dx*dx+dy*dy);
+        }
+    }
+
+    // Pick the first steps to try, closest to the start if we have one,
+    // otherwise spread across the lines.
+    std::vector<Step> firsts;
+    for(int e = 0; e < m_endpointCount; e++)
+        firsts.push_back(Step{e/2, e%2 == 1});
+    if(!startCosts.empty())
+        std::sort(firsts.begin(), firsts.end(), [&](Step const &a, Step const &b){return startCosts[entry(a)] < startCosts[entry(b)];});
+
+    int starts = m_parameters.starts;
+    if(starts <= 0)
+        starts = std::max(1u, std::thread::hardware_concurrency());
+    starts = std::min<int>(starts, firsts.size());
+
+    std::vector<Step> selected;
+    for(int i = 0; i < starts; i++)
+    {
+        if(startCosts.empty())
+            selected.push_back(firsts[(i*firsts.size())/starts]);
+        else
+            selected.push_back(firsts[i]);
+    }
+
+    std::vector<std::future<std::vector<Step> > > results;
+    for(auto const &first: selected)
+        results.push_back(std::async(std::launch::async, [this, &startCosts, first]()
+        {
+            std::vector<Step> steps = nearestNeighbor(first);
+            improve(startCosts, steps);
+            return steps;
+        }));
+
+    std::vector<Step> best;
+    double bestCost = std::numeric_limits<double>::max();
+    for(auto &r: results)
+    {
+        std::vector<Step> steps = r.get();
+        double c = cost(startCosts, steps);
+        if(c < bestCost)
+        {
+            bestCost = c;
+            best.swap(steps);
+        }
+    }
+    return best;
+}
+
+namespace
+{
+
+QJsonArray reversed(QJsonArray const &array)
+{
+    QJsonArray ret;
+    for(int i = array.size()-1; i >= 0; i--)
+        ret.append(array[i]);
+    return ret;
+}
+
+// Reorders the objects of a run in place. points extracts the path
+// followed by an object and reverse returns the object run backwards.
+template<typename PointsFunction, typename ReverseFunction> void reorderRun(QList<QJsonObject> &run, PointsFunction points, ReverseFunction reverse, QGeoCoordinate const &start, Parameters const &parameters)
+{
+    QList<QList<QGeoCoordinate> > lines;
+    for(auto const &o: run)
+        lines.append(points(o));
+
+    Sequencer sequencer(lines, parameters);
+    auto steps = sequencer.solve(start);
+
+    QList<QJsonObject> ret;
+    for(auto const &s: steps)
+    {
+        if(s.reversed)
+            ret.append(reverse(run[s.line]));
+        else
+            ret.append(run[s.line]);
+    }
+    run = ret;
+}
+
+QGeoCoordinate navPosition(QJsonObject const &navObject)
+{
+    QJsonObject position = navObject["position"].toObject();
+    return QGeoCoordinate(position["latitude"].toDouble(), position["longitude"].toDouble());
+}
+
+QGeoCoordinate waypointPosition(QJsonObject const &waypointObject)
+{
+    return QGeoCoordinate(waypointObject["latitude"].toDouble(), waypointObject["longitude"].toDouble());
+}
+
+QList<QGeoCoordinate> navPoints(QJsonObject const &navItem)
+{
+    QList<QGeoCoordinate> ret;
+    for(auto p: navItem["nav"].toArray())
+        ret.append(navPosition(p.toObject()));
+    return ret;
+}
+
+QJsonObject reversedNavItem(QJsonObject navItem)
+{
+    navItem["nav"] = reversed(navItem["nav"].toArray());
+    return navItem;
+}
+
+// Path followed by a TrackLine, or by all the lines of a SurveyPattern in order.
+QList<QGeoCoordinate> taskPoints(QJsonObject const &task)
+{
+    QList<QGeoCoordinate> ret;
+    if(task["type"] == "TrackLine")
+        for(auto wp: task["waypoints"].toArray())
+            ret.append(waypointPosition(wp.toObject()));
+    else if(task["type"] == "SurveyPattern")
+        for(auto c: task["children"].toArray())
+            ret.append(taskPoints(c.toObject()));
+    return ret;
+}
+
+// A TrackLine with its waypoints reversed, or a SurveyPattern with its lines
+// in reverse order, each one reversed.
+QJsonObject reversedTask(QJsonObject task)
+{
+    if(task["type"] == "TrackLine")
+        task["waypoints"] = reversed(task["waypoints"].toArray());
+    else if(task["type"] == "SurveyPattern")
+    {
+        QJsonArray children = reversed(task["children"].toArray());
+        QJsonArray childrenArray;
+        for(auto c: children)
+            childrenArray.append(reversedTask(c.toObject()));
+        task["children"] = childrenArray;
+    }
+    return task;
+}
+
+QGeoCoordinate lastPosition(QList<QGeoCoordinate> const &points, QGeoCoordinate const &current)
+{
+    if(points.isEmpty())
+        return current;
+    return points.last();
+}
+
+// Reorders the children of a task object, returns where the vehicle ends up.
+QGeoCoordinate reorderTaskChildren(QJsonObject &task, QGeoCoordinate position, Parameters const &parameters)
+{
+    QString type = task["type"].toString();
+    if(type == "Waypoint")
+        return waypointPosition(task);
+    if(type == "TrackLine")
+        return lastPosition(taskPoints(task), position);
+    if(type != "Group" && type != "SurveyPattern")
+        return position;
+
+    QJsonArray childrenArray;
+    QList<QJsonObject> run;
+    auto flush = [&]()
+    {
+        if(run.isEmpty())
+            return;
+        reorderRun(run, taskPoints, reversedTask, position, parameters);
+        for(auto const &o: run)
+            childrenArray.append(o);
+        position = lastPosition(taskPoints(run.last()), position);
+        run.clear();
+    };
+
+    // A Group's SurveyPatterns keep their lines together, they are ordered
+    // internally first then sequenced, and possibly flipped, as one unit
+    // among the Group's track lines.
+    for(auto c: task["children"].toArray())
+    {
+        QJsonObject child = c.toObject();
+        if(child["type"] == "TrackLine")
+            run.append(child);
+        else if(type == "Group" && child["type"] == "SurveyPattern")
+        {
+            reorderTaskChildren(child, position, parameters);
+            run.append(child);
+        }
+        else
+        {
+            flush();
+            position = reorderTaskChildren(child, position, parameters);
+            childrenArray.append(child);
+        }
+    }
+    flush();
+
+    task["children"] = childrenArray;
+    return position;
+}
+
+}
+
+void reorderNavArray(QJsonArray &navArray, QGeoCoordinate const &start, Parameters const &parameters)
+{
+    QJsonArray ret;
+    QList<QJsonObject> run;
+    QGeoCoordinate position = start;
+    auto flush = [&]()
+    {
+        if(run.isEmpty())
+            return;
+        reorderRun(run, navPoints, reversedNavItem, position, parameters);
+        for(auto const &o: run)
+            ret.append(o);
+        position = lastPosition(navPoints(run.last()), position);
+        run.clear();
+    };
+
+    for(auto item: navArray)
+    {
+        QJsonObject navItem = item.toObject();
+        if(navItem["type"] == "survey_line")
+            run.append(navItem);
+        else
+        {
+            flush();
+            position = lastPosition(navPoints(navItem), position);
+            ret.append(navItem);
+        }
+    }
+    flush();
+    navArray = ret;
+}
+
+void reorderTask(QJsonObject &task, QGeoCoordinate const &start, Parameters const &parameters)
+{
+    reorderTaskChildren(task, start, parameters);
+}
+
+} // namespace lineordering
@@ -0,0 +1,100 @@
+#ifndef CAMP_LINEORDERING_H
+#define CAMP_LINEORDERING_H
+
+#include <vector>
+#include <QList>
+#include <QGeoCoordinate>
+#include <QJsonArray>
+#include <QJsonObject>
+
+/* --------------------------------------------------------------------------
+Survey line sequencing.
+
+Given a set of lines, chooses the order in which they are run and the
+direction each one is run in, minimizing the transit distance between lines
+plus a penalty for the heading change needed to get from the end of one line
+onto the next one.
+
+All endpoint to endpoint costs are precomputed into a matrix, an initial
+sequence is built with a nearest neighbor heuristic, then it is improved
+with 2-opt (reversing a run of lines, which also flips their directions)
+and Or-opt (moving a single line, optionally flipped, elsewhere). Several
+starts are improved in parallel and the cheapest result is kept.
+--------------------------------------------------------------------------- */
+namespace lineordering
+{
+
+struct Parameters
+{
+    // Cost in meters equivalent to a full 180 degree turn between lines.
+    double turnPenalty = 100.0;
+    // Number of starting sequences to improve, 0 to use one per hardware thread.
+    int starts = 0;
+    // Upper bound on improvement passes per start.
+    int maxPasses = 50;
+};
+
+struct Step
+{
+    int line;
+    bool reversed;
+};
+
+class Sequencer
+{
+public:
+    Sequencer(QList<QList<QGeoCoordinate> > const &lines, Parameters const &parameters = Parameters());
+
+    // Returns the order in which to run the lines. If start is valid, the
+    // transit from start to the first line is included in the cost.
+    std::vector<Step> solve(QGeoCoordinate const &start = QGeoCoordinate()) const;
+
+private:
+    struct Point
+    {
+        double x;
+        double y;
+    };
+
+    // endpoint index: 2*line is the first point of a line, 2*line+1 the last one.
+    Point project(QGeoCoordinate const &coordinate) const;
+
+    static int entry(Step const &s) {return 2*s.line + (s.reversed?1:0);}
+    static int exit(Step const &s) {return 2*s.line + (s.reversed?0:1);}
+
+    double transition(Step const &from, Step const &to) const {return m_costs[exit(from)*m_endpointCount+entry(to)];}
+
+    // cost of getting from the start position to each endpoint, empty if there is no start.
+    typedef std::vector<double> StartCosts;
+    static double startCost(StartCosts const &startCosts, Step const &s) {return startCosts.empty() ? 0.0 : startCosts[entry(s)];}
+    double cost(StartCosts const &startCosts, std::vector<Step> const &steps) const;
+
+    std::vector<Step> nearestNeighbor(Step first) const;
+    void improve(StartCosts const &startCosts, std::vector<Step> &steps) const;
+    bool twoOpt(StartCosts const &startCosts, std::vector<Step> &steps) const;
+    bool orOpt(StartCosts const &startCosts, std::vector<Step> &steps) const;
+
+    Parameters m_parameters;
+    int m_lineCount;
+    int m_endpointCount;
+
+    // endpoints projected to a local plane, in meters.
+    std::vector<Point> m_endpoints;
+    // heading of travel when leaving (for entries) or arriving at (for exits) an endpoint, forward direction, in radians.
+    std::vector<double> m_headings;
+    std::vector<double> m_costs;
+
+    QGeoCoordinate m_reference;
+};
+
+// Reorders runs of consecutive "survey_line" items of a mission plan NAVIGATION array.
+void reorderNavArray(QJsonArray &navArray, QGeoCoordinate const &start = QGeoCoordinate(), Parameters const &parameters = Parameters());
+
+// Reorders the TrackLine children of a task object, as written by MissionItem::write().
+// Lines within each SurveyPattern are reordered, and within a Group whole
+// patterns are ordered and flipped as units alongside the Group's track lines.
+void reorderTask(QJsonObject &task, QGeoCoordinate const &start = QGeoCoordinate(), Parameters const &parameters = Parameters());
+
+} // namespace lineordering
+
+#endif
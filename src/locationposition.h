@@ -1,12 +1,12 @@
 #ifndef LOCATIONPOSITION_H
 #define LOCATIONPOSITION_H
 
-#include <QGeoCoordinate>
 #include <QPointF>
+#include "geopoint.h"
 
 struct LocationPosition
 {
-    QGeoCoordinate location;
+    GeoPoint location;
     QPointF pos;
 };
 
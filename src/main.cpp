@@ -9,6 +9,8 @@ int main(int argc, char *argv[])
 {
     ros::init(argc,argv, "CCOMAutonomousMissionPlanner", ros::init_options::AnonymousName);
     QApplication a(argc, argv);
+    a.setOrganizationName("CCOM");
+    a.setApplicationName("CCOMAutonomousMissionPlanner");
     MainWindow w;
     w.show();
     
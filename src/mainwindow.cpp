@@ -5,6 +5,8 @@
 #include <gdal_priv.h>
 #include <cstdint>
 #include <QOpenGLWidget>
+#include <QStatusBar>
+#include <QSettings>
 
 #include "autonomousvehicleproject.h"
 #include "waypoint.h"
@@ -53,6 +55,8 @@ MainWindow::MainWindow(QWidget *parent) :
     project->rosLink()->connectROS();
 
     connect(project->rosLink(), &ROSLink::centerMap, ui->projectView, &ProjectView::centerMap);
+    connect(project->rosLink(), &ROSLink::coverageSummaryUpdated, [this](QString const &summary){statusBar()->showMessage(summary);});
+    connect(project->rosLink(), &ROSLink::warning, [this](QString const &message){statusBar()->showMessage(message, 10000);});
 
     connect(ui->detailsView, &DetailsView::clearTasks, project->rosLink(), &ROSLink::clearTasks);
     
@@ -61,12 +65,17 @@ MainWindow::MainWindow(QWidget *parent) :
     m_ais_manager = new AISManager();
     connect(project, &AutonomousVehicleProject::backgroundUpdated, m_ais_manager, &AISManager::updateBackground);
     connect(ui->projectView, &ProjectView::viewportChanged, m_ais_manager, &AISManager::updateViewport);
+    connect(ui->projectView, &ProjectView::viewportChanged, project->rosLink(), &ROSLink::updateViewport);
 
     m_sound_play = new SoundPlay();
 
     m_speech_alerts = new SpeechAlerts(this);
     connect(m_speech_alerts, &SpeechAlerts::tell, m_sound_play, &SoundPlay::say);
     connect(ui->helmManager, &HelmManager::pilotingModeUpdated, m_speech_alerts, &SpeechAlerts::updatePilotingMode);
+
+    QSettings settings;
+    ui->actionOptimizeLineOrder->setChecked(settings.value("optimizeLineOrder", false).toBool());
+    project->setOptimizeLineOrder(ui->actionOptimizeLineOrder->isChecked());
 }
 
 MainWindow::~MainWindow()
@@ -418,6 +427,12 @@ void MainWindow::on_actionFollow_triggered()
     emit project->followRobot(ui->actionFollow->isChecked());
 }
 
+void MainWindow::on_actionOptimizeLineOrder_triggered()
+{
+    project->setOptimizeLineOrder(ui->actionOptimizeLineOrder->isChecked());
+    QSettings().setValue("optimizeLineOrder", ui->actionOptimizeLineOrder->isChecked());
+}
+
 void MainWindow::on_actionRadarColor_triggered()
 {
     emit project->selectRadarColor();
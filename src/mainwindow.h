@@ -62,6 +62,7 @@ private slots:
     void on_actionAISManager_triggered();
     void on_actionSay_something_triggered();
     void on_actionFollow_triggered();
+    void on_actionOptimizeLineOrder_triggered();
 
 private:
     Ui::MainWindow *ui;
@@ -0,0 +1,44 @@
+#include "path_layer.h"
+
+PathLayer::PathLayer(QGraphicsItem *parent, BuildFunction build, PaintFunction paint, BoundsFunction bounds):QGraphicsItem(parent),m_build(build),m_paint(paint),m_boundsFunction(bounds)
+{
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+void PathLayer::rebuild() const
+{
+  if(m_valid)
+    return;
+  m_path = m_build ? m_build() : QPainterPath();
+  if(m_boundsFunction)
+    m_bounds = m_boundsFunction();
+  else
+    m_bounds = m_path.boundingRect();
+  m_valid = true;
+}
+
+QRectF PathLayer::boundingRect() const
+{
+  rebuild();
+  return m_bounds;
+}
+
+QPainterPath PathLayer::shape() const
+{
+  rebuild();
+  return m_path;
+}
+
+void PathLayer::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+  rebuild();
+  if(m_paint)
+    m_paint(painter, m_path, option);
+}
+
+void PathLayer::invalidate()
+{
+  prepareGeometryChange();
+  m_valid = false;
+  update();
+}
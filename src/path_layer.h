@@ -0,0 +1,42 @@
+#ifndef CAMP_PATH_LAYER_H
+#define CAMP_PATH_LAYER_H
+
+#include <functional>
+#include <QGraphicsItem>
+#include <QPainterPath>
+
+// Child item drawing one layer of its parent. The layer's path is built by
+// the owner on demand and kept, along with its bounds, until invalidate()
+// is called. A change to one layer therefore leaves the other layers'
+// paths and scene index entries alone.
+class PathLayer: public QGraphicsItem
+{
+public:
+  typedef std::function<QPainterPath()> BuildFunction;
+  typedef std::function<void(QPainter *painter, QPainterPath const &path, QStyleOptionGraphicsItem const *option)> PaintFunction;
+  typedef std::function<QRectF()> BoundsFunction;
+
+  // bounds, if given, replaces the path's bounding rectangle, for layers
+  // that draw more than their path.
+  PathLayer(QGraphicsItem *parent, BuildFunction build, PaintFunction paint, BoundsFunction bounds = BoundsFunction());
+
+  QRectF boundingRect() const override;
+  QPainterPath shape() const override;
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+  // Drops the cached path and schedules a repaint of this layer only.
+  void invalidate();
+
+private:
+  void rebuild() const;
+
+  BuildFunction m_build;
+  PaintFunction m_paint;
+  BoundsFunction m_boundsFunction;
+
+  mutable QPainterPath m_path;
+  mutable QRectF m_bounds;
+  mutable bool m_valid = false;
+};
+
+#endif
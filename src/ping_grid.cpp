@@ -0,0 +1,197 @@
+#include "ping_grid.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <QColor>
+
+namespace
+{
+  int floorDiv(int value, int divisor)
+  {
+    return value >= 0 ? value/divisor : -((-value+divisor-1)/divisor);
+  }
+
+  // Red for shallow or sparse, through the hues, to blue for deep or dense.
+  std::vector<QRgb> const &colourScale()
+  {
+    static std::vector<QRgb> scale;
+    if(scale.empty())
+      for(int i = 0; i < 256; i++)
+        scale.push_back(QColor::fromHsv(i*240/255, 255, 255).rgba());
+    return scale;
+  }
+}
+
+PingGrid::PingGrid(double cellSize, Statistic statistic):m_cellSize(cellSize > 0.0 ? cellSize : 1.0),m_statistic(statistic)
+{
+  clear();
+}
+
+void PingGrid::setCellSize(double cellSize)
+{
+  if(cellSize <= 0.0)
+    cellSize = 1.0;
+  {
+    QMutexLocker lock(&m_mutex);
+    if(cellSize == m_cellSize)
+      return;
+    m_cellSize = cellSize;
+  }
+  clear();
+}
+
+double PingGrid::cellSize() const
+{
+  QMutexLocker lock(&m_mutex);
+  return m_cellSize;
+}
+
+void PingGrid::setStatistic(Statistic statistic)
+{
+  QMutexLocker lock(&m_mutex);
+  if(statistic == m_statistic)
+    return;
+  m_statistic = statistic;
+  updateRange();
+  for(auto const &t: m_tiles)
+    colourMap(t.first, t.second);
+}
+
+void PingGrid::setDepthRange(double minimum, double maximum)
+{
+  QMutexLocker lock(&m_mutex);
+  m_fixedMinimum = std::min(minimum, maximum);
+  m_fixedMaximum = std::max(minimum, maximum);
+  if(updateRange())
+    for(auto const &t: m_tiles)
+      colourMap(t.first, t.second);
+}
+
+void PingGrid::clear()
+{
+  QMutexLocker lock(&m_mutex);
+  m_tiles.clear();
+  m_updated.clear();
+  m_minimumDepth = std::numeric_limits<float>::max();
+  m_maximumDepth = std::numeric_limits<float>::lowest();
+  m_maximumCount = 0;
+  m_rangeMinimum = m_rangeMaximum = 0.0;
+  m_rangeCount = 0;
+  m_cleared = true;
+}
+
+void PingGrid::add(double const *east, double const *north, float const *depth, std::size_t count)
+{
+  QMutexLocker lock(&m_mutex);
+  Tile *current = nullptr;
+  TileKey currentKey;
+  for(std::size_t i = 0; i < count; i++)
+  {
+    if(!std::isfinite(east[i]) || !std::isfinite(north[i]) || !std::isfinite(depth[i]))
+      continue;
+    int column = std::floor(east[i]/m_cellSize);
+    int row = std::floor(north[i]/m_cellSize);
+    TileKey key(floorDiv(column, TileSize), floorDiv(row, TileSize));
+    if(!current || key != currentKey)
+    {
+      current = &m_tiles[key];
+      if(current->cells.empty())
+        current->cells.assign(TileSize*TileSize, Cell{std::numeric_limits<float>::max(), 0.0f, 0});
+      currentKey = key;
+    }
+    Cell &cell = current->cells[(row-key.second*TileSize)*TileSize+column-key.first*TileSize];
+    cell.minimum = std::min(cell.minimum, depth[i]);
+    cell.sum += depth[i];
+    cell.count++;
+    current->changed = true;
+    m_minimumDepth = std::min(m_minimumDepth, depth[i]);
+    m_maximumDepth = std::max(m_maximumDepth, depth[i]);
+    m_maximumCount = std::max(m_maximumCount, cell.count);
+  }
+
+  // A new colour range recolours every tile, otherwise only the ones touched.
+  bool rangeChanged = updateRange();
+  for(auto &t: m_tiles)
+    if(rangeChanged || t.second.changed)
+    {
+      colourMap(t.first, t.second);
+      t.second.changed = false;
+    }
+}
+
+bool PingGrid::updateRange()
+{
+  double minimum = m_fixedMinimum;
+  double maximum = m_fixedMaximum;
+  if(minimum == maximum)
+  {
+    if(m_minimumDepth > m_maximumDepth)
+      return false;
+    // Steps keep the range from creeping, which would recolour everything
+    // on most pings.
+    minimum = std::floor(m_minimumDepth/5.0)*5.0;
+    maximum = std::max(minimum+5.0, std::ceil(m_maximumDepth/5.0)*5.0);
+  }
+  uint32_t count = 2;
+  while(count < m_maximumCount)
+    count *= 2;
+  bool changed = minimum != m_rangeMinimum || maximum != m_rangeMaximum || (m_statistic == Density && count != m_rangeCount);
+  m_rangeMinimum = minimum;
+  m_rangeMaximum = maximum;
+  m_rangeCount = count;
+  return changed;
+}
+
+void PingGrid::colourMap(TileKey const &key, Tile const &tile)
+{
+  std::vector<QRgb> const &scale = colourScale();
+  double span = m_rangeMaximum-m_rangeMinimum;
+  double logCount = std::log2(double(m_rangeCount));
+  QImage image(TileSize, TileSize, QImage::Format_ARGB32_Premultiplied);
+  for(int row = 0; row < TileSize; row++)
+  {
+    QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(TileSize-1-row));
+    Cell const *cells = tile.cells.data()+row*TileSize;
+    for(int column = 0; column < TileSize; column++)
+    {
+      Cell const &c = cells[column];
+      if(c.count == 0)
+      {
+        line[column] = 0;
+        continue;
+      }
+      double value;
+      switch(m_statistic)
+      {
+      case MinimumDepth:
+        value = span > 0.0 ? (c.minimum-m_rangeMinimum)/span : 0.0;
+        break;
+      case Density:
+        value = std::log2(double(c.count))/logCount;
+        break;
+      default:
+        value = span > 0.0 ? (c.sum/c.count-m_rangeMinimum)/span : 0.0;
+      }
+      line[column] = scale[std::max(0, std::min(255, int(value*255.0)))];
+    }
+  }
+  m_updated[key] = image;
+}
+
+bool PingGrid::takeUpdated(std::vector<TileImage> &tiles)
+{
+  QMutexLocker lock(&m_mutex);
+  bool cleared = m_cleared;
+  m_cleared = false;
+  for(auto const &u: m_updated)
+    tiles.push_back(TileImage{u.first, u.second});
+  m_updated.clear();
+  return cleared;
+}
+
+QRectF PingGrid::tileExtent(TileKey const &key) const
+{
+  QMutexLocker lock(&m_mutex);
+  double extent = TileSize*m_cellSize;
+  return QRectF(key.first*extent, key.second*extent, extent, extent);
+}
@@ -0,0 +1,99 @@
+#ifndef CAMP_PING_GRID_H
+#define CAMP_PING_GRID_H
+
+#include <map>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <QImage>
+#include <QMutex>
+#include <QRectF>
+
+// Soundings binned into square cells of a local east/north grid, in meters.
+// Each cell keeps the minimum depth, the depth sum and the sounding count,
+// so the grid costs the same whatever the number of soundings. Cells are
+// stored in tiles allocated on first use. Tiles touched by new soundings
+// are colour mapped by the thread adding them, and the ready images are
+// collected by the display with takeUpdated(), so drawing never depends on
+// how many soundings came in.
+class PingGrid
+{
+public:
+  static const int TileSize = 256;
+
+  enum Statistic
+  {
+    MinimumDepth,
+    MeanDepth,
+    Density
+  };
+
+  typedef std::pair<int,int> TileKey;
+
+  struct TileImage
+  {
+    TileKey key;
+    // north up, the first row is the tile's northern edge
+    QImage image;
+  };
+
+  explicit PingGrid(double cellSize = 1.0, Statistic statistic = MeanDepth);
+
+  // Changing the cell size clears the grid.
+  void setCellSize(double cellSize);
+  double cellSize() const;
+  void setStatistic(Statistic statistic);
+  // Depths mapped to the ends of the colour scale. When minimum equals
+  // maximum, the range follows the soundings, in 5 m steps.
+  void setDepthRange(double minimum, double maximum);
+
+  void clear();
+
+  // Bins count soundings, depths are positive down.
+  void add(double const *east, double const *north, float const *depth, std::size_t count);
+
+  // Appends the tiles recoloured since the last call. Returns true if the
+  // grid was cleared meanwhile, in which case previously taken tiles are stale.
+  bool takeUpdated(std::vector<TileImage> &tiles);
+
+  // Area covered by a tile, in grid meters.
+  QRectF tileExtent(TileKey const &key) const;
+
+private:
+  struct Cell
+  {
+    float minimum;
+    float sum;
+    uint32_t count;
+  };
+
+  struct Tile
+  {
+    std::vector<Cell> cells;
+    bool changed = false;
+  };
+
+  void colourMap(TileKey const &key, Tile const &tile);
+  bool updateRange();
+
+  mutable QMutex m_mutex;
+  double m_cellSize;
+  Statistic m_statistic;
+  double m_fixedMinimum = 0.0;
+  double m_fixedMaximum = 0.0;
+
+  std::map<TileKey, Tile> m_tiles;
+  // depths and counts seen, for the automatic colour range
+  float m_minimumDepth;
+  float m_maximumDepth;
+  uint32_t m_maximumCount = 0;
+  // range the tiles are currently coloured with
+  double m_rangeMinimum = 0.0;
+  double m_rangeMaximum = 0.0;
+  uint32_t m_rangeCount = 0;
+
+  std::map<TileKey, QImage> m_updated;
+  bool m_cleared = false;
+};
+
+#endif
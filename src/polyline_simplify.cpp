@@ -0,0 +1,112 @@
+#include "polyline_simplify.h"
+#include <algorithm>
+#include <utility>
+#include <cmath>
+
+std::vector<std::size_t> simplifyPolyline(double const *x, double const *y, std::size_t count, double tolerance)
+{
+  std::vector<std::size_t> ret;
+  if(count < 3 || tolerance <= 0.0)
+  {
+    for(std::size_t i = 0; i < count; i++)
+      ret.push_back(i);
+    return ret;
+  }
+
+  std::vector<bool> keep(count, false);
+  keep[0] = true;
+  keep[count-1] = true;
+
+  // explicit stack so long tracks can't overflow the call stack
+  std::vector<std::pair<std::size_t, std::size_t> > segments;
+  segments.push_back(std::make_pair(std::size_t(0), count-1));
+  double tolerance2 = tolerance*tolerance;
+
+  while(!segments.empty())
+  {
+    std::size_t first = segments.back().first;
+    std::size_t last = segments.back().second;
+    segments.pop_back();
+    if(last-first < 2)
+      continue;
+
+    double dx = x[last]-x[first];
+    double dy = y[last]-y[first];
+    double length2 = dx*dx+dy*dy;
+
+    double max_distance2 = 0.0;
+    std::size_t farthest = first;
+    for(std::size_t i = first+1; i < last; i++)
+    {
+      double px = x[i]-x[first];
+      double py = y[i]-y[first];
+      double distance2;
+      if(length2 == 0.0)
+        distance2 = px*px+py*py;
+      else
+      {
+        double t = std::max(0.0, std::min(1.0, (px*dx+py*dy)/length2));
+        double ex = px-t*dx;
+        double ey = py-t*dy;
+        distance2 = ex*ex+ey*ey;
+      }
+      if(distance2 > max_distance2)
+      {
+        max_distance2 = distance2;
+        farthest = i;
+      }
+    }
+
+    if(max_distance2 > tolerance2)
+    {
+      keep[farthest] = true;
+      segments.push_back(std::make_pair(first, farthest));
+      segments.push_back(std::make_pair(farthest, last));
+    }
+  }
+
+  for(std::size_t i = 0; i < count; i++)
+    if(keep[i])
+      ret.push_back(i);
+  return ret;
+}
+
+void SimplifiedPolyline::setPoints(QPolygonF const &points)
+{
+  m_points = points;
+  m_bands.clear();
+}
+
+void SimplifiedPolyline::setLastPoint(QPointF const &point)
+{
+  if(m_points.isEmpty())
+    return;
+  m_points.back() = point;
+  // Simplification always keeps the last point.
+  for(auto &band: m_bands)
+    band.second.back() = point;
+}
+
+QPolygonF const &SimplifiedPolyline::simplified(double mapScale) const
+{
+  if(mapScale <= 0.0 || m_points.size() < 3)
+    return m_points;
+
+  int band = std::floor(std::log2(mapScale));
+  auto cached = m_bands.find(band);
+  if(cached != m_bands.end())
+    return cached->second;
+
+  std::vector<double> x(m_points.size()), y(m_points.size());
+  for(int i = 0; i < m_points.size(); i++)
+  {
+    x[i] = m_points[i].x();
+    y[i] = m_points[i].y();
+  }
+  double tolerance = 0.5/std::pow(2.0, band+1);
+
+  QPolygonF &ret = m_bands[band];
+  for(auto i: simplifyPolyline(x.data(), y.data(), x.size(), tolerance))
+    ret << m_points[i];
+  return ret;
+}
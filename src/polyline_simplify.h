@@ -0,0 +1,33 @@
+#ifndef CAMP_POLYLINE_SIMPLIFY_H
+#define CAMP_POLYLINE_SIMPLIFY_H
+
+#include <vector>
+#include <map>
+#include <cstddef>
+#include <QPolygonF>
+
+// Douglas-Peucker simplification. Returns the indices of the points to keep,
+// in order, always including the first and last point. No dropped point is
+// further than tolerance from the simplified line, in the units of x and y.
+std::vector<std::size_t> simplifyPolyline(double const *x, double const *y, std::size_t count, double tolerance);
+
+// Polyline in item coordinates with simplified copies cached per zoom band.
+// A band covers a factor of two in map scale and is simplified to half a
+// screen pixel at the band's largest scale, so it looks the same as the
+// full polyline anywhere in the band.
+class SimplifiedPolyline
+{
+public:
+  void setPoints(QPolygonF const &points);
+  // Moves the last point, the bands keep their simplification. For a
+  // track's provisional end, which stays close to the point before it.
+  void setLastPoint(QPointF const &point);
+  QPolygonF const &points() const {return m_points;}
+  QPolygonF const &simplified(double mapScale) const;
+
+private:
+  QPolygonF m_points;
+  mutable std::map<int, QPolygonF> m_bands;
+};
+
+#endif
@@ -0,0 +1,186 @@
+#include "pose_cache.h"
+#include <algorithm>
+#include <cmath>
+
+template<typename T> void PoseCache::Ring<T>::add(std::size_t capacity, double time, T const &value)
+{
+  if(m_count > 0 && time <= at(m_count-1).first)
+    return;
+  if(m_samples.size() < capacity)
+  {
+    m_samples.push_back(std::make_pair(time, value));
+    m_count++;
+    return;
+  }
+  // Full, the oldest sample makes way.
+  m_samples[m_start] = std::make_pair(time, value);
+  m_start = (m_start+1)%m_samples.size();
+}
+
+template<typename T> std::pair<double, T> const &PoseCache::Ring<T>::at(std::size_t i) const
+{
+  return m_samples[(m_start+i)%m_samples.size()];
+}
+
+template<typename T> bool PoseCache::Ring<T>::find(double time, std::pair<double, T> const *&before, std::pair<double, T> const *&after) const
+{
+  if(m_count == 0 || time < at(0).first || time > at(m_count-1).first)
+    return false;
+  // first sample at or after time
+  std::size_t low = 0;
+  std::size_t high = m_count-1;
+  while(low < high)
+  {
+    std::size_t middle = (low+high)/2;
+    if(at(middle).first < time)
+      low = middle+1;
+    else
+      high = middle;
+  }
+  after = &at(low);
+  before = (after->first == time || low == 0) ? after : &at(low-1);
+  return true;
+}
+
+template<typename T> bool PoseCache::Ring<T>::newest(std::pair<double, T> const *&sample) const
+{
+  if(m_count == 0)
+    return false;
+  sample = &at(m_count-1);
+  return true;
+}
+
+PoseCache::PoseCache(std::size_t capacity):m_capacity(std::max<std::size_t>(2, capacity))
+{
+}
+
+void PoseCache::addPosition(std::string const &key, double time, GeoPoint const &position)
+{
+  QMutexLocker lock(&m_mutex);
+  m_histories[key].positions.add(m_capacity, time, position);
+}
+
+void PoseCache::addHeading(std::string const &key, double time, double heading)
+{
+  heading = std::fmod(std::fmod(heading, 360.0)+360.0, 360.0);
+  QMutexLocker lock(&m_mutex);
+  m_histories[key].headings.add(m_capacity, time, heading);
+}
+
+void PoseCache::addMapPosition(std::string const &key, double time, QPointF const &position)
+{
+  QMutexLocker lock(&m_mutex);
+  m_histories[key].map_positions.add(m_capacity, time, position);
+}
+
+void PoseCache::setFixedPose(std::string const &key, double heading, QPointF const &mapPosition)
+{
+  QMutexLocker lock(&m_mutex);
+  History &history = m_histories[key];
+  history.fixed = true;
+  history.heading = std::fmod(std::fmod(heading, 360.0)+360.0, 360.0);
+  history.map_position = mapPosition;
+}
+
+bool PoseCache::position(std::string const &key, double time, GeoPoint &position) const
+{
+  QMutexLocker lock(&m_mutex);
+  auto history = m_histories.find(key);
+  if(history == m_histories.end())
+    return false;
+  std::pair<double, GeoPoint> const *before, *after;
+  if(!history->second.positions.find(time, before, after))
+    return false;
+  if(before == after)
+  {
+    position = before->second;
+    return true;
+  }
+  // Samples are close enough in time for latitude and longitude to be
+  // interpolated directly.
+  double t = (time-before->first)/(after->first-before->first);
+  position = GeoPoint(before->second.latitude()+t*(after->second.latitude()-before->second.latitude()), before->second.longitude()+t*(after->second.longitude()-before->second.longitude()), before->second.altitude()+t*(after->second.altitude()-before->second.altitude()));
+  return true;
+}
+
+bool PoseCache::heading(std::string const &key, double time, double &heading) const
+{
+  QMutexLocker lock(&m_mutex);
+  auto history = m_histories.find(key);
+  if(history == m_histories.end())
+    return false;
+  if(history->second.fixed)
+  {
+    heading = history->second.heading;
+    return true;
+  }
+  std::pair<double, double> const *before, *after;
+  if(!history->second.headings.find(time, before, after))
+    return false;
+  if(before == after)
+  {
+    heading = before->second;
+    return true;
+  }
+  // the short way around
+  double t = (time-before->first)/(after->first-before->first);
+  double turn = std::fmod(after->second-before->second+540.0, 360.0)-180.0;
+  heading = std::fmod(before->second+t*turn+360.0, 360.0);
+  return true;
+}
+
+bool PoseCache::mapPosition(std::string const &key, double time, QPointF &position) const
+{
+  QMutexLocker lock(&m_mutex);
+  auto history = m_histories.find(key);
+  if(history == m_histories.end())
+    return false;
+  if(history->second.fixed)
+  {
+    position = history->second.map_position;
+    return true;
+  }
+  std::pair<double, QPointF> const *before, *after;
+  if(!history->second.map_positions.find(time, before, after))
+    return false;
+  if(before == after)
+  {
+    position = before->second;
+    return true;
+  }
+  double t = (time-before->first)/(after->first-before->first);
+  position = before->second+t*(after->second-before->second);
+  return true;
+}
+
+bool PoseCache::newestPosition(std::string const &key, double &time, GeoPoint &position) const
+{
+  QMutexLocker lock(&m_mutex);
+  auto history = m_histories.find(key);
+  if(history == m_histories.end())
+    return false;
+  std::pair<double, GeoPoint> const *sample;
+  if(!history->second.positions.newest(sample))
+    return false;
+  time = sample->first;
+  position = sample->second;
+  return true;
+}
+
+void PoseCache::track(std::string const &key)
+{
+  QMutexLocker lock(&m_mutex);
+  m_tracked.insert(key);
+}
+
+std::vector<std::string> PoseCache::tracked() const
+{
+  QMutexLocker lock(&m_mutex);
+  return std::vector<std::string>(m_tracked.begin(), m_tracked.end());
+}
+
+void PoseCache::clear()
+{
+  QMutexLocker lock(&m_mutex);
+  m_histories.clear();
+}
@@ -0,0 +1,76 @@
+#ifndef CAMP_POSE_CACHE_H
+#define CAMP_POSE_CACHE_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <QMutex>
+#include <QPointF>
+#include "geopoint.h"
+
+// Recent positions and headings, by frame or by navigation source, so
+// poses can be looked up at a message's timestamp without going through
+// TF. Each key keeps a ring of samples in time order and lookups between
+// two samples are interpolated, found with a binary search. Samples older
+// than the newest one for a key are dropped. Can be used from any thread.
+class PoseCache
+{
+public:
+  explicit PoseCache(std::size_t capacity = 1024);
+
+  void addPosition(std::string const &key, double time, GeoPoint const &position);
+  // Heading in degrees, clockwise from north.
+  void addHeading(std::string const &key, double time, double heading);
+  // Position in map frame meters, east and north, for frames from TF.
+  void addMapPosition(std::string const &key, double time, QPointF const &position);
+  // A pose that holds at all times, for frames fixed to the map.
+  void setFixedPose(std::string const &key, double heading, QPointF const &mapPosition);
+
+  // False if the time is outside of the key's history.
+  bool position(std::string const &key, double time, GeoPoint &position) const;
+  bool heading(std::string const &key, double time, double &heading) const;
+  bool mapPosition(std::string const &key, double time, QPointF &position) const;
+  bool newestPosition(std::string const &key, double &time, GeoPoint &position) const;
+
+  // Frames whose headings are wanted, for whoever feeds the cache from TF.
+  void track(std::string const &key);
+  std::vector<std::string> tracked() const;
+
+  void clear();
+
+private:
+  template<typename T> class Ring
+  {
+  public:
+    void add(std::size_t capacity, double time, T const &value);
+    // Samples either side of time, the same one twice on an exact match.
+    bool find(double time, std::pair<double, T> const *&before, std::pair<double, T> const *&after) const;
+    bool newest(std::pair<double, T> const *&sample) const;
+
+  private:
+    std::pair<double, T> const &at(std::size_t i) const;
+
+    std::vector<std::pair<double, T> > m_samples;
+    std::size_t m_start = 0;
+    std::size_t m_count = 0;
+  };
+
+  struct History
+  {
+    Ring<GeoPoint> positions;
+    Ring<double> headings;
+    Ring<QPointF> map_positions;
+    bool fixed = false;
+    double heading = 0.0;
+    QPointF map_position;
+  };
+
+  std::size_t m_capacity;
+  std::map<std::string, History> m_histories;
+  std::set<std::string> m_tracked;
+  mutable QMutex m_mutex;
+};
+
+#endif
@@ -149,29 +149,10 @@ void ProjectView::mousePressEvent(QMouseEvent *event)
 
 void ProjectView::mouseMoveEvent(QMouseEvent *event)
 {
-    QString posText = QString::number(event->pos().x())+","+QString::number(event->pos().y());
-
-    QPointF transformedMouse = mapToScene(event->pos());
+    m_mousePosition = event->pos();
     BackgroundRaster *bg =  m_project->getBackgroundRaster();
-    BackgroundRaster *dr =  m_project->getDepthRaster();
     if(bg)
     {
-        QPointF projectedMouse = bg->pixelToProjectedPoint(transformedMouse);
-        posText += " Projected mouse: "+QString::number(projectedMouse.x(),'f')+","+QString::number(projectedMouse.y(),'f');
-        QGeoCoordinate llMouse = bg->unproject(projectedMouse);
-        posText += " WGS84: " + llMouse.toString(QGeoCoordinate::Degrees) + " (" + llMouse.toString(QGeoCoordinate::DegreesMinutesWithHemisphere) + ")";
-        
-        if(dr)
-        {
-            if(dr == bg)
-                posText += " Depth: " +QString::number(dr->getDepth(transformedMouse.x(),transformedMouse.y()));
-            else 
-            {
-                auto p = dr->geoToPixel(llMouse);
-                posText += " Depth: " +QString::number(dr->getDepth(p.x(),p.y()));
-            }
-        }
-        
         if(pendingSurveyPattern)
         {
             if(pendingSurveyPattern->hasSpacingLocation())
@@ -188,13 +169,60 @@ void ProjectView::mouseMoveEvent(QMouseEvent *event)
             pendingSurveyAreaWaypoint->setLocation(bg->pixelToGeo(mapToScene(event->pos())));
         }
         if(measuringTool)
-            measuringTool->setFinish(llMouse);
+            measuringTool->setFinish(bg->pixelToGeo(mapToScene(event->pos())));
     }
     
-    positionLabel->setText(posText);
+    positionLabel->setText(positionText(event->pos()));
     QGraphicsView::mouseMoveEvent(event);
 }
 
+QString ProjectView::positionText(QPoint const &pos) const
+{
+    QString posText = QString::number(pos.x())+","+QString::number(pos.y());
+
+    QPointF transformedMouse = mapToScene(pos);
+    BackgroundRaster *bg =  m_project->getBackgroundRaster();
+    BackgroundRaster *dr =  m_project->getDepthRaster();
+    if(bg)
+    {
+        QPointF projectedMouse = bg->pixelToProjectedPoint(transformedMouse);
+        posText += " Projected mouse: "+QString::number(projectedMouse.x(),'f')+","+QString::number(projectedMouse.y(),'f');
+        QGeoCoordinate llMouse = bg->unproject(projectedMouse);
+        posText += " WGS84: " + llMouse.toString(QGeoCoordinate::Degrees) + " (" + llMouse.toString(QGeoCoordinate::DegreesMinutesWithHemisphere) + ")";
+        
+        if(dr)
+        {
+            QPoint p = depthPixel(pos);
+            posText += " Depth: " +QString::number(dr->getDepth(p.x(),p.y()));
+            float cost = dr->getCost(p.x(),p.y());
+            if(cost > 0.0)
+                posText += " Cost: " +QString::number(cost,'f',2);
+        }
+    }
+    return posText;
+}
+
+QPoint ProjectView::depthPixel(QPoint const &pos) const
+{
+    QPointF transformedMouse = mapToScene(pos);
+    BackgroundRaster *bg =  m_project->getBackgroundRaster();
+    BackgroundRaster *dr =  m_project->getDepthRaster();
+    if(dr == bg)
+        return QPoint(transformedMouse.x(),transformedMouse.y());
+    QPointF p = dr->geoToPixel(bg->pixelToGeo(transformedMouse));
+    return QPoint(p.x(),p.y());
+}
+
+void ProjectView::updatePositionReadout(QRect const &pixels)
+{
+    // Soundings and radar returns keep changing the overlays under a still
+    // mouse.
+    if(!m_project->getBackgroundRaster() || !m_project->getDepthRaster() || !underMouse())
+        return;
+    if(pixels.contains(depthPixel(m_mousePosition)))
+        positionLabel->setText(positionText(m_mousePosition));
+}
+
 void ProjectView::mouseReleaseEvent(QMouseEvent *event)
 {
     if(event->button() == Qt::MiddleButton)
@@ -341,6 +369,19 @@ void ProjectView::beforeUpdateBackground()
 
 void ProjectView::updateBackground(BackgroundRaster* bg)
 {
+    BackgroundRaster *dr = m_project->getDepthRaster();
+    if(dr != m_depthRaster)
+    {
+        if(m_depthRaster)
+            disconnect(m_depthRaster, nullptr, this, nullptr);
+        m_depthRaster = dr;
+        if(m_depthRaster)
+        {
+            connect(m_depthRaster, &BackgroundRaster::depthChanged, this, &ProjectView::updatePositionReadout);
+            connect(m_depthRaster, &BackgroundRaster::costChanged, this, &ProjectView::updatePositionReadout);
+        }
+    }
+
     auto bgRect = bg->boundingRect();
     setSceneRect(bgRect.marginsAdded(QMarginsF(bgRect.width()*.75,bgRect.height()*.75,bgRect.width()*.75,bgRect.height()*.75)));
     if(m_savedCenter.isValid())
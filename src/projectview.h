@@ -3,6 +3,7 @@
 
 #include<QGraphicsView>
 #include <QGeoCoordinate>
+#include <QPointer>
 
 class QStatusBar;
 class QLabel;
@@ -49,6 +50,9 @@ protected:
     void mouseReleaseEvent(QMouseEvent *event) override;
     void contextMenuEvent(QContextMenuEvent *event) override;
 
+private slots:
+    void updatePositionReadout(QRect const &pixels);
+
 private:
     enum class MouseMode {pan, addWaypoint, addTrackline, addSurveyPattern, addSurveyArea};
     QStatusBar * statusBar;
@@ -67,6 +71,12 @@ private:
 
     QGeoCoordinate m_savedCenter;
 
+    QString positionText(QPoint const &pos) const;
+    // Depth raster pixel under a viewport position.
+    QPoint depthPixel(QPoint const &pos) const;
+    QPoint m_mousePosition;
+    QPointer<BackgroundRaster> m_depthRaster;
+
 };
 
 #endif // PROJECTVIEW_H
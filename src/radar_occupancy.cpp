@@ -0,0 +1,380 @@
+#include "radar_occupancy.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <QElapsedTimer>
+#include <QThread>
+
+namespace
+{
+  int floorDiv(int value, int divisor)
+  {
+    return value >= 0 ? value/divisor : -((-value+divisor-1)/divisor);
+  }
+
+  // Sectors waiting beyond this are dropped, oldest first.
+  const std::size_t maximumPending = 256;
+
+  // Log odds added for a cell with a return, or without one.
+  const float hitEvidence = 0.85f;
+  const float missEvidence = -0.4f;
+  const float maximumEvidence = 4.0f;
+
+  // Returns closer than this, in meters, are from the radar's own vessel
+  // or sea clutter.
+  const double blindRange = 50.0;
+
+  // Milliseconds between decay passes.
+  const unsigned long decayInterval = 1000;
+
+  // Smallest change in a cell's cost that is republished.
+  const float costResolution = 0.05f;
+}
+
+float OccupancyEvidence::evidenceLimit()
+{
+  return maximumEvidence;
+}
+
+float OccupancyEvidence::evidenceCost(float evidence)
+{
+  // Twice the probability of being occupied over a half, so open water
+  // and unknown cells cost nothing.
+  return evidence > 0.0f ? std::tanh(0.5f*evidence) : 0.0f;
+}
+
+void OccupancyEvidence::trace(Sector const &sector, QTransform const &mapToPixel, QSize const &rasterSize, int hitIntensity)
+{
+  TileKey currentKey;
+  Tile *current = nullptr;
+  auto update = [&](int x, int y, float evidence)
+  {
+    if(x < 0 || y < 0 || x >= rasterSize.width() || y >= rasterSize.height())
+      return;
+    TileKey key(floorDiv(x, TileSize), floorDiv(y, TileSize));
+    if(!current || key != currentKey)
+    {
+      current = &m_tiles[key].evidence;
+      if(current->empty())
+        current->assign(TileSize*TileSize, 0.0f);
+      currentKey = key;
+      m_dirty.insert(key);
+      m_lastTile = nullptr;
+    }
+    float &cell = (*current)[(y-key.second*TileSize)*TileSize+x-key.first*TileSize];
+    cell = std::max(-maximumEvidence, std::min(maximumEvidence, cell+evidence));
+  };
+
+  QPointF origin = mapToPixel.map(QPointF(sector.east, sector.north));
+  double sampleLength = sector.range/sector.samples;
+  int firstSample = std::min(sector.samples, int(std::ceil(blindRange/sampleLength)));
+  for(std::size_t row = 0; row < sector.bearings.size(); row++)
+  {
+    // one sample's step along the scanline, in pixels
+    double bearing = sector.bearings[row];
+    QPointF step = mapToPixel.map(QPointF(sector.east+std::sin(bearing)*sampleLength, sector.north+std::cos(bearing)*sampleLength))-origin;
+    uint8_t const *intensities = &sector.intensities[row*sector.samples];
+
+    // Each cell the scanline crosses is updated once, as a hit if any of
+    // its samples is.
+    int cellX = 0, cellY = 0;
+    bool haveCell = false;
+    bool cellHit = false;
+    for(int i = firstSample; i < sector.samples; i++)
+    {
+      QPointF p = origin+(i+0.5)*step;
+      int x = std::floor(p.x());
+      int y = std::floor(p.y());
+      if(!haveCell || x != cellX || y != cellY)
+      {
+        if(haveCell)
+          update(cellX, cellY, cellHit ? hitEvidence : missEvidence);
+        cellX = x;
+        cellY = y;
+        cellHit = false;
+        haveCell = true;
+      }
+      cellHit = cellHit || intensities[i] >= hitIntensity;
+    }
+    if(haveCell)
+      update(cellX, cellY, cellHit ? hitEvidence : missEvidence);
+  }
+}
+
+void OccupancyEvidence::decay(double seconds, double decayTime)
+{
+  float factor = std::exp(-seconds/decayTime);
+  for(auto t = m_tiles.begin(); t != m_tiles.end();)
+  {
+    bool empty = true;
+    for(auto &cell: t->second.evidence)
+    {
+      cell *= factor;
+      if(std::abs(cell) < 0.01f)
+        cell = 0.0f;
+      else
+        empty = false;
+    }
+    if(empty)
+    {
+      // Only tiles already published need removing there.
+      if(!t->second.published.empty())
+        m_removed.insert(t->first);
+      m_dirty.erase(t->first);
+      t = m_tiles.erase(t);
+    }
+    else
+    {
+      m_dirty.insert(t->first);
+      ++t;
+    }
+  }
+  m_lastTile = nullptr;
+}
+
+void OccupancyEvidence::takeChanges(std::map<TileKey, Tile> &changes)
+{
+  for(auto const &key: m_removed)
+    changes[key] = Tile();
+  m_removed.clear();
+  // Most tiles only change a little per pass, only those whose cost
+  // moved noticeably are taken.
+  for(auto const &key: m_dirty)
+  {
+    auto t = m_tiles.find(key);
+    if(t != m_tiles.end() && costMoved(t->second.evidence, t->second.published))
+    {
+      t->second.published = t->second.evidence;
+      changes[key] = t->second.published;
+    }
+  }
+  m_dirty.clear();
+}
+
+QRect OccupancyEvidence::apply(std::map<TileKey, Tile> &changes)
+{
+  QRect ret;
+  for(auto &t: changes)
+  {
+    if(t.second.empty())
+      m_tiles.erase(t.first);
+    else
+      m_tiles[t.first].evidence.swap(t.second);
+    ret |= QRect(t.first.first*TileSize, t.first.second*TileSize, TileSize, TileSize);
+  }
+  m_lastTile = nullptr;
+  return ret;
+}
+
+void OccupancyEvidence::clear()
+{
+  m_tiles.clear();
+  m_dirty.clear();
+  m_removed.clear();
+  m_lastTile = nullptr;
+}
+
+bool OccupancyEvidence::costMoved(Tile const &evidence, Tile const &published)
+{
+  if(published.empty())
+  {
+    for(auto cell: evidence)
+      if(evidenceCost(cell) >= costResolution)
+        return true;
+    return false;
+  }
+  for(std::size_t i = 0; i < evidence.size(); i++)
+    if(std::abs(evidenceCost(evidence[i])-evidenceCost(published[i])) >= costResolution)
+      return true;
+  return false;
+}
+
+OccupancyEvidence::Tile const *OccupancyEvidence::find(int x, int y, int &index) const
+{
+  TileKey key(floorDiv(x, TileSize), floorDiv(y, TileSize));
+  // Lookups come in runs over neighbouring cells, planners especially.
+  if(!m_lastTile || key != m_lastKey)
+  {
+    auto t = m_tiles.find(key);
+    if(t == m_tiles.end())
+      return nullptr;
+    m_lastKey = key;
+    m_lastTile = &t->second.evidence;
+  }
+  index = (y-key.second*TileSize)*TileSize+x-key.first*TileSize;
+  return m_lastTile;
+}
+
+float OccupancyEvidence::evidence(int x, int y) const
+{
+  int index;
+  Tile const *tile = find(x, y, index);
+  return tile ? (*tile)[index] : 0.0f;
+}
+
+float OccupancyEvidence::cost(int x, int y) const
+{
+  return evidenceCost(evidence(x, y));
+}
+
+QRect OccupancyEvidence::bounds() const
+{
+  QRect ret;
+  for(auto const &t: m_tiles)
+    ret |= QRect(t.first.first*TileSize, t.first.second*TileSize, TileSize, TileSize);
+  return ret;
+}
+
+RadarOccupancy::RadarOccupancy(QObject *parent):QObject(parent)
+{
+  connect(this, &RadarOccupancy::tilesReady, this, &RadarOccupancy::publish, Qt::QueuedConnection);
+  m_thread = QThread::create(std::bind(&RadarOccupancy::run, this));
+  m_thread->start();
+}
+
+RadarOccupancy::~RadarOccupancy()
+{
+  {
+    QMutexLocker lock(&m_mutex);
+    m_stop = true;
+    m_condition.wakeAll();
+  }
+  m_thread->wait();
+  delete m_thread;
+}
+
+void RadarOccupancy::setMapToPixel(QTransform const &mapToPixel, QSize const &rasterSize)
+{
+  {
+    QMutexLocker lock(&m_mutex);
+    if(m_haveMapToPixel && mapToPixel == m_mapToPixel && rasterSize == m_rasterSize)
+      return;
+    m_mapToPixel = mapToPixel;
+    m_rasterSize = rasterSize;
+    m_haveMapToPixel = true;
+    m_generation++;
+    m_pending.clear();
+    m_ready.clear();
+  }
+  QRect dropped = bounds();
+  m_published.clear();
+  if(!dropped.isNull())
+    emit costChanged(dropped);
+}
+
+void RadarOccupancy::clearMapToPixel()
+{
+  {
+    QMutexLocker lock(&m_mutex);
+    if(!m_haveMapToPixel)
+      return;
+    m_haveMapToPixel = false;
+    m_generation++;
+    m_pending.clear();
+    m_ready.clear();
+  }
+  QRect dropped = bounds();
+  m_published.clear();
+  if(!dropped.isNull())
+    emit costChanged(dropped);
+}
+
+void RadarOccupancy::setHitIntensity(int intensity)
+{
+  QMutexLocker lock(&m_mutex);
+  m_hitIntensity = std::max(1, std::min(15, intensity));
+}
+
+void RadarOccupancy::setDecayTime(double seconds)
+{
+  QMutexLocker lock(&m_mutex);
+  m_decayTime = std::max(1.0, seconds);
+}
+
+void RadarOccupancy::addSector(double east, double north, double range, std::vector<float> bearings, std::vector<uint8_t> intensities, int samples)
+{
+  if(samples <= 0 || range <= 0.0 || intensities.size() < bearings.size()*samples)
+    return;
+  QMutexLocker lock(&m_mutex);
+  if(!m_haveMapToPixel)
+    return;
+  if(m_pending.size() >= maximumPending)
+    m_pending.pop_front();
+  m_pending.push_back(OccupancyEvidence::Sector{east, north, range, std::move(bearings), std::move(intensities), samples});
+  m_condition.wakeOne();
+}
+
+void RadarOccupancy::run()
+{
+  QElapsedTimer sinceDecay;
+  sinceDecay.start();
+  while(true)
+  {
+    std::deque<OccupancyEvidence::Sector> sectors;
+    QTransform mapToPixel;
+    QSize rasterSize;
+    int hitIntensity;
+    double decayTime;
+    uint64_t generation;
+    {
+      QMutexLocker lock(&m_mutex);
+      // Evidence decays even when no sectors arrive.
+      if(m_pending.empty() && !m_stop)
+        m_condition.wait(&m_mutex, decayInterval);
+      if(m_stop)
+        return;
+      sectors.swap(m_pending);
+      mapToPixel = m_mapToPixel;
+      rasterSize = m_rasterSize;
+      hitIntensity = m_hitIntensity;
+      decayTime = m_decayTime;
+      generation = m_generation;
+    }
+    if(generation != m_workerGeneration)
+    {
+      m_evidence.clear();
+      m_workerGeneration = generation;
+    }
+
+    for(auto const &sector: sectors)
+      m_evidence.trace(sector, mapToPixel, rasterSize, hitIntensity);
+    if(sinceDecay.elapsed() >= qint64(decayInterval))
+      m_evidence.decay(sinceDecay.restart()/1000.0, decayTime);
+
+    std::map<TileKey, Tile> changed;
+    m_evidence.takeChanges(changed);
+    if(changed.empty())
+      continue;
+    {
+      QMutexLocker lock(&m_mutex);
+      // The mapping changed while tracing, these cells are stale.
+      if(generation != m_generation)
+        continue;
+      for(auto &t: changed)
+        m_ready[t.first].swap(t.second);
+    }
+    emit tilesReady();
+  }
+}
+
+void RadarOccupancy::publish()
+{
+  std::map<TileKey, Tile> ready;
+  {
+    QMutexLocker lock(&m_mutex);
+    ready.swap(m_ready);
+  }
+  QRect dirty = m_published.apply(ready);
+  if(!dirty.isNull())
+    emit costChanged(dirty);
+}
+
+float RadarOccupancy::cost(int x, int y) const
+{
+  return m_published.cost(x, y);
+}
+
+QRect RadarOccupancy::bounds() const
+{
+  return m_published.bounds();
+}
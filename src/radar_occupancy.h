@@ -0,0 +1,168 @@
+#ifndef CAMP_RADAR_OCCUPANCY_H
+#define CAMP_RADAR_OCCUPANCY_H
+
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+#include <cstdint>
+#include <QObject>
+#include <QMutex>
+#include <QRect>
+#include <QSize>
+#include <QTransform>
+#include <QWaitCondition>
+
+class QThread;
+
+// Evidence of raster pixels being occupied, as log odds in square tiles
+// allocated on first use. Each cell a scanline crosses gains evidence if a
+// return in it is strong enough, and loses some otherwise. Evidence decays
+// with time, so obstacles that move away clear. Tiles whose cost changed
+// noticeably are collected for publishing to another grid, the one lookups
+// are served from. Not thread safe.
+class OccupancyEvidence
+{
+public:
+  static const int TileSize = 64;
+
+  typedef std::pair<int,int> TileKey;
+  // log odds of each cell being occupied, 0 when unknown
+  typedef std::vector<float> Tile;
+
+  // A sector seen by a radar at east, north in map frame meters. Each
+  // scanline has a bearing, in radians clockwise from north, and samples
+  // 4 bit intensities out to range meters, row after row in intensities.
+  struct Sector
+  {
+    double east;
+    double north;
+    double range;
+    std::vector<float> bearings;
+    std::vector<uint8_t> intensities;
+    int samples;
+  };
+
+  // Most evidence a cell can hold either way, so it can change its mind.
+  static float evidenceLimit();
+  // From 0 for unknown cells or open water, to 1 for cells with returns
+  // seen consistently.
+  static float evidenceCost(float evidence);
+
+  // Traces a sector's scanlines across the cells of a raster of the given
+  // size. Returns of at least hitIntensity count as hits.
+  void trace(Sector const &sector, QTransform const &mapToPixel, QSize const &rasterSize, int hitIntensity);
+  // Decays evidence by seconds, it falls to about a third in decayTime.
+  // Tiles left without evidence are removed.
+  void decay(double seconds, double decayTime);
+  // Moves the tiles whose cost moved noticeably since they were last taken
+  // into changes, along with tiles removed since, as empty tiles.
+  void takeChanges(std::map<TileKey, Tile> &changes);
+  // Installs changes taken from another grid, returns the pixels they cover.
+  QRect apply(std::map<TileKey, Tile> &changes);
+  void clear();
+
+  float evidence(int x, int y) const;
+  float cost(int x, int y) const;
+  // Area covered by tiles, in raster pixels.
+  QRect bounds() const;
+  std::size_t tileCount() const {return m_tiles.size();}
+
+private:
+  struct Entry
+  {
+    Tile evidence;
+    // evidence as last taken, empty if never
+    Tile published;
+  };
+
+  // True if a cell's cost moved enough since the tile was published to be
+  // worth publishing again.
+  static bool costMoved(Tile const &evidence, Tile const &published);
+  // Tile holding x, y and the cell's index in it, null if there's none.
+  Tile const *find(int x, int y, int &index) const;
+
+  std::map<TileKey, Entry> m_tiles;
+  std::set<TileKey> m_dirty;
+  std::set<TileKey> m_removed;
+  mutable TileKey m_lastKey;
+  mutable Tile const *m_lastTile = nullptr;
+};
+
+// Obstacles seen by radar, accumulated on the cells of a depth raster so
+// planners can look them up next to the raster's depths. Sectors are
+// queued from any thread and traced into OccupancyEvidence on a worker
+// thread. Tiles whose cost changed noticeably since they were last
+// published are handed to the GUI thread, where lookups are served
+// without locking, and costChanged() reports the raster pixels they cover.
+class RadarOccupancy: public QObject
+{
+  Q_OBJECT
+public:
+  static const int TileSize = OccupancyEvidence::TileSize;
+
+  explicit RadarOccupancy(QObject *parent = nullptr);
+  ~RadarOccupancy();
+
+  // Maps map frame coordinates, in meters, to raster pixels, for a raster
+  // of the given size. Changing it drops everything accumulated so far.
+  void setMapToPixel(QTransform const &mapToPixel, QSize const &rasterSize);
+  void clearMapToPixel();
+
+  // Returns of at least this 4 bit intensity count as hits.
+  void setHitIntensity(int intensity);
+  // Seconds for evidence to decay to about a third.
+  void setDecayTime(double seconds);
+
+  // Queues a sector seen by a radar at east, north in map frame meters, as
+  // described by OccupancyEvidence::Sector. Can be called from any thread.
+  void addSector(double east, double north, double range, std::vector<float> bearings, std::vector<uint8_t> intensities, int samples);
+
+  // Cost of a raster pixel, from 0 where nothing or open water was seen,
+  // to 1 where returns are seen consistently. GUI thread only.
+  float cost(int x, int y) const;
+
+  // Bounds of the area with evidence, in raster pixels.
+  QRect bounds() const;
+
+signals:
+  // Raster pixels whose cost changed, emitted on the GUI thread.
+  void costChanged(QRect const &pixels);
+
+  // Emitted by the worker when tiles are ready to publish.
+  void tilesReady();
+
+private slots:
+  void publish();
+
+private:
+  typedef OccupancyEvidence::TileKey TileKey;
+  typedef OccupancyEvidence::Tile Tile;
+
+  void run();
+
+  QThread *m_thread;
+  QMutex m_mutex;
+  QWaitCondition m_condition;
+  bool m_stop = false;
+
+  // guarded by m_mutex
+  std::deque<OccupancyEvidence::Sector> m_pending;
+  QTransform m_mapToPixel;
+  QSize m_rasterSize;
+  bool m_haveMapToPixel = false;
+  uint64_t m_generation = 0;
+  int m_hitIntensity = 8;
+  double m_decayTime = 60.0;
+  // empty tiles are removed
+  std::map<TileKey, Tile> m_ready;
+
+  // worker only
+  OccupancyEvidence m_evidence;
+  uint64_t m_workerGeneration = 0;
+
+  // GUI thread only
+  OccupancyEvidence m_published;
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "radar_scan_converter.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <QMutex>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+std::shared_ptr<RadarScanConverter::Lookup const> RadarScanConverter::lookup(int size, int binCount)
+{
+  static QMutex mutex;
+  static std::map<std::pair<int,int>, std::weak_ptr<Lookup const> > lookups;
+
+  QMutexLocker lock(&mutex);
+  auto key = std::make_pair(size, binCount);
+  std::shared_ptr<Lookup const> ret = lookups[key].lock();
+  if(ret)
+    return ret;
+
+  // Pixels are sorted into bins with a counting sort, which leaves each
+  // bin's pixels in scanline order.
+  std::shared_ptr<Lookup> table(new Lookup);
+  double half = size/2.0;
+  std::vector<int> pixelBins(size*size, -1);
+  std::vector<uint16_t> pixelRanges(size*size, 0);
+  table->binStart.assign(binCount+1, 0);
+  for(int y = 0; y < size; y++)
+    for(int x = 0; x < size; x++)
+    {
+      double dx = x+0.5-half;
+      double dy = half-(y+0.5);
+      double r = std::sqrt(dx*dx+dy*dy)/half;
+      if(r >= 1.0)
+        continue;
+      double theta = std::atan2(dx, dy);
+      if(theta < 0.0)
+        theta += 2.0*M_PI;
+      int bin = std::min(binCount-1, int(theta*binCount/(2.0*M_PI)));
+      pixelBins[y*size+x] = bin;
+      pixelRanges[y*size+x] = uint16_t(r*65536.0);
+      table->binStart[bin+1]++;
+    }
+  for(int b = 0; b < binCount; b++)
+    table->binStart[b+1] += table->binStart[b];
+  table->pixels.resize(table->binStart[binCount]);
+  table->ranges.resize(table->binStart[binCount]);
+  std::vector<uint32_t> next(table->binStart.begin(), table->binStart.end()-1);
+  for(int i = 0; i < size*size; i++)
+    if(pixelBins[i] >= 0)
+    {
+      uint32_t slot = next[pixelBins[i]]++;
+      table->pixels[slot] = i;
+      table->ranges[slot] = pixelRanges[i];
+    }
+
+  lookups[key] = table;
+  return table;
+}
+
+RadarScanConverter::RadarScanConverter(int size, int binCount):m_size(size),m_binCount(binCount),m_lookup(lookup(size, binCount)),m_image(size, size, QImage::Format_ARGB32_Premultiplied)
+{
+  m_image.fill(0);
+}
+
+int RadarScanConverter::size() const
+{
+  return m_size;
+}
+
+int RadarScanConverter::binCount() const
+{
+  return m_binCount;
+}
+
+QImage const &RadarScanConverter::image() const
+{
+  return m_image;
+}
+
+void RadarScanConverter::clear()
+{
+  m_image.fill(0);
+}
+
+void RadarScanConverter::binRange(double angle1, double angle2, int &first, int &count) const
+{
+  double binWidth = 2.0*M_PI/m_binCount;
+  double span = std::fmod(angle2-angle1, 2.0*M_PI);
+  if(span < 0.0)
+    span += 2.0*M_PI;
+  double start = std::fmod(angle1, 2.0*M_PI);
+  if(start < 0.0)
+    start += 2.0*M_PI;
+  first = int(std::floor(start/binWidth))%m_binCount;
+  count = std::min(m_binCount, int(std::floor((start+span)/binWidth))-int(std::floor(start/binWidth))+1);
+}
+
+double RadarScanConverter::binAngle(int bin) const
+{
+  return (bin+0.5)*2.0*M_PI/m_binCount;
+}
+
+void RadarScanConverter::drawBin(int bin, uint8_t const *spoke, int sampleCount, QRgb const *palette)
+{
+  QRgb *pixels = reinterpret_cast<QRgb*>(m_image.bits());
+  uint32_t end = m_lookup->binStart[bin+1];
+  for(uint32_t i = m_lookup->binStart[bin]; i < end; i++)
+    pixels[m_lookup->pixels[i]] = palette[spoke[(uint32_t(m_lookup->ranges[i])*sampleCount)>>16]];
+}
+
+void RadarScanConverter::clearBin(int bin)
+{
+  QRgb *pixels = reinterpret_cast<QRgb*>(m_image.bits());
+  uint32_t end = m_lookup->binStart[bin+1];
+  for(uint32_t i = m_lookup->binStart[bin]; i < end; i++)
+    pixels[m_lookup->pixels[i]] = 0;
+}
+
+void RadarScanConverter::expandIntensities(uint8_t const *intensities, int count, uint8_t *spoke)
+{
+  int i = 0;
+#ifdef __SSE2__
+  // Shifting 16 bit lanes carries bits from each low byte into the high
+  // one, the mask drops them and leaves what the byte wise multiply gives.
+  __m128i const mask = _mm_set1_epi8(char(0xf0));
+  for(; i+16 <= count; i += 16)
+  {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(intensities+i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(spoke+i), _mm_and_si128(_mm_slli_epi16(v, 4), mask));
+  }
+#endif
+  for(; i < count; i++)
+    spoke[i] = intensities[i]*16;
+}
@@ -0,0 +1,58 @@
+#ifndef CAMP_RADAR_SCAN_CONVERTER_H
+#define CAMP_RADAR_SCAN_CONVERTER_H
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <QImage>
+
+// Draws polar radar data into a square, north up image on the CPU. The
+// image's inscribed circle is the radar's range. Every pixel inside it is
+// assigned, once, to one of binCount() angular bins along with its distance
+// from the center, so drawing spokes only visits the pixels they cover,
+// with no trigonometry. The lookup tables only depend on the image size and
+// are shared by all converters of that size.
+class RadarScanConverter
+{
+public:
+  explicit RadarScanConverter(int size = 2048, int binCount = 4096);
+
+  int size() const;
+  int binCount() const;
+
+  QImage const &image() const;
+  void clear();
+
+  // First bin and number of bins spanned by the angles from angle1 to
+  // angle2, in radians clockwise from north.
+  void binRange(double angle1, double angle2, int &first, int &count) const;
+  // Angle of a bin's center, in radians.
+  double binAngle(int bin) const;
+
+  // Fills a bin's pixels from one spoke of samples, mapped to colours
+  // through a 256 entry palette. Samples run from the center outwards.
+  void drawBin(int bin, uint8_t const *spoke, int sampleCount, QRgb const *palette);
+  void clearBin(int bin);
+
+  // Stretches 4 bit radar intensities to 8 bits, as spokes for drawBin.
+  static void expandIntensities(uint8_t const *intensities, int count, uint8_t *spoke);
+
+private:
+  struct Lookup
+  {
+    // pixels of bin b are pixels[binStart[b]] to pixels[binStart[b+1]-1]
+    std::vector<uint32_t> binStart;
+    std::vector<uint32_t> pixels;
+    // distance from the center, as a fraction of the radius, in 1/65536ths
+    std::vector<uint16_t> ranges;
+  };
+
+  static std::shared_ptr<Lookup const> lookup(int size, int binCount);
+
+  int m_size;
+  int m_binCount;
+  std::shared_ptr<Lookup const> m_lookup;
+  QImage m_image;
+};
+
+#endif
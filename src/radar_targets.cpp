@@ -0,0 +1,267 @@
+#include "radar_targets.h"
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+namespace
+{
+  // Share of a track's prediction error corrected for in position, and in
+  // velocity, by each sweep that sees it.
+  const double positionGain = 0.5;
+  const double velocityGain = 0.2;
+
+  struct Accumulator
+  {
+    double weight = 0.0;
+    double east = 0.0;
+    double north = 0.0;
+    double min_east = 0.0;
+    double max_east = 0.0;
+    double min_north = 0.0;
+    double max_north = 0.0;
+    int cells = 0;
+
+    void add(QPointF const &p)
+    {
+      if(cells == 0)
+      {
+        min_east = max_east = p.x();
+        min_north = max_north = p.y();
+        return;
+      }
+      min_east = std::min(min_east, p.x());
+      max_east = std::max(max_east, p.x());
+      min_north = std::min(min_north, p.y());
+      max_north = std::max(max_north, p.y());
+    }
+  };
+}
+
+int RadarBlobExtractor::find(int run)
+{
+  while(m_runs[run].parent != run)
+  {
+    m_runs[run].parent = m_runs[m_runs[run].parent].parent;
+    run = m_runs[run].parent;
+  }
+  return run;
+}
+
+void RadarBlobExtractor::join(int a, int b)
+{
+  a = find(a);
+  b = find(b);
+  if(a < b)
+    m_runs[b].parent = a;
+  else if(b < a)
+    m_runs[a].parent = b;
+}
+
+void RadarBlobExtractor::joinOverlapping(int first1, int last1, int first2, int last2)
+{
+  // Runs are in order along both spokes, those touching end to end or
+  // diagonally are neighbours.
+  int i = first1;
+  int j = first2;
+  while(i < last1 && j < last2)
+  {
+    Run const &a = m_runs[i];
+    Run const &b = m_runs[j];
+    if(a.end+1 < b.start)
+      i++;
+    else if(b.end+1 < a.start)
+      j++;
+    else
+    {
+      join(i, j);
+      if(a.end < b.end)
+        i++;
+      else
+        j++;
+    }
+  }
+}
+
+void RadarBlobExtractor::extract(uint8_t const *spokes, int stride, uint16_t const *samples, int binCount, double range, RadarTargetParameters const &parameters, std::vector<RadarBlob> &blobs)
+{
+  blobs.clear();
+  if(binCount <= 0 || stride <= 0 || range <= 0.0)
+    return;
+  if(int(m_sines.size()) != binCount)
+  {
+    m_sines.resize(binCount);
+    m_cosines.resize(binCount);
+    for(int b = 0; b < binCount; b++)
+    {
+      double angle = (b+0.5)*2.0*M_PI/binCount;
+      m_sines[b] = std::sin(angle);
+      m_cosines[b] = std::cos(angle);
+    }
+  }
+  uint8_t level = std::max(1, std::min(15, parameters.threshold))*16;
+
+  // Runs of samples at or above the threshold, in stride units so spokes
+  // of different lengths line up.
+  m_runs.clear();
+  m_spokeStart.assign(binCount+1, 0);
+  for(int b = 0; b < binCount; b++)
+  {
+    m_spokeStart[b] = m_runs.size();
+    int count = std::min<int>(samples[b], stride);
+    if(count == 0)
+      continue;
+    uint8_t const *spoke = spokes+std::size_t(b)*stride;
+    int i = std::min(count, int(std::ceil(parameters.blind_range*count/range)));
+    while(i < count)
+    {
+      if(spoke[i] < level)
+      {
+        i++;
+        continue;
+      }
+      int start = i;
+      while(i < count && spoke[i] >= level)
+        i++;
+      int index = m_runs.size();
+      m_runs.push_back(Run{start*stride/count, std::max(start*stride/count, i*stride/count-1), index});
+    }
+  }
+  m_spokeStart[binCount] = m_runs.size();
+  if(m_runs.empty())
+    return;
+
+  for(int b = 1; b < binCount; b++)
+    joinOverlapping(m_spokeStart[b-1], m_spokeStart[b], m_spokeStart[b], m_spokeStart[b+1]);
+  if(binCount > 1)
+    joinOverlapping(m_spokeStart[binCount-1], m_spokeStart[binCount], m_spokeStart[0], m_spokeStart[1]);
+
+  // Sums for each blob, kept at its root run.
+  std::vector<Accumulator> sums(m_runs.size());
+  for(int b = 0; b < binCount; b++)
+  {
+    int count = std::min<int>(samples[b], stride);
+    if(m_spokeStart[b] == m_spokeStart[b+1])
+      continue;
+    uint8_t const *spoke = spokes+std::size_t(b)*stride;
+    double sampleLength = range/count;
+    QPointF direction(m_sines[b], m_cosines[b]);
+    for(int r = m_spokeStart[b]; r < m_spokeStart[b+1]; r++)
+    {
+      // back from stride units to this spoke's samples
+      int first = (m_runs[r].start*count+stride-1)/stride;
+      int last = std::max(first, std::min(count-1, ((m_runs[r].end+1)*count+stride-1)/stride-1));
+      double weight = 0.0;
+      double weighted_range = 0.0;
+      for(int i = first; i <= last; i++)
+      {
+        weight += spoke[i];
+        weighted_range += spoke[i]*(i+0.5)*sampleLength;
+      }
+      Accumulator &sum = sums[find(r)];
+      sum.add(direction*(first*sampleLength));
+      sum.cells++;
+      sum.add(direction*((last+1)*sampleLength));
+      sum.cells += last-first;
+      sum.weight += weight;
+      sum.east += direction.x()*weighted_range;
+      sum.north += direction.y()*weighted_range;
+    }
+  }
+
+  for(auto const &sum: sums)
+  {
+    if(sum.cells < parameters.min_cells || sum.weight <= 0.0)
+      continue;
+    double extent = std::max(sum.max_east-sum.min_east, sum.max_north-sum.min_north);
+    if(extent > parameters.max_extent)
+      continue;
+    RadarBlob blob;
+    blob.position = QPointF(sum.east/sum.weight, sum.north/sum.weight);
+    blob.extent = extent;
+    blob.cells = sum.cells;
+    blobs.push_back(blob);
+  }
+}
+
+void RadarTracker::update(double time, std::vector<RadarBlob> const &blobs, RadarTargetParameters const &parameters)
+{
+  // Blobs go to the nearest predictions first.
+  std::vector<QPointF> predictions;
+  std::vector<std::tuple<double, int, int> > pairs;
+  for(int t = 0; t < int(m_tracks.size()); t++)
+  {
+    RadarTarget const &track = m_tracks[t];
+    predictions.push_back(track.position+track.velocity*(time-track.time));
+    for(int b = 0; b < int(blobs.size()); b++)
+    {
+      QPointF d = blobs[b].position-predictions.back();
+      double distance = std::sqrt(d.x()*d.x()+d.y()*d.y());
+      if(distance <= parameters.gate)
+        pairs.push_back(std::make_tuple(distance, t, b));
+    }
+  }
+  std::sort(pairs.begin(), pairs.end());
+
+  std::vector<char> track_matched(m_tracks.size(), 0);
+  std::vector<char> blob_matched(blobs.size(), 0);
+  for(auto const &pair: pairs)
+  {
+    int t = std::get<1>(pair);
+    int b = std::get<2>(pair);
+    if(track_matched[t] || blob_matched[b])
+      continue;
+    track_matched[t] = 1;
+    blob_matched[b] = 1;
+    RadarTarget &track = m_tracks[t];
+    double dt = time-track.time;
+    QPointF residual = blobs[b].position-predictions[t];
+    track.position = predictions[t]+positionGain*residual;
+    if(dt > 0.0)
+      track.velocity += velocityGain*residual/dt;
+    track.extent = blobs[b].extent;
+    track.time = time;
+    track.hits++;
+    track.misses = 0;
+  }
+
+  // Tentative tracks go at their first miss, confirmed ones coast for a
+  // few sweeps.
+  std::vector<RadarTarget> tracks;
+  for(int t = 0; t < int(m_tracks.size()); t++)
+  {
+    RadarTarget track = m_tracks[t];
+    if(!track_matched[t])
+    {
+      track.misses++;
+      if(track.misses > parameters.max_misses || track.hits < parameters.confirm_hits)
+        continue;
+    }
+    tracks.push_back(track);
+  }
+  for(int b = 0; b < int(blobs.size()); b++)
+    if(!blob_matched[b])
+    {
+      RadarTarget track;
+      track.id = m_nextId++;
+      track.position = blobs[b].position;
+      track.extent = blobs[b].extent;
+      track.time = time;
+      track.hits = 1;
+      tracks.push_back(track);
+    }
+  m_tracks.swap(tracks);
+}
+
+std::vector<RadarTarget> RadarTracker::confirmed(RadarTargetParameters const &parameters) const
+{
+  std::vector<RadarTarget> ret;
+  for(auto const &track: m_tracks)
+    if(track.hits >= parameters.confirm_hits)
+      ret.push_back(track);
+  return ret;
+}
+
+void RadarTracker::clear()
+{
+  m_tracks.clear();
+}
@@ -0,0 +1,104 @@
+#ifndef CAMP_RADAR_TARGETS_H
+#define CAMP_RADAR_TARGETS_H
+
+#include <vector>
+#include <cstdint>
+#include <QPointF>
+
+// Tuning for radar target extraction and tracking.
+struct RadarTargetParameters
+{
+  // Samples of at least this 4 bit intensity are part of a target.
+  int threshold = 8;
+  // Blobs with fewer samples are noise.
+  int min_cells = 4;
+  // Blobs wider than this, in meters, are land or clutter.
+  double max_extent = 150.0;
+  // Returns closer than this, in meters, are ignored.
+  double blind_range = 50.0;
+  // Farthest, in meters, a blob can be from a track's prediction to
+  // update it.
+  double gate = 50.0;
+  // Sweeps a track needs to be seen before it's reported, and can be
+  // missed before it's dropped.
+  int confirm_hits = 3;
+  int max_misses = 3;
+};
+
+// A group of neighbouring returns in one turn of spokes.
+struct RadarBlob
+{
+  // intensity weighted centroid, in meters east and north of the radar
+  QPointF position;
+  // widest side of the blob's bounding box, in meters
+  double extent = 0.0;
+  int cells = 0;
+};
+
+// Finds blobs in a turn of north up polar spokes. Samples at or above the
+// threshold are gathered into runs along each spoke, and runs overlapping
+// runs of the previous spoke are joined with a union find, so each sample
+// is visited once. The first and last spokes are neighbours. Scratch space
+// is kept between calls, so each radar should have its own extractor.
+class RadarBlobExtractor
+{
+public:
+  // spokes holds binCount spokes of stride samples each, 8 bit
+  // intensities from the center outwards, spoke b at angle
+  // (b+0.5)*2*pi/binCount clockwise from north. samples gives each spoke's
+  // length, 0 for spokes without current returns. All spokes cover range
+  // meters.
+  void extract(uint8_t const *spokes, int stride, uint16_t const *samples, int binCount, double range, RadarTargetParameters const &parameters, std::vector<RadarBlob> &blobs);
+
+private:
+  struct Run
+  {
+    int start;
+    int end;
+    int parent;
+  };
+
+  int find(int run);
+  void join(int a, int b);
+  void joinOverlapping(int first1, int last1, int first2, int last2);
+
+  std::vector<Run> m_runs;
+  // index of each spoke's first run, and one past the last spoke's
+  std::vector<int> m_spokeStart;
+  std::vector<double> m_sines;
+  std::vector<double> m_cosines;
+};
+
+// A tracked radar target, in map frame meters.
+struct RadarTarget
+{
+  int id = 0;
+  QPointF position;
+  // meters per second
+  QPointF velocity;
+  double extent = 0.0;
+  // seconds, of the last sweep that saw it
+  double time = 0.0;
+  int hits = 0;
+  int misses = 0;
+};
+
+// Follows blob centroids from sweep to sweep with nearest neighbour
+// association and an alpha beta filter for position and velocity.
+class RadarTracker
+{
+public:
+  // Blobs seen by the sweep ending at time, already in map frame meters.
+  void update(double time, std::vector<RadarBlob> const &blobs, RadarTargetParameters const &parameters);
+
+  // Tracks seen often enough to be reported.
+  std::vector<RadarTarget> confirmed(RadarTargetParameters const &parameters) const;
+
+  void clear();
+
+private:
+  std::vector<RadarTarget> m_tracks;
+  int m_nextId = 1;
+};
+
+#endif
@@ -1,141 +1,151 @@
 #include "radardisplay.h"
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include "autonomousvehicleproject.h"
 #include "roslink.h"
-#include <QOffscreenSurface>
-#include <QOpenGLShader>
+#include <QElapsedTimer>
 #include <QPainter>
-#include <QOpenGLFramebufferObject>
+#include <QRunnable>
 #include <QThread>
-#include <tf2/utils.h>
+#include "pose_cache.h"
+#include "radar_occupancy.h"
 
+namespace
+{
+  // Spokes fade out in this many steps, each one redraws them.
+  const int fadeSteps = 16;
+
+  // Seconds a spoke stays on screen after its last update.
+  const double persistence = 2.0;
+
+  // Samples kept per spoke.
+  const int maxSamples = 1024;
+
+  // Milliseconds between renders. The interval grows with the time a
+  // render takes, so a busy machine gets fewer, larger updates.
+  const qint64 minimumRenderInterval = 33;
+  const qint64 maximumRenderInterval = 250;
+
+  // Milliseconds between attempts at a heading for waiting sectors.
+  const qint64 headingRetryInterval = 50;
+
+  // Bins drawn by each worker job.
+  const int binsPerJob = 256;
+
+  class Job: public QRunnable
+  {
+  public:
+    explicit Job(std::function<void()> const &job):m_job(job)
+    {}
+
+    void run() override
+    {
+      m_job();
+    }
+
+  private:
+    std::function<void()> m_job;
+  };
+}
 
 RadarDisplay::RadarDisplay(ROSLink* parent): QObject(parent), GeoGraphicsItem(parent)
 {
+  m_palette.assign(256, 0);
+  m_workers.setMaxThreadCount(std::max(1, std::min(4, QThread::idealThreadCount()/2)));
+  setFlag(QGraphicsItem::ItemSendsScenePositionChanges);
   m_radarImageThread = QThread::create(std::bind(&RadarDisplay::updateRadarImage, this));
   m_radarImageThread->start();
 }
 
-void RadarDisplay::setTF2Buffer(tf2_ros::Buffer* buffer)
+RadarDisplay::~RadarDisplay()
+{
+  {
+    QMutexLocker lock(&m_new_sectors_mutex);
+    m_stop = true;
+    m_render_condition.wakeAll();
+  }
+  m_radarImageThread->wait();
+  delete m_radarImageThread;
+  m_workers.waitForDone();
+}
+
+void RadarDisplay::setPoseCache(PoseCache* cache)
 {
-    m_tf_buffer = buffer;
+    m_pose_cache = cache;
 }
 
-void RadarDisplay::setMapFrame(std::string mapFrame)
+void RadarDisplay::setOccupancy(RadarOccupancy* occupancy)
 {
-    m_mapFrame = mapFrame;
+    m_occupancy = occupancy;
 }
 
 void RadarDisplay::setPixelSize(double s)
 {
-    m_pixel_size = s;
+    prepareGeometryChange();
+    {
+        QMutexLocker lock(&m_view_mutex);
+        m_pixel_size = s;
+    }
+    wakeRenderThread();
 }
 
-void RadarDisplay::subscribe(QString topic)
+void RadarDisplay::setWorkerThreads(int count)
+{
+    m_workers.setMaxThreadCount(std::max(1, count));
+}
+
+void RadarDisplay::setViewport(QRectF const &viewport)
 {
-    if(!m_spinner)
     {
-        m_spinner = std::shared_ptr<ros::AsyncSpinner>(new ros::AsyncSpinner(1, &m_ros_queue));
-        m_spinner->start();
+        QMutexLocker lock(&m_view_mutex);
+        m_viewport = viewport;
     }
-    ros::SubscribeOptions ops = ros::SubscribeOptions::create<marine_msgs::RadarSectorStamped>(topic.toStdString(), 300, boost::bind(&RadarDisplay::radarCallback, this, _1), ros::VoidPtr(), &m_ros_queue);
-    m_subscriber = ros::NodeHandle().subscribe(ops);
+    wakeRenderThread();
 }
 
-void RadarDisplay::initializeGL()
+QVariant RadarDisplay::itemChange(GraphicsItemChange change, const QVariant &value)
 {
-    QSurfaceFormat surfaceFormat;
-    surfaceFormat.setMajorVersion(4);
-    surfaceFormat.setMinorVersion(3);
-    surfaceFormat.setAlphaBufferSize(8);
-    surfaceFormat.setRedBufferSize(8);
-    surfaceFormat.setGreenBufferSize(8);
-    surfaceFormat.setBlueBufferSize(8);
-    
-    m_context = new QOpenGLContext();
-    m_context->setFormat(surfaceFormat);
-    m_context->create();
-    if(!m_context->isValid()) return;
-
-    m_surface = new QOffscreenSurface();
-    m_surface->setFormat(surfaceFormat);
-    m_surface->create();
-    if(!m_surface->isValid()) return;
-
-    m_context->makeCurrent(m_surface);
-    QOpenGLFramebufferObjectFormat fboFormat;
-    m_fbo = new QOpenGLFramebufferObject(2048,2048,fboFormat);
-
-    initializeOpenGLFunctions();
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    
-    QVector<GLfloat> vertData;
-    vertData.append(-1.0); vertData.append(-1.0); vertData.append(0.0);
-    vertData.append(1.0); vertData.append(-1.0); vertData.append(0.0);
-    vertData.append(1.0); vertData.append(1.0); vertData.append(0.0);
-    vertData.append(-1.0); vertData.append(1.0); vertData.append(0.0);
-    
-    m_vbo.create();
-    m_vbo.bind();
-    m_vbo.allocate(vertData.constData(), vertData.count() * sizeof(GLfloat));
-    
-#define PROGRAM_VERTEX_ATTRIBUTE 0
-
-    QOpenGLShader *vshader = new QOpenGLShader(QOpenGLShader::Vertex, m_context);
-    const char *vsrc =
-        "attribute highp vec4 vertex;\n"
-        "varying mediump vec4 texc;\n"
-        "uniform mediump mat4 matrix;\n"
-        "void main(void)\n"
-        "{\n"
-        "    gl_Position = matrix * vertex;\n"
-        "    texc = vertex;\n"
-        "}\n";
-    vshader->compileSourceCode(vsrc);
-
-    QOpenGLShader *fshader = new QOpenGLShader(QOpenGLShader::Fragment, m_context);
-    const char *fsrc =
-        "#define M_PI 3.1415926535897932384626433832795\n"
-        "uniform sampler2D texture;\n"
-        "varying mediump vec4 texc;\n"
-        "uniform float minAngle;\n"
-        "uniform float maxAngle;\n"
-        "uniform float fade;\n"
-        "uniform vec4 color;\n"
-        "void main(void)\n"
-        "{\n"
-        "    if(texc.x == 0.0) discard;\n"
-        "    float r = length(texc.xy);\n"
-        "    if(r>1.0) discard;\n"
-        "    float theta = atan(texc.x, texc.y);\n"
-        "    if(minAngle > 0.0 && theta < 0.0) theta += 2.0*M_PI;\n"
-        "    if(theta < minAngle) discard;\n"
-        "    if(theta > maxAngle) discard;\n"
-        "    vec4 radarData = texture2D(texture, vec2(r, (theta-minAngle)/(maxAngle-minAngle)));\n"
-        "    if(radarData.r < 0.01) discard;\n"
-        "    gl_FragColor = color*fade*radarData.r;\n"
-        "    //gl_FragColor.a = radarData.r*fade;\n"
-        "}\n";
-    fshader->compileSourceCode(fsrc);
-
-    m_program = new QOpenGLShaderProgram;
-    m_program->addShader(vshader);
-    m_program->addShader(fshader);
-    m_program->bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
-    m_program->link();
-
-    m_program->bind();
-    m_program->setUniformValue("texture", 0);
-
-    m_opengl_initialized = true;
+    if(change == ItemScenePositionHasChanged)
+    {
+        {
+            QMutexLocker lock(&m_view_mutex);
+            m_scene_position = value.toPointF();
+        }
+        wakeRenderThread();
+    }
+    return QGraphicsItem::itemChange(change, value);
+}
+
+void RadarDisplay::wakeRenderThread()
+{
+    QMutexLocker lock(&m_new_sectors_mutex);
+    m_view_changed = true;
+    m_render_condition.wakeOne();
+}
+
+bool RadarDisplay::isOnScreen()
+{
+    double range;
+    {
+        QMutexLocker lock(&m_range_mutex);
+        range = m_range;
+    }
+    QMutexLocker lock(&m_view_mutex);
+    if(!m_show_radar)
+        return false;
+    if(m_viewport.isNull() || range <= 0.0)
+        return true;
+    double r = range/m_pixel_size;
+    return m_viewport.intersects(QRectF(m_scene_position.x()-r, m_scene_position.y()-r, r*2, r*2));
 }
 
 QRectF RadarDisplay::boundingRect() const
 {
-  if (m_range > 0);
+  if (m_item_range > 0)
   {
-    double r = m_range / m_pixel_size;
+    double r = m_item_range / m_pixel_size;
     return QRectF(-r,-r,r*2,r*2);
   }
   return QRectF();
@@ -143,13 +153,13 @@ QRectF RadarDisplay::boundingRect() const
 
 void RadarDisplay::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
 {
-    if(m_show_radar && !m_sectors.empty())
+    double r;
+    {
+        QMutexLocker lock(&m_range_mutex);
+        r = m_range;
+    }
+    if(m_show_radar && r > 0.0)
     {
-        double r;
-        {
-            QMutexLocker lock(&m_range_mutex);
-            r = m_range;
-        }
         r /= m_pixel_size;
         QPen p;
         p.setColor(Qt::green);
@@ -160,7 +170,7 @@ void RadarDisplay::paint(QPainter* painter, const QStyleOptionGraphicsItem* opti
 
         {
             QMutexLocker lock(&m_radar_image_mutex);
-            painter->drawImage(radarRect, m_radar_image);
+            painter->drawImage(radarRect, m_scan_converter.image());
         }
 
     }
@@ -169,152 +179,474 @@ void RadarDisplay::paint(QPainter* painter, const QStyleOptionGraphicsItem* opti
 
 void RadarDisplay::sectorAdded()
 {
-    //prepareGeometryChange();
+    double r;
+    {
+        QMutexLocker lock(&m_range_mutex);
+        r = m_range;
+    }
+    if(r != m_item_range)
+    {
+        prepareGeometryChange();
+        m_item_range = r;
+    }
     update();
 }
 
-void RadarDisplay::radarCallback(const marine_msgs::RadarSectorStamped::ConstPtr &message)
+void RadarDisplay::addSector(std::string const &source, const marine_msgs::RadarSectorStamped::ConstPtr &message)
 {
-  if (m_show_radar && !message->sector.scanlines.empty())
+  // Stored whether shown or not, hiding the overlay only stops drawing.
+  if (!message->sector.scanlines.empty())
   {
-    double angle1 = message->sector.scanlines[0].angle;
-    double angle2 = message->sector.scanlines.back().angle;
-    double range = message->sector.scanlines[0].range;
-    int w = message->sector.scanlines[0].intensities.size();
-    int h = message->sector.scanlines.size();
-    QImage * sector = new QImage(w,h,QImage::Format_Grayscale8);
-    sector->fill(Qt::darkGray);
-    for(int i = 0; i < h; i++)
-      for(int j = 0; j < w; j++)
-        sector->bits()[i*w+j] = message->sector.scanlines[i].intensities[j]*16; // *16 to convert from 4 to 8 bits
-
-    Sector s;
-    if(angle1 > angle2)
-        s.angle1 = (angle1-360.0)*M_PI/180.0;
-    else
-        s.angle1 = angle1*M_PI/180.0;
-    s.angle2 = angle2*M_PI/180.0;
-    s.half_scanline_angle = (s.angle2 - s.angle1)/(2.0*sector->height());
-    s.range = range;
-    s.sectorImage = sector;
-    s.timestamp = message->header.stamp;
-    s.frame_id = message->header.frame_id.c_str();
     QMutexLocker lock(&m_new_sectors_mutex);
-    m_new_sectors.push_back(s);
+    m_new_sectors.push_back(std::make_pair(source, message));
+    m_render_condition.wakeOne();
   }
 }
 
+void RadarDisplay::storeSectors(Source &source, ros::Time const &now)
+{
+  while(!source.waiting.empty())
+  {
+    auto const &s = source.waiting.front();
+    if(s->header.frame_id != source.frame_id)
+    {
+      source.frame_id = s->header.frame_id;
+      if(m_pose_cache)
+        m_pose_cache->track(source.frame_id);
+    }
+    double heading;
+    if(m_pose_cache && m_pose_cache->heading(s->header.frame_id, s->header.stamp.toSec(), heading))
+      storeSector(source, *s, heading*M_PI/180.0);
+    else if(s->header.stamp + ros::Duration(persistence) >= now)
+      break;
+    source.waiting.pop_front();
+  }
+}
 
-void RadarDisplay::updateRadarImage()
+void RadarDisplay::storeSector(Source &source, marine_msgs::RadarSectorStamped const &sector, double heading)
 {
-  while(true)
+  auto const &scanlines = sector.sector.scanlines;
+  double angle1 = scanlines.front().angle*M_PI/180.0;
+  double angle2 = scanlines.back().angle*M_PI/180.0;
+  if(angle1 > angle2)
+    angle1 -= 2.0*M_PI;
+  double half_scanline_angle = (angle2-angle1)/(2.0*scanlines.size());
+  double range = scanlines.front().range;
+  double stamp = sector.header.stamp.toSec();
+
+  if(range != source.range)
+  {
+    // Spokes at the old range would be drawn at the wrong scale.
+    std::fill(source.times.begin(), source.times.end(), 0.0);
+    source.range = range;
+  }
+  source.newest = std::max(source.newest, stamp);
+
+  int binCount = m_scan_converter.binCount();
+  for(auto const &scanline: scanlines)
   {
-    if ( QThread::currentThread()->isInterruptionRequested() )
-      return;
+    // The antenna's turn is followed by its own angles, so blanked sectors
+    // and scanlines narrower than a bin still complete it. Steps back, or
+    // repeats, don't turn it.
+    if(!std::isnan(source.last_angle))
+    {
+      double step = std::fmod(scanline.angle-source.last_angle, 360.0);
+      if(step < 0.0)
+        step += 360.0;
+      if(step < 180.0)
+        source.swept += step;
+    }
+    source.last_angle = scanline.angle;
+
+    int samples = std::min<int>(scanline.intensities.size(), maxSamples);
+    if(samples == 0)
+      continue;
+    double angle = scanline.angle*M_PI/180.0+heading;
+    int first, count;
+    m_scan_converter.binRange(angle-half_scanline_angle, angle+half_scanline_angle, first, count);
+    uint8_t *spoke = &source.spokes[first*maxSamples];
+    // Intensities go straight from the message into the spoke, longer
+    // scanlines are decimated to fit.
+    std::size_t inputSamples = scanline.intensities.size();
+    if(inputSamples == std::size_t(samples))
+      RadarScanConverter::expandIntensities(scanline.intensities.data(), samples, spoke);
+    else
+      for(int j = 0; j < samples; j++)
+        spoke[j] = scanline.intensities[j*inputSamples/samples]*16;
+    for(int i = 0; i < count; i++)
+    {
+      int bin = (first+i)%binCount;
+      if(i > 0)
+        std::copy(spoke, spoke+samples, &source.spokes[bin*maxSamples]);
+      source.samples[bin] = samples;
+      source.times[bin] = stamp;
+      source.steps[bin] = -1;
+    }
+  }
 
-    if(!m_opengl_initialized)
-      initializeGL();
+  // The occupancy map gets the raw returns, placed where the radar was.
+  QPointF position;
+  int occupancySamples = std::min<int>(scanlines.front().intensities.size(), maxSamples);
+  if(m_occupancy && occupancySamples > 0 && m_pose_cache && m_pose_cache->mapPosition(sector.header.frame_id, stamp, position))
+  {
+    std::vector<float> bearings;
+    std::vector<uint8_t> intensities;
+    bearings.reserve(scanlines.size());
+    intensities.reserve(scanlines.size()*occupancySamples);
+    for(auto const &scanline: scanlines)
+    {
+      std::size_t inputSamples = scanline.intensities.size();
+      if(inputSamples == 0)
+        continue;
+      bearings.push_back(scanline.angle*M_PI/180.0+heading);
+      for(int j = 0; j < occupancySamples; j++)
+        intensities.push_back(scanline.intensities[j*inputSamples/occupancySamples]);
+    }
+    m_occupancy->addSector(position.x(), position.y(), range, std::move(bearings), std::move(intensities), occupancySamples);
+  }
+}
 
-    m_context->makeCurrent(m_surface);
-    m_fbo->bind();
-    glClear(GL_COLOR_BUFFER_BIT);
+void RadarDisplay::trackTargets(Source &source)
+{
+  RadarTargetParameters parameters;
+  {
+    QMutexLocker lock(&m_targets_mutex);
+    parameters = m_target_parameters;
+  }
 
-    QMatrix4x4 matrix;
-    matrix.ortho(-1, 1, -1, 1, 4.0f, 15.0f);
-    matrix.translate(0.0f, 0.0f, -10.0f);
-    
-    glViewport(0,0,2048,2048);
-    
-    m_program->setUniformValue("matrix", matrix);
-    m_program->enableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
-    m_program->setAttributeBuffer(PROGRAM_VERTEX_ATTRIBUTE, GL_FLOAT, 0, 3, 3 * sizeof(GLfloat));
+  // Spokes that weren't refreshed during the turn are left out.
+  QElapsedTimer timer;
+  timer.start();
+  int binCount = m_scan_converter.binCount();
+  for(int bin = 0; bin < binCount; bin++)
+    source.current_samples[bin] = source.times[bin] > 0.0 && source.newest-source.times[bin] < persistence ? source.samples[bin] : 0;
+  source.extractor.extract(source.spokes.data(), maxSamples, source.current_samples.data(), binCount, source.range, parameters, source.blobs);
+  qint64 extracted = timer.nsecsElapsed();
+
+  // Blobs are placed around where the radar was at the end of the turn.
+  QPointF position;
+  if(m_pose_cache && m_pose_cache->mapPosition(source.frame_id, source.newest, position))
+  {
+    for(auto &blob: source.blobs)
+      blob.position += position;
+    source.tracker.update(source.newest, source.blobs, parameters);
+  }
+  std::vector<RadarTarget> targets = source.tracker.confirmed(parameters);
+  qint64 tracked = timer.nsecsElapsed();
 
-    ros::Time now = ros::Time::now();
-    float persistance = 2.0;
+  bool changed = source.has_targets || !targets.empty();
+  source.has_targets = !targets.empty();
+  {
+    QMutexLocker lock(&m_targets_mutex);
+    if(targets.empty())
+      m_targets.erase(source.name);
+    else
+      m_targets[source.name].swap(targets);
+  }
+
+  recordTiming(&Timings::extract, extracted);
+  recordTiming(&Timings::track, tracked-extracted);
+  if(source.last_sweep > 0.0)
+    recordTiming(&Timings::sweep, qint64((source.newest-source.last_sweep)*1e9));
+  source.last_sweep = source.newest;
+  {
+    QMutexLocker lock(&m_timings_mutex);
+    m_timings.sweeps++;
+  }
+  if(changed)
+    emit targetsUpdated();
+}
+
+void RadarDisplay::recordTiming(double Timings::*stage, qint64 nanoseconds)
+{
+  double milliseconds = nanoseconds/1e6;
+  QMutexLocker lock(&m_timings_mutex);
+  double &average = m_timings.*stage;
+  average = average == 0.0 ? milliseconds : 0.9*average+0.1*milliseconds;
+}
+
+void RadarDisplay::setTargetParameters(RadarTargetParameters const &parameters)
+{
+  QMutexLocker lock(&m_targets_mutex);
+  m_target_parameters = parameters;
+}
+
+std::vector<RadarTarget> RadarDisplay::targets() const
+{
+  std::vector<RadarTarget> ret;
+  QMutexLocker lock(&m_targets_mutex);
+  for(auto const &t: m_targets)
+    ret.insert(ret.end(), t.second.begin(), t.second.end());
+  return ret;
+}
+
+RadarDisplay::Timings RadarDisplay::timings() const
+{
+  QMutexLocker lock(&m_timings_mutex);
+  return m_timings;
+}
+
+bool RadarDisplay::drawBins(int first, int last, double now, bool redraw_all, double &next_fade)
+{
+  bool changed = false;
+  next_fade = 0.0;
+  std::vector<int> steps(m_sources.size());
+  std::vector<uint8_t> composite(maxSamples);
+  for(int bin = first; bin < last; bin++)
+  {
+    bool dirty = redraw_all;
+    bool shown = false;
+    int i = 0;
+    for(auto &s: m_sources)
     {
-      QMutexLocker lock(&m_new_sectors_mutex);
-      while(!m_new_sectors.empty())
+      Source &source = *s.second;
+      int step = 0;
+      if(source.times[bin] > 0.0)
+      {
+        double fade = 1.0-(now-source.times[bin])/persistence;
+        if(fade > 0.0)
+        {
+          step = std::max(1, std::min(fadeSteps, int(std::ceil(fade*fadeSteps))));
+          double fade_time = source.times[bin]+persistence*(1.0-double(step-1)/fadeSteps);
+          if(next_fade == 0.0 || fade_time < next_fade)
+            next_fade = fade_time;
+        }
+        else
+          source.times[bin] = 0.0;
+      }
+      if(step != source.steps[bin])
       {
-        m_sectors.push_back(m_new_sectors.front());
-        m_new_sectors.pop_front();
+        source.steps[bin] = step;
+        dirty = true;
       }
+      steps[i++] = step;
+      shown = shown || step > 0;
+    }
+    if(!dirty)
+      continue;
+    changed = true;
+    if(!shown)
+    {
+      m_scan_converter.clearBin(bin);
+      continue;
+    }
+
+    // Each radar's spoke is dimmed by its fade and resampled to the
+    // image's range, the strongest return wins.
+    std::fill(composite.begin(), composite.end(), 0);
+    i = 0;
+    for(auto const &s: m_sources)
+    {
+      Source const &source = *s.second;
+      int step = steps[i++];
+      if(step == 0)
+        continue;
+      int covered = std::min(maxSamples, int(maxSamples*source.range/m_drawn_range));
+      int samples = source.samples[bin];
+      uint8_t const *spoke = &source.spokes[bin*maxSamples];
+      for(int k = 0; k < covered; k++)
+        composite[k] = std::max<uint8_t>(composite[k], spoke[k*samples/covered]*step/fadeSteps);
     }
-    while(!m_sectors.empty() && m_sectors.front().timestamp + ros::Duration(persistance) < now)
+    m_scan_converter.drawBin(bin, composite.data(), maxSamples, m_palette.data());
+  }
+  return changed;
+}
+
+void RadarDisplay::runOnWorkers(std::vector<std::function<void()> > const &jobs)
+{
+  if(jobs.size() == 1)
+  {
+    jobs.front()();
+    return;
+  }
+  for(auto const &job: jobs)
+    m_workers.start(new Job(job));
+  m_workers.waitForDone();
+}
+
+void RadarDisplay::updateRadarImage()
+{
+  QElapsedTimer clock;
+  clock.start();
+  const qint64 never = std::numeric_limits<qint64>::max();
+  // clock times at which work is next due, and before which we don't render
+  qint64 deadline = never;
+  qint64 earliest = 0;
+  qint64 render_interval = minimumRenderInterval;
+
+  while(true)
+  {
     {
-      if(m_sectors.front().sectorImage)
-        delete m_sectors.front().sectorImage;
-      if(m_sectors.front().sectorTexture)
-        delete m_sectors.front().sectorTexture;
-      m_sectors.pop_front();
+      QMutexLocker lock(&m_new_sectors_mutex);
+      while(!m_stop)
+      {
+        qint64 now = clock.elapsed();
+        qint64 due = deadline;
+        if(!m_new_sectors.empty() || m_view_changed)
+          due = now;
+        if(due != never)
+          due = std::max(due, earliest);
+        if(due <= now)
+          break;
+        if(due == never)
+          m_render_condition.wait(&m_new_sectors_mutex);
+        else
+          m_render_condition.wait(&m_new_sectors_mutex, due-now);
+      }
+      if(m_stop)
+        return;
+      for(auto const &s: m_new_sectors)
+      {
+        std::shared_ptr<Source> &source = m_sources[s.first];
+        if(!source)
+        {
+          int spokes = m_scan_converter.binCount();
+          source = std::make_shared<Source>();
+          source->spokes.assign(spokes*maxSamples, 0);
+          source->samples.assign(spokes, 0);
+          source->times.assign(spokes, 0.0);
+          source->steps.assign(spokes, 0);
+          source->current_samples.assign(spokes, 0);
+          source->name = s.first;
+        }
+        source->waiting.push_back(s.second);
+      }
+      m_new_sectors.clear();
+      m_view_changed = false;
     }
+
+    ros::Time now = ros::Time::now();
+    qint64 started = clock.elapsed();
+
+    QColor color;
     {
-      QMutexLocker range_lock(&m_range_mutex);
-      if(m_sectors.empty())
-        m_range = 0.0;
-      else
-        m_range = m_sectors.back().range;
+      QMutexLocker lock(&m_color_mutex);
+      color = m_color;
     }
-    for(Sector &s: m_sectors)
+
+    bool changed = false;
+    double next_fade = 0.0;
+    bool waiting = false;
     {
-      if(s.sectorImage && !s.rendered)
+      QElapsedTimer stage;
+
+      // Each radar's sectors are stored by its own job.
+      std::vector<std::function<void()> > jobs;
+      for(auto &s: m_sources)
+      {
+        Source *source = s.second.get();
+        if(!source->waiting.empty())
+          jobs.push_back([this, source, now](){storeSectors(*source, now);});
+      }
+      if(!jobs.empty())
+      {
+        stage.start();
+        runOnWorkers(jobs);
+        recordTiming(&Timings::store, stage.nsecsElapsed());
+      }
+
+      // Radars that completed a turn have their targets updated, whether
+      // they are shown or not.
+      jobs.clear();
+      for(auto &s: m_sources)
       {
-        float fade = 1.0-((now-s.timestamp).toSec()/persistance);
-        if(!s.sectorTexture)
+        Source *source = s.second.get();
+        if(source->swept >= 360.0)
         {
-          s.sectorTexture = new QOpenGLTexture(*s.sectorImage);
+          source->swept = std::fmod(source->swept, 360.0);
+          jobs.push_back([this, source](){trackTargets(*source);});
         }
-        if(!s.have_heading)
+        else if(source->has_targets && now.toSec()-source->newest >= persistence)
         {
-          //std::cerr << "tf buffer? " << m_tf_buffer << std::endl;
-          //std::cerr << "map frame: " << m_mapFrame << " timestamp: " << s.timestamp << " frame_id: " << s.frame_id.toStdString();
-          //if(m_tf_buffer && !m_mapFrame.empty())
-          //    std::cerr << "can transform? " << m_tf_buffer->canTransform(m_mapFrame, s.frame_id.toStdString(), s.timestamp) << std::endl;
-          //std::cerr << std::endl;
-          if(m_tf_buffer && !m_mapFrame.empty() && m_tf_buffer->canTransform(m_mapFrame, s.frame_id.toStdString(), s.timestamp))
+          // The radar went quiet, its targets can't be vouched for.
+          source->tracker.clear();
+          source->has_targets = false;
           {
-              geometry_msgs::TransformStamped t = m_tf_buffer->lookupTransform(m_mapFrame, s.frame_id.toStdString(), s.timestamp);
-              double heading =  (M_PI/2.0)-tf2::getYaw(t.transform.rotation);
-              while (heading < 0.0)
-                  heading += (2.0*M_PI);
-              s.heading = heading;
-              s.angle1 = std::fmod(s.angle1+heading,M_PI*2);
-              if(s.angle1 < 0)
-                s.angle1 += M_PI*2;
-              s.angle2 = std::fmod(s.angle2+heading,M_PI*2);
-              if(s.angle2 < 0)
-                s.angle2 += M_PI*2;
-
-              s.have_heading = true;
-              //std::cerr << "radar sector heading: " << s.heading << std::endl;
+            QMutexLocker lock(&m_targets_mutex);
+            m_targets.erase(source->name);
           }
+          emit targetsUpdated();
+        }
+      }
+      runOnWorkers(jobs);
+
+      // The image covers the longest range of the radars still showing
+      // returns.
+      double range = 0.0;
+      for(auto const &s: m_sources)
+      {
+        if(now.toSec()-s.second->newest < persistence)
+          range = std::max(range, s.second->range);
+        waiting = waiting || !s.second->waiting.empty();
+      }
+      {
+        QMutexLocker range_lock(&m_range_mutex);
+        m_range = range;
+      }
+
+      // Hidden or off screen radars keep their spokes up to date but
+      // aren't drawn until they come back into view.
+      if(isOnScreen())
+      {
+        // Only the image is shared with paint(), the spokes belong to
+        // this thread and its workers.
+        QMutexLocker image_lock(&m_radar_image_mutex);
+        bool redraw_all = range != m_drawn_range || color != m_drawn_color;
+        if(color != m_drawn_color)
+        {
+          // Same colour as the shader this replaces gave: the colour
+          // scaled by intensity, faded spokes having been dimmed.
+          for(int i = 0; i < 256; i++)
+            m_palette[i] = qPremultiply(qRgba(color.red(), color.green(), color.blue(), color.alpha()*i/255));
+          m_drawn_color = color;
         }
-        if(s.have_heading)
+        m_drawn_range = range;
+
+        // Bins don't share pixels, so ranges of them are drawn in parallel.
+        int binCount = m_scan_converter.binCount();
+        int job_count = (binCount+binsPerJob-1)/binsPerJob;
+        stage.start();
+        std::vector<char> job_changed(job_count, 0);
+        std::vector<double> job_next_fade(job_count, 0.0);
+        jobs.clear();
+        for(int j = 0; j < job_count; j++)
+          jobs.push_back([this, j, binCount, now, redraw_all, &job_changed, &job_next_fade]()
+          {
+            job_changed[j] = drawBins(j*binsPerJob, std::min(binCount, (j+1)*binsPerJob), now.toSec(), redraw_all, job_next_fade[j]);
+          });
+        runOnWorkers(jobs);
+        for(int j = 0; j < job_count; j++)
         {
-          m_program->setUniformValue("minAngle", GLfloat(s.angle1-s.half_scanline_angle*1.1));
-          m_program->setUniformValue("maxAngle", GLfloat(s.angle2+s.half_scanline_angle*1.1));
-          m_program->setUniformValue("fade", GLfloat(fade));
-          m_program->setUniformValue("color", m_color);
-          
-          s.sectorTexture->bind();
-          glDisable(GL_BLEND);
-          glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-          //s.rendered = true;
+          changed = changed || job_changed[j];
+          if(job_next_fade[j] > 0.0 && (next_fade == 0.0 || job_next_fade[j] < next_fade))
+            next_fade = job_next_fade[j];
         }
+        if(changed)
+          recordTiming(&Timings::draw, stage.nsecsElapsed());
       }
     }
 
-    {
-      QMutexLocker lock(&m_radar_image_mutex);
-      m_radar_image = m_fbo->toImage();
-    }
-    QThread::currentThread()->msleep(250);
+    if(changed)
+      QMetaObject::invokeMethod(this, "sectorAdded", Qt::QueuedConnection);
+
+    qint64 finished = clock.elapsed();
+    render_interval = std::max(minimumRenderInterval, std::min(maximumRenderInterval, 4*(finished-started)));
+    earliest = started+render_interval;
+    deadline = never;
+    if(next_fade > 0.0)
+      deadline = finished+std::max<qint64>(0, std::ceil((next_fade-ros::Time::now().toSec())*1000.0));
+    if(waiting)
+      deadline = std::min(deadline, finished+headingRetryInterval);
   }
-
-} 
+}
 
 void RadarDisplay::showRadar(bool show)
 {
-    m_show_radar = show;
+    {
+        QMutexLocker lock(&m_view_mutex);
+        m_show_radar = show;
+    }
+    wakeRenderThread();
     update();
 }
 
@@ -325,6 +657,9 @@ const QColor& RadarDisplay::getColor() const
 
 void RadarDisplay::setColor(QColor color)
 {
-    QMutexLocker lock(&m_color_mutex);
-    m_color = color;
+    {
+        QMutexLocker lock(&m_color_mutex);
+        m_color = color;
+    }
+    wakeRenderThread();
 }
@@ -3,103 +3,188 @@
 
 #include <QObject>
 #include "geographicsitem.h"
-#include <QOpenGLFunctions>
-#include <QOpenGLTexture>
-#include <QOpenGLBuffer>
+#include "radar_scan_converter.h"
+#include "radar_targets.h"
 #include <QMutex>
+#include <QThreadPool>
+#include <QWaitCondition>
 #include <deque>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
 #include <ros/ros.h>
-#include <ros/callback_queue.h>
 #include "marine_msgs/RadarSectorStamped.h"
 
-Q_DECLARE_METATYPE(QImage*)
 Q_DECLARE_METATYPE(ros::Time)
 
 class ROSLink;
-class QOffscreenSurface;
-class QOpenGLContext;
-class QOpenGLFramebufferObject;
-class QOpenGLShaderProgram;
-
-namespace tf2_ros
-{
-    class Buffer;
-}
-
-class RadarDisplay : public QObject, public GeoGraphicsItem,  protected QOpenGLFunctions
+class PoseCache;
+class RadarOccupancy;
+
+// Overlay of every radar's latest returns. Sectors from any number of
+// radars are stored and scan converted on one bounded pool of workers, and
+// composited into a single image. Each full turn of a radar's spokes is
+// also searched for targets on the same pool, and the targets are tracked
+// from turn to turn.
+class RadarDisplay : public QObject, public GeoGraphicsItem
 {
     Q_OBJECT
     Q_INTERFACES(QGraphicsItem)
 public:
     RadarDisplay(ROSLink* parent);
+    ~RadarDisplay();
 
     QRectF boundingRect() const;
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
     int type() const override {return RadarDisplayType;}
     void setPixelSize(double s);
-    void setTF2Buffer(tf2_ros::Buffer *buffer);
-    void setMapFrame(std::string mapFrame);
+    // Where sector headings are looked up, by frame and time.
+    void setPoseCache(PoseCache *cache);
+    // Where stored sectors are also accumulated as obstacles.
+    void setOccupancy(RadarOccupancy *occupancy);
     const QColor& getColor() const;
+    // Scene area shown by the view, radar images are not rendered while
+    // outside of it.
+    void setViewport(QRectF const &viewport);
+    // Most threads used for storing and drawing sectors.
+    void setWorkerThreads(int count);
+
+    // Queues a sector from the named radar, from any thread.
+    void addSector(std::string const &source, const marine_msgs::RadarSectorStamped::ConstPtr &message);
+
+    void setTargetParameters(RadarTargetParameters const &parameters);
+    // Confirmed targets of every radar, in map frame meters.
+    std::vector<RadarTarget> targets() const;
+
+    // Average milliseconds spent by each stage of the pipeline, each time
+    // it runs, and between turns of a radar.
+    struct Timings
+    {
+        double store = 0.0;
+        double extract = 0.0;
+        double track = 0.0;
+        double draw = 0.0;
+        double sweep = 0.0;
+        int sweeps = 0;
+    };
+    Timings timings() const;
+
+signals:
+    // Emitted from the workers after a turn changed the targets.
+    void targetsUpdated();
     
 public slots:
     void showRadar(bool show);
     void setColor(QColor color);
     void sectorAdded();
-    void subscribe(QString topic);
 
 private:
-    void initializeGL();
-    void radarCallback(const marine_msgs::RadarSectorStamped::ConstPtr &message);
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
+
     void updateRadarImage();
+    // Wakes the render thread to check for work.
+    void wakeRenderThread();
+    bool isOnScreen();
 
     
-    struct Sector
+    // Latest returns from one radar, one spoke per bin of the scan
+    // converter covering a full turn, overwritten in place as sectors
+    // arrive. Spokes fade with age.
+    struct Source
     {
-        Sector():angle1(0),angle2(0),range(0),heading(-1.0),sectorImage(nullptr),sectorTexture(nullptr)
-        {}
-        
-        ros::Time timestamp;
-        QString frame_id;
-        double angle1, angle2, range, half_scanline_angle;
-        double heading;
-        double have_heading = false;
-        double rendered = false;
-        QImage *sectorImage;
-        QOpenGLTexture *sectorTexture;
+        std::vector<uint8_t> spokes;
+        std::vector<uint16_t> samples;
+        // seconds, 0 for empty spokes
+        std::vector<double> times;
+        // fade step last drawn, 0 when clear, -1 to redraw
+        std::vector<int8_t> steps;
+        double range = 0.0;
+        // frame whose heading is tracked for the sectors
+        std::string frame_id;
+        // time of the newest sector stored, in seconds
+        double newest = 0.0;
+        // sectors waiting for a heading
+        std::deque<marine_msgs::RadarSectorStamped::ConstPtr> waiting;
+
+        std::string name;
+        // angle of the last scanline relative to the antenna, in degrees,
+        // NaN before the first
+        double last_angle = std::numeric_limits<double>::quiet_NaN();
+        // degrees the antenna turned since targets were last extracted, a
+        // turn is due at 360 whichever bins it wrote
+        double swept = 0.0;
+        // spoke lengths, 0 for spokes without current returns
+        std::vector<uint16_t> current_samples;
+        RadarBlobExtractor extractor;
+        std::vector<RadarBlob> blobs;
+        RadarTracker tracker;
+        // time of the turn targets were last extracted from, in seconds
+        double last_sweep = 0.0;
+        bool has_targets = false;
     };
-    
-    double m_pixel_size = 1.0;
 
-    std::deque<Sector> m_sectors;
-
-    std::deque<Sector> m_new_sectors;
+    // Stores the sectors whose heading is known, in arrival order. Those
+    // still waiting when they would have faded are dropped.
+    void storeSectors(Source &source, ros::Time const &now);
+    // Writes a sector's scanlines over the spokes they cover.
+    void storeSector(Source &source, marine_msgs::RadarSectorStamped const &sector, double heading);
+    // Redraws the bins from first to last where a radar's spoke changed or
+    // faded a step since last drawn, or every bin if redraw_all is set.
+    // next_fade is set to the time the next spoke fades, 0 if none are
+    // shown.
+    bool drawBins(int first, int last, double now, bool redraw_all, double &next_fade);
+    // Extracts and tracks the targets of the turn just completed.
+    void trackTargets(Source &source);
+    void recordTiming(double Timings::*stage, qint64 nanoseconds);
+    // Runs the jobs on the worker pool and waits for them to finish.
+    void runOnWorkers(std::vector<std::function<void()> > const &jobs);
+
+    std::deque<std::pair<std::string, marine_msgs::RadarSectorStamped::ConstPtr> > m_new_sectors;
+    // The render thread sleeps until sectors arrive, the view changes or
+    // a spoke is due to fade.
     QMutex m_new_sectors_mutex;
+    QWaitCondition m_render_condition;
+    bool m_view_changed = false;
+    bool m_stop = false;
 
-    double m_range = 0.0;
-    QMutex m_range_mutex;
+    double m_pixel_size = 1.0;
+    QRectF m_viewport;
+    QPointF m_scene_position;
+    QMutex m_view_mutex;
 
-    QOpenGLShaderProgram *m_program;
-    QOffscreenSurface* m_surface = nullptr;
-    QOpenGLContext* m_context = nullptr;
-    QOpenGLFramebufferObject* m_fbo = nullptr;
-    QOpenGLBuffer m_vbo;
+    // render thread and workers only
+    std::map<std::string, std::shared_ptr<Source> > m_sources;
+    QThreadPool m_workers;
 
-    QImage m_radar_image;
+    // range of the composited image, the longest of the radars'
+    double m_range = 0.0;
+    QMutex m_range_mutex;
+    // range the item's bounds were last prepared for, GUI thread only
+    double m_item_range = 0.0;
+
+    RadarScanConverter m_scan_converter;
+    // colour by intensity, faded spokes are dimmed before mapping
+    std::vector<QRgb> m_palette;
+    QColor m_drawn_color;
+    double m_drawn_range = 0.0;
     QMutex m_radar_image_mutex;
-
-    bool m_opengl_initialized = false;
     
     bool m_show_radar = true;
 
     QColor m_color ={0,255,0,255};
     QMutex m_color_mutex;
 
-    tf2_ros::Buffer* m_tf_buffer = nullptr;
-    std::string m_mapFrame;
+    PoseCache* m_pose_cache = nullptr;
+
+    RadarTargetParameters m_target_parameters;
+    // confirmed targets by radar
+    std::map<std::string, std::vector<RadarTarget> > m_targets;
+    mutable QMutex m_targets_mutex;
 
-    ros::CallbackQueue m_ros_queue;
-    std::shared_ptr<ros::AsyncSpinner> m_spinner;
-    ros::Subscriber m_subscriber;
+    Timings m_timings;
+    mutable QMutex m_timings_mutex;
+    RadarOccupancy* m_occupancy = nullptr;
 
     QThread* m_radarImageThread;
 };
@@ -12,7 +12,46 @@
 #include "rosdetails.h"
 //#include "boost/date_time/posix_time/posix_time.hpp"
 #include "radardisplay.h"
+#include "path_layer.h"
+#include "astar.h"
 #include <tf2/utils.h>
+#include <tf2_geometry_msgs/tf2_geometry_msgs.h>
+#include <QStandardPaths>
+#include <QDir>
+#include <QStyleOptionGraphicsItem>
+#include "surveyarea.h"
+#include "waypoint.h"
+#include <set>
+
+namespace
+{
+    // Seconds, the time of receipt for messages left unstamped.
+    double messageTime(ros::Time const &stamp)
+    {
+        return stamp.isZero() ? ros::Time::now().toSec() : stamp.toSec();
+    }
+
+    // Trimmed AIS contacts kept for reuse, a full history's worth.
+    const std::size_t maximumSpareContacts = 100;
+
+    // Adds an item's batch to display totals, or takes it out with a
+    // sign of -1.
+    void countDisplayItem(geoviz::Stats &stats, geoviz::Item const &item, int sign)
+    {
+        if(!item.batch)
+            return;
+        if(sign > 0)
+        {
+            stats.vertices += item.batch->vertices;
+            stats.bytes += item.batch->bytes;
+        }
+        else
+        {
+            stats.vertices -= std::min(stats.vertices, item.batch->vertices);
+            stats.bytes -= std::min(stats.bytes, item.batch->bytes);
+        }
+    }
+}
 
 
 ROSAISContact::ROSAISContact(QObject* parent): QObject(parent), mmsi(0), heading(0.0)
@@ -20,7 +59,7 @@ ROSAISContact::ROSAISContact(QObject* parent): QObject(parent), mmsi(0), heading
 
 }
 
-ROSLink::ROSLink(AutonomousVehicleProject* parent): QObject(parent), GeoGraphicsItem(),m_node(nullptr), m_spinner(nullptr),m_have_local_reference(false),m_heading(0.0),m_posmv_heading(0.0),m_base_heading(0.0), m_view_point_active(false),m_view_seglist_active(false),m_view_polygon_active(false),m_range(0.0),m_bearing(0.0),m_show_tail(true),m_tf_listener(m_tf_buffer)
+ROSLink::ROSLink(AutonomousVehicleProject* parent): QObject(parent), GeoGraphicsItem(),m_node(nullptr), m_spinner(nullptr),m_have_local_reference(false),m_heading(0.0),m_posmv_heading(0.0),m_base_heading(0.0), m_view_point_active(false),m_view_seglist_active(false),m_view_polygon_active(false),m_range(0.0),m_bearing(0.0),m_show_tail(true)
 {
     m_base_dimension_to_bow = 1.0;
     m_base_dimension_to_stern = 1.0;
@@ -30,6 +69,8 @@ ROSLink::ROSLink(AutonomousVehicleProject* parent): QObject(parent), GeoGraphics
     setAcceptHoverEvents(false);
     setOpacity(1.0);
     setFlag(QGraphicsItem::ItemIsMovable, false);
+    setFlag(QGraphicsItem::ItemHasNoContents);
+    createLayers();
 
     //QGraphicsSvgItem *symbol = new QGraphicsSvgItem(this);
     //symbol->setSharedRenderer(autonomousVehicleProject()->symbols());
@@ -41,6 +82,13 @@ ROSLink::ROSLink(AutonomousVehicleProject* parent): QObject(parent), GeoGraphics
     
     m_watchdog_timer = new QTimer(this);
     connect(m_watchdog_timer, SIGNAL(timeout()), this, SLOT(watchdogUpdate()));
+
+    m_display_timer = new QTimer(this);
+    connect(m_display_timer, SIGNAL(timeout()), this, SLOT(drainTelemetry()));
+    m_display_timer->start(1000/30);
+
+    m_radar_discovery_timer = new QTimer(this);
+    connect(m_radar_discovery_timer, SIGNAL(timeout()), this, SLOT(discoverRadars()));
 }
 
 void ROSLink::connectROS()
@@ -50,40 +98,79 @@ void ROSLink::connectROS()
         if(!m_node)
         {
             m_node = new ros::NodeHandle;
-            m_spinner = new ros::AsyncSpinner(0);
+            // Only serves what is left on the global queue, the subscriptions
+            // below have their own.
+            m_spinner = new ros::AsyncSpinner(1);
 
             std::string robotNamespace = ros::param::param<std::string>("robotNamespace","ben");
             m_mapFrame = robotNamespace+"/map";
+            {
+                QMutexLocker lock(&m_tf_chains_mutex);
+                m_tf_chains.clear();
+                m_tf_parents.clear();
+            }
             emit robotNamespaceUpdated(robotNamespace.c_str());
-
-            m_gps_position_subscriber = m_node->subscribe("/"+robotNamespace+"/sensors/oem/position", 10, &ROSLink::gpsPositionCallback, this);
-            m_base_navsatfix_subscriber = m_node->subscribe("base/position", 10, &ROSLink::baseNavSatFixCallback, this);
-            m_origin_subscriber = m_node->subscribe("project11/origin", 10, &ROSLink::originCallback, this);
-            m_heading_subscriber = m_node->subscribe("/"+robotNamespace+"/sensors/oem/orientation", 10, &ROSLink::headingCallback, this);
-            m_base_heading_subscriber = m_node->subscribe("orientation", 10, &ROSLink::baseHeadingCallback, this);
-            //m_ais_subscriber = m_node->subscribe("/"+robotNamespace+"/sensors/ais/contact", 10, &ROSLink::contactCallback, this);
-
-            m_mission_status_subscriber = m_node->subscribe("/"+robotNamespace+"/project11/status/mission_manager", 10, &ROSLink::missionStatusCallback, this);
-            m_posmv_position = m_node->subscribe("/"+robotNamespace+"/nav/position", 10, &ROSLink::posmvPositionCallback, this);
-            m_posmv_orientation = m_node->subscribe("/"+robotNamespace+"/nav/orientation", 10, &ROSLink::posmvOrientationCallback, this);
-            m_range_subscriber = m_node->subscribe("range", 10, &ROSLink::rangeCallback, this);
-            m_bearing_subscriber = m_node->subscribe("bearing",10, &ROSLink::bearingCallback, this);
-            m_sog_subscriber = m_node->subscribe("/"+robotNamespace+"/nav/velocity",10, &ROSLink::sogCallback, this);
-            m_coverage_subscriber = m_node->subscribe("coverage", 10, &ROSLink::coverageCallback, this);
-            m_ping_subscriber = m_node->subscribe("mbes_ping", 10, &ROSLink::pingCallback, this);
-            m_display_subscriber = m_node->subscribe("/"+robotNamespace+"/project11/display", 10, &ROSLink::geoVizDisplayCallback, this);
+            openArchives(robotNamespace);
+
+            configureCallbackGroups();
+
+            m_gps_position_subscriber = subscribe(NavigationTraffic, "/"+robotNamespace+"/sensors/oem/position", &ROSLink::gpsPositionCallback);
+            m_base_navsatfix_subscriber = subscribe(NavigationTraffic, "base/position", &ROSLink::baseNavSatFixCallback);
+            m_origin_subscriber = subscribe(NavigationTraffic, "project11/origin", &ROSLink::originCallback);
+            m_heading_subscriber = subscribe(NavigationTraffic, "/"+robotNamespace+"/sensors/oem/orientation", &ROSLink::headingCallback);
+            m_base_heading_subscriber = subscribe(NavigationTraffic, "orientation", &ROSLink::baseHeadingCallback);
+            //m_ais_subscriber = subscribe(ContactTraffic, "/"+robotNamespace+"/sensors/ais/contact", &ROSLink::contactCallback);
+
+            m_mission_status_subscriber = subscribe(CommandTraffic, "/"+robotNamespace+"/project11/status/mission_manager", &ROSLink::missionStatusCallback);
+            m_posmv_position = subscribe(NavigationTraffic, "/"+robotNamespace+"/nav/position", &ROSLink::posmvPositionCallback);
+            m_posmv_orientation = subscribe(NavigationTraffic, "/"+robotNamespace+"/nav/orientation", &ROSLink::posmvOrientationCallback);
+            m_range_subscriber = subscribe(CommandTraffic, "range", &ROSLink::rangeCallback);
+            m_bearing_subscriber = subscribe(CommandTraffic, "bearing", &ROSLink::bearingCallback);
+            m_sog_subscriber = subscribe(NavigationTraffic, "/"+robotNamespace+"/nav/velocity", &ROSLink::sogCallback);
+            m_coverage_subscriber = subscribe(DisplayTraffic, "coverage", &ROSLink::coverageCallback);
+            {
+                CallbackGroup &display = m_callback_groups[DisplayTraffic];
+                ros::NodeHandle display_node;
+                display_node.setCallbackQueue(&display.queue);
+                m_ping_subscriber = std::make_shared<message_filters::Subscriber<sensor_msgs::PointCloud> >(display_node, "mbes_ping", display.queue_depth);
+                m_ping_filter = std::make_shared<tf2_ros::MessageFilter<sensor_msgs::PointCloud> >(*m_ping_subscriber, m_tf_buffer, m_mapFrame, display.queue_depth, display_node);
+                m_ping_filter->registerCallback(boost::bind(&ROSLink::pingCallback, this, _1));
+                m_ping_filter->registerFailureCallback([this](sensor_msgs::PointCloud::ConstPtr const &, tf2_ros::filter_failure_reasons::FilterFailureReason)
+                {
+                    m_ping_drops++;
+                });
+            }
+            m_display_subscriber = subscribe(DisplayTraffic, "/"+robotNamespace+"/project11/display", &ROSLink::geoVizDisplayCallback);
+            m_tf_subscriber = subscribe(NavigationTraffic, "/tf", &ROSLink::tfCallback);
+            m_tf_static_subscriber = subscribe(NavigationTraffic, "/tf_static", &ROSLink::tfStaticCallback);
             
-            std::string haloA_topic = "/"+robotNamespace+"/sensors/radar/HaloA/data";
-            m_radar_displays[haloA_topic] = new RadarDisplay(this);
-            m_radar_displays[haloA_topic]->setTF2Buffer(&m_tf_buffer);
-            m_radar_displays[haloA_topic]->setMapFrame(m_mapFrame);
-            m_radar_displays[haloA_topic]->subscribe(haloA_topic.c_str());
-
-            std::string haloB_topic = "/"+robotNamespace+"/sensors/radar/HaloB/data";
-            m_radar_displays[haloB_topic] = new RadarDisplay(this);
-            m_radar_displays[haloB_topic]->setTF2Buffer(&m_tf_buffer);
-            m_radar_displays[haloB_topic]->setMapFrame(m_mapFrame);
-            m_radar_displays[haloB_topic]->subscribe(haloB_topic.c_str());
+            // Every radar is drawn on the one overlay, radar topics are
+            // subscribed to as they are discovered.
+            if(!m_radar_display)
+            {
+                m_radar_display = new RadarDisplay(this);
+                m_radar_display->setPoseCache(&m_pose_cache);
+                m_radar_display->showRadar(m_show_radar);
+                m_radar_display->setViewport(m_viewport);
+                m_radar_display->setOccupancy(&m_radar_occupancy);
+                connect(m_radar_display, &RadarDisplay::targetsUpdated, this, [this](){m_radar_target_layer->invalidate();});
+            }
+            int radar_threads = ros::param::param("~radar/worker_threads", 0);
+            if(radar_threads > 0)
+                m_radar_display->setWorkerThreads(radar_threads);
+            RadarTargetParameters target_parameters;
+            target_parameters.threshold = ros::param::param("~radar/targets/threshold", target_parameters.threshold);
+            target_parameters.min_cells = ros::param::param("~radar/targets/min_cells", target_parameters.min_cells);
+            target_parameters.max_extent = ros::param::param("~radar/targets/max_extent", target_parameters.max_extent);
+            target_parameters.blind_range = ros::param::param("~radar/targets/blind_range", target_parameters.blind_range);
+            target_parameters.gate = ros::param::param("~radar/targets/gate", target_parameters.gate);
+            target_parameters.confirm_hits = ros::param::param("~radar/targets/confirm_hits", target_parameters.confirm_hits);
+            target_parameters.max_misses = ros::param::param("~radar/targets/max_misses", target_parameters.max_misses);
+            m_radar_display->setTargetParameters(target_parameters);
+            m_log_radar_timings = ros::param::param("~radar/log_timings", false);
+            m_radar_occupancy.setHitIntensity(ros::param::param("~radar/occupancy/hit_intensity", 8));
+            m_radar_occupancy.setDecayTime(ros::param::param("~radar/occupancy/decay_time", 60.0));
+            discoverRadars();
             
             m_send_command_publisher = m_node->advertise<std_msgs::String>("/"+robotNamespace+"/project11/send_command",1);
             m_look_at_publisher = m_node->advertise<geographic_msgs::GeoPoint>("base/camera/look_at",1);
@@ -97,18 +184,60 @@ void ROSLink::connectROS()
             double latitude, longitude;
             if(m_node->getParam("base/latitude",latitude) && m_node->getParam("base/longitude",longitude))
             {
-                m_base_location.location.setLatitude(latitude);
-                m_base_location.location.setLongitude(longitude);
+                m_base_location.location = GeoPoint(latitude, longitude);
                 m_base_location.pos = geoToPixel(m_base_location.location,autonomousVehicleProject());
             }
             
             m_node->param("base/heading", m_base_heading, m_base_heading);
+
+            // Telemetry is collected at the display rate. Position and speed
+            // histories keep every sample unless asked to keep only the latest.
+            double display_rate = ros::param::param("~display/rate", 30.0);
+            if(display_rate > 0.0)
+                m_display_timer->setInterval(std::max(1, int(1000.0/display_rate)));
+            bool keep_all = ros::param::param("~display/keep_all_samples", true);
+            TelemetryMailbox<TimedPosition>::Policy policy = keep_all ? TelemetryMailbox<TimedPosition>::KeepAll : TelemetryMailbox<TimedPosition>::LatestOnly;
+            m_location_mailbox.setPolicy(policy);
+            m_posmv_location_mailbox.setPolicy(policy);
+            m_base_location_mailbox.setPolicy(policy);
+            m_sog_mailbox.setPolicy(keep_all ? TelemetryMailbox<qreal>::KeepAll : TelemetryMailbox<qreal>::LatestOnly);
+
+            // Display items not refreshed within the time to live are dropped,
+            // 0 keeps them until deleted. Past the memory budget, the least
+            // recently updated items are evicted.
+            m_display_item_ttl = ros::param::param("~display/item_ttl", 0.0);
+            m_display_memory_budget = std::max(0.0, ros::param::param("~display/memory_budget_mb", 64.0))*1024*1024;
+
+            // Coverage is accumulated in cells of this size, in meters.
+            m_coverage_cell_size = std::max(0.01, ros::param::param("~coverage/cell_size", 1.0));
+            rebuildCoverage();
+
+            // Soundings are binned in cells of this size, in meters, and
+            // coloured by minimum or mean depth, or by sounding density.
+            // Equal depth limits let the colour range follow the data.
+            m_ping_grid.setCellSize(ros::param::param("~pings/cell_size", 1.0));
+            std::string ping_statistic = ros::param::param<std::string>("~pings/statistic", "mean");
+            if(ping_statistic == "min")
+                m_ping_grid.setStatistic(PingGrid::MinimumDepth);
+            else if(ping_statistic == "density")
+                m_ping_grid.setStatistic(PingGrid::Density);
+            else
+                m_ping_grid.setStatistic(PingGrid::MeanDepth);
+            m_ping_grid.setDepthRange(ros::param::param("~pings/min_depth", 0.0), ros::param::param("~pings/max_depth", 0.0));
+
+            // Gridded soundings replace the depth raster's own once a cell
+            // has this many.
+            m_depth_model.setMinimumSoundings(ros::param::param("~live_depth/min_soundings", 3));
             
-            //m_radar_displays["/radar/HaloA/data"]->setPos(m_base_location.pos);
-            //m_radar_displays["/radar/HaloA/data"]->setRotation(m_base_heading);
+            //m_radar_display->setPos(m_base_location.pos);
+            //m_radar_display->setRotation(m_base_heading);
             
             m_spinner->start();
+            startSpinners();
             m_watchdog_timer->start(500);
+            m_radar_discovery_timer->start(5000);
+            m_vehicle_layer->update();
+            m_posmv_layer->update();
             emit rosConnected(true);
         }
     }
@@ -116,65 +245,377 @@ void ROSLink::connectROS()
     {
         if(m_node)
         {
+            m_radar_discovery_timer->stop();
+            m_radar_subscribers.clear();
+            m_ping_filter.reset();
+            m_ping_subscriber.reset();
+            stopSpinners();
             delete m_node;
             m_node = nullptr;
             delete m_spinner;
             m_spinner = nullptr;
+            m_vehicle_layer->update();
+            m_posmv_layer->update();
             emit rosConnected(false);
         }
     }
     QTimer::singleShot(1000,this,SLOT(connectROS()));
 }
 
+void ROSLink::configureCallbackGroups()
+{
+    static const char *names[TrafficClassCount] = {"navigation", "contacts", "display", "commands", "radar"};
+    static const int default_depths[TrafficClassCount] = {10, 100, 10, 10, 300};
+    for(int i = 0; i < TrafficClassCount; i++)
+    {
+        std::string prefix = std::string("~callback_queues/")+names[i];
+        m_callback_groups[i].threads = std::max(1, ros::param::param(prefix+"/threads", 1));
+        m_callback_groups[i].queue_depth = std::max(1, ros::param::param(prefix+"/queue_depth", default_depths[i]));
+    }
+}
+
+template<typename M> ros::Subscriber ROSLink::subscribe(TrafficClass traffic, std::string const &topic, void (ROSLink::*callback)(const boost::shared_ptr<M const>&))
+{
+    CallbackGroup &group = m_callback_groups[traffic];
+    ros::SubscribeOptions ops = ros::SubscribeOptions::create<M>(topic, group.queue_depth, boost::bind(callback, this, _1), ros::VoidPtr(), &group.queue);
+    return m_node->subscribe(ops);
+}
+
+void ROSLink::startSpinners()
+{
+    for(auto &group: m_callback_groups)
+    {
+        group.spinner = std::make_shared<ros::AsyncSpinner>(group.threads, &group.queue);
+        group.spinner->start();
+    }
+}
+
+void ROSLink::stopSpinners()
+{
+    for(auto &group: m_callback_groups)
+    {
+        if(group.spinner)
+            group.spinner->stop();
+        group.spinner.reset();
+        group.queue.clear();
+    }
+}
+
 QRectF ROSLink::boundingRect() const
 {
-    return shape().boundingRect();
+    // Everything is drawn by the layers.
+    return QRectF();
+}
+
+void ROSLink::createLayers()
+{
+    // The path is the selected survey area's gaps, the coverage itself is
+    // drawn from the mask's tiles.
+    m_coverage_layer = new PathLayer(this, [this](){return coverageShape();}, [this](QPainter *painter, QPainterPath const &path, QStyleOptionGraphicsItem const *option)
+    {
+        m_coverage_mask.paint(painter, option->exposedRect, Qt::cyan);
+        if(!path.isEmpty())
+        {
+            painter->setPen(Qt::NoPen);
+            painter->setBrush(QColor(255, 0, 0, 96));
+            painter->drawPath(path);
+        }
+    }, [this](){return m_coverage_mask.bounds().united(m_coverage_gaps.boundingRect());});
+
+    m_ping_layer = new PathLayer(this, PathLayer::BuildFunction(), [this](QPainter *painter, QPainterPath const &, QStyleOptionGraphicsItem const *option)
+    {
+        for(auto const &tile: m_ping_tiles)
+            if(tile.second.bounds.intersects(option->exposedRect))
+            {
+                painter->save();
+                painter->setTransform(tile.second.transform, true);
+                painter->drawImage(QPointF(0.0, 0.0), tile.second.image);
+                painter->restore();
+            }
+    }, [this](){return pingBounds();});
+
+    m_ais_layer = new PathLayer(this, [this](){return aisShape();}, [](QPainter *painter, QPainterPath const &path, QStyleOptionGraphicsItem const *)
+    {
+        QPen p;
+        p.setCosmetic(true);
+        p.setColor(Qt::blue);
+        p.setWidth(2);
+        painter->setPen(p);
+        painter->drawPath(path);
+    });
+
+    m_display_layer = new PathLayer(this, [this](){return displayShape();}, [this](QPainter *painter, QPainterPath const &, QStyleOptionGraphicsItem const *option)
+    {
+        paintDisplayItems(painter, option->exposedRect);
+    });
+
+    m_base_layer = new PathLayer(this, [this](){return baseShape();}, [](QPainter *painter, QPainterPath const &path, QStyleOptionGraphicsItem const *)
+    {
+        QPen p;
+        p.setCosmetic(true);
+        p.setColor(Qt::darkBlue);
+        p.setWidth(5);
+        painter->setPen(p);
+        painter->drawPath(path);
+        p.setWidth(3);
+        p.setColor(Qt::lightGray);
+        painter->setPen(p);
+        painter->drawPath(path);
+    });
+
+    m_archive_layer = new PathLayer(this, PathLayer::BuildFunction(), [this](QPainter *painter, QPainterPath const &, QStyleOptionGraphicsItem const *option)
+    {
+        if(!m_show_tail)
+            return;
+        QRectF exposed = option->exposedRect;
+        QPen p;
+        p.setCosmetic(true);
+        p.setWidth(2);
+        p.setColor(Qt::lightGray);
+        painter->setPen(p);
+        painter->drawPath(archiveShape(m_base_location_archive, m_base_location_archive_cache, exposed));
+        p.setColor(Qt::darkYellow);
+        painter->setPen(p);
+        painter->drawPath(archiveShape(m_location_archive, m_location_archive_cache, exposed));
+        p.setColor(Qt::yellow);
+        painter->setPen(p);
+        painter->drawPath(archiveShape(m_posmv_location_archive, m_posmv_location_archive_cache, exposed));
+    }, [this](){return m_show_tail && m_have_archive_bounds ? m_archive_bounds.marginsAdded(QMarginsF(1.0, 1.0, 1.0, 1.0)) : QRectF();});
+
+    m_vehicle_layer = new PathLayer(this, [this](){return vehicleShape();}, [this](QPainter *painter, QPainterPath const &path, QStyleOptionGraphicsItem const *)
+    {
+        QPen p;
+        p.setCosmetic(true);
+        p.setWidth(9);
+        p.setColor(Qt::black);
+        painter->setPen(p);
+        painter->drawPath(path);
+        p.setWidth(6);
+        p.setColor(Qt::darkYellow);
+        painter->setPen(p);
+        painter->drawPath(path);
+        if(m_node)
+            p.setColor(Qt::darkGreen);
+        else
+            p.setColor(Qt::darkRed);
+        p.setWidth(3);
+        painter->setPen(p);
+        painter->drawPath(path);
+    });
+
+    m_posmv_layer = new PathLayer(this, [this](){return vehicleShapePosmv();}, [this](QPainter *painter, QPainterPath const &path, QStyleOptionGraphicsItem const *)
+    {
+        QPen p;
+        p.setCosmetic(true);
+        p.setWidth(11);
+        p.setColor(Qt::black);
+        painter->setPen(p);
+        painter->drawPath(path);
+        p.setWidth(8);
+        p.setColor(Qt::yellow);
+        painter->setPen(p);
+        painter->drawPath(path);
+        p.setWidth(3);
+        if(m_node)
+            p.setColor(Qt::darkGreen);
+        else
+            p.setColor(Qt::darkRed);
+        painter->setPen(p);
+        painter->drawPath(path);
+    });
+
+    m_radar_target_layer = new PathLayer(this, [this](){return radarTargetShape();}, [](QPainter *painter, QPainterPath const &path, QStyleOptionGraphicsItem const *)
+    {
+        QPen p;
+        p.setCosmetic(true);
+        p.setColor(QColor(255, 128, 0));
+        p.setWidth(2);
+        painter->setPen(p);
+        painter->drawPath(path);
+    });
+}
+
+void ROSLink::invalidateLayers()
+{
+    for(auto layer: {m_coverage_layer, m_ping_layer, m_ais_layer, m_display_layer, m_base_layer, m_archive_layer, m_vehicle_layer, m_posmv_layer, m_radar_target_layer})
+        layer->invalidate();
+}
+
+void ROSLink::updateMapScale()
+{
+    // Vehicle symbols and simplified tails depend on the scale.
+    invalidateLayers();
+}
+
+void ROSLink::openArchives(std::string const &robotNamespace)
+{
+    QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)+"/track_archive/"+robotNamespace.c_str();
+    if(!QDir().mkpath(path))
+    {
+        qDebug() << "Unable to create track archive directory" << path;
+        return;
+    }
+    // Older sessions are dropped as the archives are opened, so they
+    // don't pile up and all get drawn.
+    double max_age = ros::param::param("~archive/max_age_days", 30.0)*24.0*3600.0;
+    double oldest = max_age > 0.0 ? ros::Time::now().toSec()-max_age : 0.0;
+    if(!m_location_archive.isOpen())
+        m_location_archive.open(path+"/location", oldest);
+    if(!m_posmv_location_archive.isOpen())
+        m_posmv_location_archive.open(path+"/posmv_location", oldest);
+    if(!m_base_location_archive.isOpen())
+        m_base_location_archive.open(path+"/base_location", oldest);
+    updateArchiveBounds();
+    m_archive_layer->invalidate();
+}
+
+void ROSLink::archive(TrackArchive &archive, double time, LocationPosition const &location)
+{
+    if(!archive.isOpen())
+        return;
+    bool sealed = archive.append(time, location.location);
+    if(!m_have_archive_bounds)
+    {
+        m_archive_bounds = QRectF(location.pos, QSizeF(0.0, 0.0));
+        m_have_archive_bounds = true;
+    }
+    else
+    {
+        m_archive_bounds.setLeft(std::min(m_archive_bounds.left(), location.pos.x()));
+        m_archive_bounds.setRight(std::max(m_archive_bounds.right(), location.pos.x()));
+        m_archive_bounds.setTop(std::min(m_archive_bounds.top(), location.pos.y()));
+        m_archive_bounds.setBottom(std::max(m_archive_bounds.bottom(), location.pos.y()));
+    }
+    // The in memory tails cover the chunk being filled, so the archive
+    // layer is only refreshed now and then rather than on every position.
+    if(sealed || !m_archive_refresh.isValid() || m_archive_refresh.elapsed() > 5000)
+    {
+        m_archive_layer->invalidate();
+        m_archive_refresh.start();
+    }
+}
+
+void ROSLink::updateArchiveBounds()
+{
+    m_archive_bounds = QRectF();
+    m_have_archive_bounds = false;
+    AutonomousVehicleProject *avp = autonomousVehicleProject();
+    for(TrackArchive const *track: {&m_location_archive, &m_posmv_location_archive, &m_base_location_archive})
+    {
+        double min_lat, min_lon, max_lat, max_lon;
+        if(track->bounds(min_lat, min_lon, max_lat, max_lon))
+        {
+            QPolygonF corners;
+            corners << geoToPixel(GeoPoint(min_lat, min_lon),avp) << geoToPixel(GeoPoint(min_lat, max_lon),avp) << geoToPixel(GeoPoint(max_lat, max_lon),avp) << geoToPixel(GeoPoint(max_lat, min_lon),avp);
+            m_archive_bounds = m_have_archive_bounds ? m_archive_bounds.united(corners.boundingRect()) : corners.boundingRect();
+            m_have_archive_bounds = true;
+        }
+    }
+}
+
+QPainterPath ROSLink::archiveShape(TrackArchive const &archive, ArchiveCache &cache, QRectF const &rect)
+{
+    QPainterPath ret;
+    auto avp = autonomousVehicleProject();
+    if(!avp || !archive.isOpen())
+        return ret;
+    auto bg = avp->getBackgroundRaster();
+    if(!bg)
+        return ret;
+
+    // local positions are relative to the parent item, as in geoToPixel
+    QPointF offset;
+    if(parentItem())
+        offset = parentItem()->scenePos();
+    QRectF bg_rect = rect.translated(offset);
+    QGeoCoordinate corners[4] = {bg->pixelToGeo(bg_rect.topLeft()), bg->pixelToGeo(bg_rect.topRight()), bg->pixelToGeo(bg_rect.bottomLeft()), bg->pixelToGeo(bg_rect.bottomRight())};
+    double min_lat = corners[0].latitude();
+    double max_lat = min_lat;
+    double min_lon = corners[0].longitude();
+    double max_lon = min_lon;
+    for(auto const &c: corners)
+    {
+        min_lat = std::min(min_lat, c.latitude());
+        max_lat = std::max(max_lat, c.latitude());
+        min_lon = std::min(min_lon, c.longitude());
+        max_lon = std::max(max_lon, c.longitude());
+    }
+
+    // keep vertices about a screen pixel apart
+    int level = TrackArchive::levelFor(bg->scaledPixelSize());
+    for(auto chunk: archive.visibleChunks(min_lat, min_lon, max_lat, max_lon))
+    {
+        auto key = std::make_pair(chunk, level);
+        auto cached = cache.find(key);
+        if(cached != cache.end())
+        {
+            ret.addPolygon(cached->second);
+            continue;
+        }
+        std::vector<GeoPoint> points = archive.points(chunk, level);
+        QPolygonF polyline(points.size());
+        bg->geoToPixel(points.data(), polyline.data(), points.size());
+        polyline.translate(-offset);
+        ret.addPolygon(polyline);
+        // the chunk being filled still changes
+        if(archive.sealed(chunk))
+            cache[key] = polyline;
+    }
+    return ret;
 }
 
 void ROSLink::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+}
+
+void ROSLink::paintDisplayItems(QPainter* painter, QRectF const &exposed) const
 {
     painter->save();
 
     QPen p;
     p.setCosmetic(true);
 
-    
-    p.setColor(Qt::green);
-    p.setWidth(4);
-    painter->setPen(p);
-    painter->setBrush(Qt::cyan);
-    painter->drawPath(coverageShape());
-    //painter->drawPath(pingsShape());
-    painter->setBrush(Qt::NoBrush);
-
+    // pen widths are in screen pixels, bounds in item coordinates
+    qreal scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    if(scale <= 0.0)
+        scale = 1.0;
 
-    
-    p.setColor(Qt::blue);
-    p.setWidth(2);
-    painter->setPen(p);
-    painter->drawPath(aisShape());
-
-    for(auto display_item: m_display_items)
+    for(auto const &display_item: m_display_items)
     {
-        for (auto point_group: display_item.second->point_groups)
+        std::shared_ptr<geoviz::RenderBatch const> batch = display_item.second.item->batch;
+        if(!batch)
+            continue;
+        qreal margin = batch->max_size/scale;
+        if(!batch->bounds.adjusted(-margin,-margin,margin,margin).intersects(exposed))
+            continue;
+
+        for(auto const &point_group: batch->point_groups)
         {
+            margin = point_group.size/scale;
+            if(!point_group.bounds.adjusted(-margin,-margin,margin,margin).intersects(exposed))
+                continue;
             p.setColor(point_group.color);
             p.setWidth(point_group.size);
             painter->setPen(p);
-            for(auto point: point_group.points)
-                painter->drawPoint(point.pos);
+            painter->drawPoints(point_group.points);
         }
         
-        for(auto line: display_item.second->lines)
+        for(auto const &line: batch->lines)
         {
+            margin = line.size/scale;
+            if(!line.bounds.adjusted(-margin,-margin,margin,margin).intersects(exposed))
+                continue;
             p.setColor(line.color);
             p.setWidth(line.size);
             painter->setPen(p);
-            painter->drawPath(shape(line.points));
+            painter->drawPath(line.path);
         }
         
-        for(auto polygon: display_item.second->polygons)
+        for(auto const &polygon: batch->polygons)
         {
+            margin = polygon.edge_size/scale;
+            if(!polygon.bounds.adjusted(-margin,-margin,margin,margin).intersects(exposed))
+                continue;
             p.setColor(polygon.edge_color);
             p.setWidth(polygon.edge_size);
             painter->setPen(p);
@@ -184,118 +625,23 @@ void ROSLink::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, Q
         painter->setBrush(Qt::NoBrush);
     }
 
-    if(m_show_radar)
-    {
-        auto avp = autonomousVehicleProject();
-        if(avp)
-        {
-            auto bg = avp->getBackgroundRaster();
-            if(bg)
-            {
-                painter->save();
-                painter->translate(m_base_location.pos);
-                for(auto rd:m_radar_displays)
-                {
-                    //rd.second->paint(painter, option, widget);
-                }
-                painter->restore();
-            }
-        }
-    }
-    
-    
-    p.setColor(Qt::darkBlue);
-    p.setWidth(5);
-    painter->setPen(p);
-    painter->drawPath(baseShape());
-    p.setWidth(3);
-    p.setColor(Qt::lightGray);
-    painter->setPen(p);
-    painter->drawPath(baseShape());
-
-    p.setWidth(9);
-    p.setColor(Qt::black);
-    painter->setPen(p);
-    painter->drawPath(vehicleShape());
-    p.setWidth(6);
-    p.setColor(Qt::darkYellow);
-    painter->setPen(p);
-    painter->drawPath(vehicleShape());
-    p.setWidth(3);
-    if(m_node)
-        p.setColor(Qt::darkGreen);
-    else
-        p.setColor(Qt::darkRed);
-    p.setWidth(3);
-    painter->setPen(p);
-    painter->drawPath(vehicleShape());
-
-    p.setWidth(11);
-    p.setColor(Qt::black);
-    painter->setPen(p);
-    painter->drawPath(vehicleShapePosmv());
-    p.setWidth(8);
-    p.setColor(Qt::yellow);
-    painter->setPen(p);
-    painter->drawPath(vehicleShapePosmv());
-    p.setWidth(3);
-    if(m_node)
-        p.setColor(Qt::darkGreen);
-    else
-        p.setColor(Qt::darkRed);
-    painter->setPen(p);
-    painter->drawPath(vehicleShapePosmv());
-
-
     painter->restore();
 }
 
 QPainterPath ROSLink::shape() const
 {
     QPainterPath ret;
-    ret.addPath(vehicleShape());
-    ret.addPath(vehicleShapePosmv());
-    ret.addPath(aisShape());
-    ret.addPath(baseShape());
-    ret.addPath(coverageShape());
-    ret.addPath(pingsShape());
-    
-    for(auto display_item: m_display_items)
-    {
-        for(auto plist: display_item.second->point_groups)
-        {
-            for(auto p: plist.points)
-                ret.addEllipse(p.pos,plist.size,plist.size);
-        }
-        for(auto line: display_item.second->lines)
-        {
-            ret.addPath(shape(line.points));
-        }
-        for(auto polygon: display_item.second->polygons)
-        {
-            ret.addPath(polygon.path);
-        }
-    }
-
-//     for(auto radar_sector: m_radar_sectors)
-//     {
-//         //ret.moveTo(radar_sector.second->origin.pos);
-//         //ret.addPixmap(radar_sector.second->sector);
-//         ret.addRect(radar_sector.second->origin.pos.x(),radar_sector.second->origin.pos.y(),radar_sector.second->sector.width(),radar_sector.second->sector.height());
-//     }
+    for(auto layer: {m_coverage_layer, m_ais_layer, m_display_layer, m_base_layer, m_vehicle_layer, m_posmv_layer})
+        ret.addPath(layer->shape());
+    return ret;
+}
 
-    auto avp = autonomousVehicleProject();
-    if(avp)
-    {
-        auto bg = avp->getBackgroundRaster();
-        if(bg)
-        {
-//             double pixelSize = bg->pixelSize();
-//             double s = m_radar_scale/pixelSize;
-//             ret.addRect(QRectF(geoToPixel(m_location,autonomousVehicleProject())+QPointF(-512*s*1.1,-512*s*1.1),QSizeF(1024*s*1.1,1024*s*1.1)));
-        }
-    }
-    
+QPainterPath ROSLink::displayShape() const
+{
+    QPainterPath ret;
+    for(auto const &display_item: m_display_items)
+        if(display_item.second.item->batch)
+            ret.addPath(display_item.second.item->batch->shape);
     return ret;
 }
 
@@ -320,20 +666,10 @@ QPainterPath ROSLink::vehicleShape() const
 {
     auto bgr = autonomousVehicleProject()->getBackgroundRaster();
     QPainterPath ret;
-    if (m_local_location_history.size() > 1)
+    if (m_location_history.size() > 1)
     {
         if(m_show_tail)
-        {
-            auto p = m_local_location_history.begin();
-            ret.moveTo(*p);
-            p++;
-            while(p != m_local_location_history.end())
-            {
-                ret.lineTo(*p);
-                p++;
-            }
-        }
-        auto last = *(m_local_location_history.rbegin());
+            ret.addPolygon(m_location_tail.simplified(bgr ? bgr->mapScale() : 0.0));
         
         if(bgr)
         {
@@ -352,23 +688,13 @@ QPainterPath ROSLink::vehicleShape() const
 
 QPainterPath ROSLink::vehicleShapePosmv() const
 {
+    auto bgr = autonomousVehicleProject()->getBackgroundRaster();
     QPainterPath ret;
-    if (m_local_posmv_location_history.size() > 1)
+    if (m_posmv_location_history.size() > 1)
     {
         if(m_show_tail)
-        {
-            auto p = m_local_posmv_location_history.begin();
-            ret.moveTo(*p);
-            p++;
-            while(p != m_local_posmv_location_history.end())
-            {
-                ret.lineTo(*p);
-                p++;
-            }
-            auto last = *(m_local_posmv_location_history.rbegin());
-        }
+            ret.addPolygon(m_posmv_location_tail.simplified(bgr ? bgr->mapScale() : 0.0));
         
-        auto bgr = autonomousVehicleProject()->getBackgroundRaster();
         if(bgr)
         {
             qreal pixel_size = bgr->scaledPixelSize();
@@ -384,22 +710,12 @@ QPainterPath ROSLink::vehicleShapePosmv() const
 
 QPainterPath ROSLink::baseShape() const
 {
+    auto bgr = autonomousVehicleProject()->getBackgroundRaster();
     QPainterPath ret;
     if (m_base_location_history.size() > 1)
-    {
-        auto p = m_base_location_history.begin();
-        ret.moveTo(p->pos);
-        p++;
-        while(p != m_base_location_history.end())
-        {
-            ret.lineTo(p->pos);
-            p++;
-        }
-        //auto last = *(m_base_location_history.rbegin());
-    }
+        ret.addPolygon(m_base_location_tail.simplified(bgr ? bgr->mapScale() : 0.0));
     if(m_base_location.location.isValid())
     {
-        auto bgr = autonomousVehicleProject()->getBackgroundRaster();
         if(bgr)
         {
             qreal pixel_size = bgr->scaledPixelSize();
@@ -417,7 +733,7 @@ QPainterPath ROSLink::baseShape() const
 QPainterPath ROSLink::aisShape() const
 {
     QPainterPath ret;
-    for(auto contactList: m_contacts)
+    for(auto const &contactList: m_contacts)
     {
         if((ros::Time::now() - contactList.second.back()->timestamp) < ros::Duration(300))
         {
@@ -450,65 +766,48 @@ QPainterPath ROSLink::aisShape() const
     return ret;
 }
 
-QPainterPath ROSLink::coverageShape() const
-{
-    QPainterPath ret;
-    for(auto p: m_local_coverage)
-        ret.addPolygon(p);
-//     QPolygonF poly;
-//     if(!m_local_coverage.empty())
-//     {
-//         auto p = m_local_coverage.begin();
-//         poly << *p;
-//         //ret.moveTo(*p);
-//         p++;
-//         while(p != m_local_coverage.end())
-//         {
-//             poly << *p;
-//             //ret.lineTo(*p);
-//             p++;
-//         }
-//         ret.addPolygon(poly);
-//         //ret.lineTo(m_local_coverage.front());
-//     }
-    
-    return ret;
-}
-
-QPainterPath ROSLink::pingsShape() const
+QPainterPath ROSLink::radarTargetShape() const
 {
     QPainterPath ret;
-    QPolygonF poly;
-    for(auto p: m_local_pings)
-        if(!p.empty())
+    auto avp = autonomousVehicleProject();
+    BackgroundRaster *bgr = avp ? avp->getBackgroundRaster() : nullptr;
+    if(!m_radar_display || !bgr)
+        return ret;
+    // A box around each target, at least a few screen pixels across, and
+    // a line to where it will be in a minute.
+    qreal pixel_size = bgr->scaledPixelSize();
+    for(auto const &target: m_radar_display->targets())
+    {
+        double half = std::max(target.extent/2.0, 5*pixel_size);
+        QPointF corners[4] = {{-half, -half}, {half, -half}, {half, half}, {-half, half}};
+        ret.moveTo(geoToPixel(rosMapToGeo(target.position+corners[3]), avp));
+        for(auto const &corner: corners)
+            ret.lineTo(geoToPixel(rosMapToGeo(target.position+corner), avp));
+        QPointF velocity = target.velocity;
+        if(std::sqrt(velocity.x()*velocity.x()+velocity.y()*velocity.y()) > 0.5)
         {
-            auto pp = p.begin();
-            poly << *pp;
-            //ret.moveTo(*p);
-            pp++;
-            while(pp != p.end())
-            {
-                poly << *pp;
-                //ret.lineTo(*p);
-                pp++;
-            }
-            ret.addPolygon(poly);
-            //ret.lineTo(m_local_coverage.front());
+            ret.moveTo(geoToPixel(rosMapToGeo(target.position), avp));
+            ret.lineTo(geoToPixel(rosMapToGeo(target.position+velocity*60.0), avp));
         }
-    
+    }
     return ret;
 }
 
+QPainterPath ROSLink::coverageShape() const
+{
+    return m_coverage_gaps;
+}
 
-void ROSLink::drawTriangle(QPainterPath& path, const QGeoCoordinate& location, double heading_degrees, double scale) const
+void ROSLink::drawTriangle(QPainterPath& path, const GeoPoint& location, double heading_degrees, double scale) const
 {
-    QGeoCoordinate tip = location.atDistanceAndAzimuth(15*scale,heading_degrees);
-    QGeoCoordinate llcorner = location.atDistanceAndAzimuth(15*scale,heading_degrees-150);
-    QGeoCoordinate lrcorner = location.atDistanceAndAzimuth(15*scale,heading_degrees+150);
+    double azimuths[3] = {heading_degrees, heading_degrees-150, heading_degrees+150};
+    double distances[3] = {15*scale, 15*scale, 15*scale};
+    double latitudes[3], longitudes[3];
+    gz4d::LocalTangent(location.latitude(), location.longitude()).direct(azimuths, distances, latitudes, longitudes, 3);
 
-    QPointF ltip = geoToPixel(tip,autonomousVehicleProject());
-    QPointF lllocal = geoToPixel(llcorner,autonomousVehicleProject());
-    QPointF lrlocal = geoToPixel(lrcorner,autonomousVehicleProject());
+    QPointF ltip = geoToPixel(GeoPoint(latitudes[0], longitudes[0]),autonomousVehicleProject());
+    QPointF lllocal = geoToPixel(GeoPoint(latitudes[1], longitudes[1]),autonomousVehicleProject());
+    QPointF lrlocal = geoToPixel(GeoPoint(latitudes[2], longitudes[2]),autonomousVehicleProject());
 
     path.moveTo(ltip);
     path.lineTo(lllocal);
@@ -516,22 +815,26 @@ void ROSLink::drawTriangle(QPainterPath& path, const QGeoCoordinate& location, d
     path.lineTo(ltip);
 }
 
-void ROSLink::drawShipOutline(QPainterPath& path, const QGeoCoordinate& location, double heading_degrees, float dimension_to_bow, float dimension_to_port, float dimension_to_stbd, float dimension_to_stern) const
+void ROSLink::drawShipOutline(QPainterPath& path, const GeoPoint& location, double heading_degrees, float dimension_to_bow, float dimension_to_port, float dimension_to_stbd, float dimension_to_stern) const
 {
         float length = dimension_to_bow+dimension_to_stern;
         float width = dimension_to_port+dimension_to_stbd;
-        QGeoCoordinate llcorner = location.atDistanceAndAzimuth(dimension_to_port,270+heading_degrees).atDistanceAndAzimuth(dimension_to_stern,180+heading_degrees);
-        QGeoCoordinate lrcorner = llcorner.atDistanceAndAzimuth(width,90+heading_degrees);
-        QGeoCoordinate urcorner = lrcorner.atDistanceAndAzimuth(length,heading_degrees);
-        QGeoCoordinate ulcorner = urcorner.atDistanceAndAzimuth(width,270+heading_degrees);
-        QGeoCoordinate rkink = lrcorner.atDistanceAndAzimuth(length*.8,heading_degrees);
-        QGeoCoordinate lkink = llcorner.atDistanceAndAzimuth(length*.8,heading_degrees);
-        QGeoCoordinate bow = ulcorner.atDistanceAndAzimuth(width/2.0,90+heading_degrees);
-        QPointF lllocal = geoToPixel(llcorner,autonomousVehicleProject());
-        QPointF lrlocal = geoToPixel(lrcorner,autonomousVehicleProject());
-        QPointF lkinkl = geoToPixel(lkink,autonomousVehicleProject());
-        QPointF rkinkl = geoToPixel(rkink,autonomousVehicleProject());
-        QPointF bowl = geoToPixel(bow,autonomousVehicleProject());
+        // outline corners in ship frame: lower left, lower right, right kink, bow, left kink
+        double forward[5] = {-dimension_to_stern, -dimension_to_stern, length*.8-dimension_to_stern, dimension_to_bow, length*.8-dimension_to_stern};
+        double starboard[5] = {-dimension_to_port, dimension_to_stbd, dimension_to_stbd, width/2.0-dimension_to_port, -dimension_to_port};
+        double heading = gz4d::Radians(heading_degrees);
+        double east[5], north[5], latitudes[5], longitudes[5];
+        for(int i = 0; i < 5; i++)
+        {
+            east[i] = forward[i]*sin(heading)+starboard[i]*cos(heading);
+            north[i] = forward[i]*cos(heading)-starboard[i]*sin(heading);
+        }
+        gz4d::LocalTangent(location.latitude(), location.longitude()).toGeodetic(east, north, latitudes, longitudes, 5);
+        QPointF lllocal = geoToPixel(GeoPoint(latitudes[0], longitudes[0]),autonomousVehicleProject());
+        QPointF lrlocal = geoToPixel(GeoPoint(latitudes[1], longitudes[1]),autonomousVehicleProject());
+        QPointF rkinkl = geoToPixel(GeoPoint(latitudes[2], longitudes[2]),autonomousVehicleProject());
+        QPointF bowl = geoToPixel(GeoPoint(latitudes[3], longitudes[3]),autonomousVehicleProject());
+        QPointF lkinkl = geoToPixel(GeoPoint(latitudes[4], longitudes[4]),autonomousVehicleProject());
         
         path.moveTo(lllocal);
         path.lineTo(lrlocal);
@@ -558,14 +861,14 @@ void ROSLink::setROSDetails(ROSDetails* details)
 
 void ROSLink::gpsPositionCallback(const sensor_msgs::NavSatFix::ConstPtr& message)
 {
-    QGeoCoordinate position(message->latitude, message->longitude, message->altitude);
-    QMetaObject::invokeMethod(this,"updateLocation", Qt::QueuedConnection, Q_ARG(QGeoCoordinate, position));
+    m_pose_cache.addPosition("vehicle", messageTime(message->header.stamp), GeoPoint(message->latitude, message->longitude, message->altitude));
+    m_location_mailbox.post(TimedPosition{GeoPoint(message->latitude, message->longitude, message->altitude), ros::Time::now().toSec()});
 }
 
 void ROSLink::posmvPositionCallback(const sensor_msgs::NavSatFix::ConstPtr& message)
 {
-    QGeoCoordinate position(message->latitude, message->longitude, message->altitude);
-    QMetaObject::invokeMethod(this,"updatePosmvLocation", Qt::QueuedConnection, Q_ARG(QGeoCoordinate, position));
+    m_pose_cache.addPosition("posmv", messageTime(message->header.stamp), GeoPoint(message->latitude, message->longitude, message->altitude));
+    m_posmv_location_mailbox.post(TimedPosition{GeoPoint(message->latitude, message->longitude, message->altitude), ros::Time::now().toSec()});
 }
 
 void ROSLink::rangeCallback(const std_msgs::Float32::ConstPtr& message)
@@ -583,10 +886,16 @@ void ROSLink::bearingCallback(const std_msgs::Float32::ConstPtr& message)
 void ROSLink::sogCallback(const geometry_msgs::TwistWithCovarianceStamped::ConstPtr& message)
 {
     qreal sog = sqrt(message->twist.twist.linear.x*message->twist.twist.linear.x+message->twist.twist.linear.y*message->twist.twist.linear.y);
-    QMetaObject::invokeMethod(this,"updateSog", Qt::QueuedConnection, Q_ARG(qreal, sog));  
+    m_sog_mailbox.post(sog);
 }
 
 void ROSLink::updateSog(qreal sog)
+{
+    addSog(sog);
+    m_details->sogUpdate(m_sog,m_sog_avg);
+}
+
+void ROSLink::addSog(qreal sog)
 {
     // 1852m per NM
     m_sog = sog*1.9438;
@@ -598,14 +907,13 @@ void ROSLink::updateSog(qreal sog)
         sog_sum += s;
     m_sog_avg = sog_sum/m_sog_history.length();
     //qDebug() << m_sog << " knts, " << m_sog_avg << " knts avg";
-    m_details->sogUpdate(m_sog,m_sog_avg);
 }
 
 
 void ROSLink::baseNavSatFixCallback(const sensor_msgs::NavSatFix::ConstPtr& message)
 {
-    QGeoCoordinate position(message->latitude, message->longitude, message->altitude);
-    QMetaObject::invokeMethod(this,"updateBaseLocation", Qt::QueuedConnection, Q_ARG(QGeoCoordinate, position));
+    m_pose_cache.addPosition("base", messageTime(message->header.stamp), GeoPoint(message->latitude, message->longitude, message->altitude));
+    m_base_location_mailbox.post(TimedPosition{GeoPoint(message->latitude, message->longitude, message->altitude), ros::Time::now().toSec()});
 }
 
 void ROSLink::originCallback(const geographic_msgs::GeoPoint::ConstPtr& message)
@@ -622,7 +930,8 @@ void ROSLink::headingCallback(const sensor_msgs::Imu::ConstPtr& message)
   double yaw = tf2::getYaw(message->orientation);
   double heading = 90-180*yaw/M_PI;
 
-  QMetaObject::invokeMethod(this,"updateHeading", Qt::QueuedConnection, Q_ARG(double, heading));
+  m_pose_cache.addHeading("vehicle", messageTime(message->header.stamp), heading);
+  m_heading_mailbox.post(heading);
 }
 
 void ROSLink::posmvOrientationCallback(const sensor_msgs::Imu::ConstPtr& message)
@@ -630,12 +939,14 @@ void ROSLink::posmvOrientationCallback(const sensor_msgs::Imu::ConstPtr& message
   double yaw = tf2::getYaw(message->orientation);
   double heading = 90-180*yaw/M_PI;
 
-  QMetaObject::invokeMethod(this,"updatePosmvHeading", Qt::QueuedConnection, Q_ARG(double, heading));
+  m_pose_cache.addHeading("posmv", messageTime(message->header.stamp), heading);
+  m_posmv_heading_mailbox.post(heading);
 }
 
 void ROSLink::baseHeadingCallback(const marine_msgs::NavEulerStamped::ConstPtr& message)
 {
-    QMetaObject::invokeMethod(this,"updateBaseHeading", Qt::QueuedConnection, Q_ARG(double, message->orientation.heading));
+    m_pose_cache.addHeading("base", messageTime(message->header.stamp), message->orientation.heading);
+    m_base_heading_mailbox.post(message->orientation.heading);
 }
 
 
@@ -645,12 +956,23 @@ void ROSLink::contactCallback(const marine_msgs::Contact::ConstPtr& message)
     //qDebug() << "\t\t" << message->position.latitude << ", " << message->position.longitude;
     if(message->position.latitude > 90 || message->position.longitude > 180)
         return;
-    ROSAISContact *c = new ROSAISContact();
+    m_contact_queue.push(message);
+}
+
+ROSAISContact *ROSLink::makeAISContact(const marine_msgs::Contact::ConstPtr& message)
+{
+    ROSAISContact *c;
+    if(m_spare_contacts.empty())
+        c = new ROSAISContact(this);
+    else
+    {
+        c = m_spare_contacts.back();
+        m_spare_contacts.pop_back();
+    }
     c->timestamp = message->header.stamp;
     c->mmsi = message->mmsi;
     c->name = message->name;
-    c->location.setLatitude(message->position.latitude);
-    c->location.setLongitude(message->position.longitude);
+    c->location = GeoPoint(message->position.latitude, message->position.longitude);
     if(message->heading < 0)
         c->heading = message->cog*180.0/M_PI;
     else
@@ -659,7 +981,7 @@ void ROSLink::contactCallback(const marine_msgs::Contact::ConstPtr& message)
     c->dimension_to_port = message->dimension_to_port;
     c->dimension_to_stbd = message->dimension_to_stbd;
     c->dimension_to_stern = message->dimension_to_stern;
-    QMetaObject::invokeMethod(this,"addAISContact", Qt::QueuedConnection, Q_ARG(ROSAISContact*, c));
+    return c;
 }
 
 
@@ -679,10 +1001,43 @@ void ROSLink::missionStatusCallback(const marine_msgs::Heartbeat::ConstPtr& mess
 
 void ROSLink::watchdogUpdate()
 {
+    // Archived samples are written in batches rather than one by one.
+    m_location_archive.flush();
+    m_posmv_location_archive.flush();
+    m_base_location_archive.flush();
+
     if(m_node)
     {
         m_details->rangeAndBearingUpdate(m_range,m_range_timestamp,m_bearing,m_bearing_timestamp);
     }
+
+    if(m_contact_queue.dropped() != m_reported_contact_drops || m_display_queue.dropped() != m_reported_display_drops)
+    {
+        m_reported_contact_drops = m_contact_queue.dropped();
+        m_reported_display_drops = m_display_queue.dropped();
+        qDebug() << "Incoming queues full, dropped" << m_reported_contact_drops << "contacts and" << m_reported_display_drops << "display items so far";
+    }
+    if(m_ping_drops != m_reported_ping_drops)
+    {
+        m_reported_ping_drops = m_ping_drops;
+        qDebug() << "Dropped" << m_reported_ping_drops << "pings without a transform to" << m_mapFrame.c_str() << "so far";
+    }
+
+    updateCoverageSummary();
+
+    if(m_radar_display && m_log_radar_timings && (!m_radar_timings_logged.isValid() || m_radar_timings_logged.elapsed() >= 10000))
+    {
+        RadarDisplay::Timings timings = m_radar_display->timings();
+        qDebug() << "Radar pipeline, ms: store" << timings.store << "extract" << timings.extract << "track" << timings.track << "draw" << timings.draw << "turn" << timings.sweep << "after" << timings.sweeps << "turns";
+        m_radar_timings_logged.start();
+    }
+
+    if(expireDisplayItems() | enforceDisplayBudget())
+    {
+        geoviz::Stats stats = displayStats();
+        qDebug() << "Display items:" << stats.items << "live," << stats.vertices << "vertices," << stats.bytes/1024 << "KiB";
+        m_display_layer->invalidate();
+    }
 }
 
 
@@ -736,6 +1091,26 @@ void ROSLink::sendHover(const QGeoCoordinate& hoverLocation)
 
 void ROSLink::sendGoto(const QGeoCoordinate& gotoLocation)
 {
+    // Refuse to head straight into something the radar keeps seeing.
+    QGeoCoordinate from = m_location.isValid() ? m_location : m_posmv_location;
+    BackgroundRaster *raster = m_depth_overlay_raster;
+    if(raster && from.isValid())
+    {
+        QPointF start = raster->geoToPixel(GeoPoint(from.latitude(), from.longitude()));
+        QPointF end = raster->geoToPixel(GeoPoint(gotoLocation.latitude(), gotoLocation.longitude()));
+        int steps = std::ceil(std::max(std::abs(end.x()-start.x()), std::abs(end.y()-start.y())));
+        float blocking_cost = astar::Context().blockingCost;
+        for(int i = 0; i <= steps; i++)
+        {
+            QPointF p = steps > 0 ? start+(end-start)*(double(i)/steps) : start;
+            if(raster->getCost(std::floor(p.x()), std::floor(p.y())) >= blocking_cost)
+            {
+                emit warning("Goto not sent: radar obstacle on the direct path");
+                return;
+            }
+        }
+    }
+
     std::stringstream updates;
     updates << std::fixed << std::setprecision(7) << "mission_manager override goto " << gotoLocation.latitude() << " " << gotoLocation.longitude();
         
@@ -775,37 +1150,62 @@ void ROSLink::sendStartLine(int waypoint_index)
     sendCommand(updates.str());
 }
 
+QGeoCoordinate const &ROSLink::location() const
+{
+    return m_location;
+}
+
 void ROSLink::updateLocation(const QGeoCoordinate& location)
 {
-    prepareGeometryChange();
-    m_location_history.push_back(location);
-    m_local_location_history.push_back(geoToPixel(location,autonomousVehicleProject()));
-    while (m_local_location_history.size()>500|| (!m_show_tail && m_local_location_history.size()>2))
-        m_local_location_history.pop_front();
-    m_location = location;
-    for(auto rd:m_radar_displays)
-    {
-        //rd.second->setPos(m_local_location_history.back());
-    }
+    locationChanged(addLocation(TimedPosition{location, ros::Time::now().toSec()}));
+}
 
-    update();
+bool ROSLink::addLocation(TimedPosition const &sample)
+{
+    bool grown = m_location_history.add(sample.location, geoToPixel(sample.location,autonomousVehicleProject()), sample.time);
+    archive(m_location_archive, sample.time, m_location_history.back());
+    m_location = sample.location.toQGeoCoordinate();
+    return grown;
+}
+
+void ROSLink::locationChanged(bool grown)
+{
+    // Decimated samples only move the end of the tail, the simplified
+    // bands are kept.
+    if(grown)
+        m_location_tail.setPoints(m_location_history.positions());
+    else
+        m_location_tail.setLastPoint(m_location_history.back().pos);
+    //if(m_radar_display)
+    //    m_radar_display->setPos(m_location_history.back().pos);
+
+    m_vehicle_layer->invalidate();
 }
 
 void ROSLink::updatePosmvLocation(const QGeoCoordinate& location)
 {
-    prepareGeometryChange();
-    m_posmv_location_history.push_back(location);
-    m_local_posmv_location_history.push_back(geoToPixel(location,autonomousVehicleProject()));
-    while (m_local_posmv_location_history.size()>1500 || (!m_show_tail && m_local_posmv_location_history.size()>2))
-        m_local_posmv_location_history.pop_front();
-    m_posmv_location = location;
-    for(auto rd:m_radar_displays)
-    {
-        rd.second->setPos(m_local_posmv_location_history.back());
-    }
+    posmvLocationChanged(addPosmvLocation(TimedPosition{location, ros::Time::now().toSec()}));
+}
+
+bool ROSLink::addPosmvLocation(TimedPosition const &sample)
+{
+    bool grown = m_posmv_location_history.add(sample.location, geoToPixel(sample.location,autonomousVehicleProject()), sample.time);
+    archive(m_posmv_location_archive, sample.time, m_posmv_location_history.back());
+    m_posmv_location = sample.location.toQGeoCoordinate();
+    return grown;
+}
+
+void ROSLink::posmvLocationChanged(bool grown)
+{
+    if(grown)
+        m_posmv_location_tail.setPoints(m_posmv_location_history.positions());
+    else
+        m_posmv_location_tail.setLastPoint(m_posmv_location_history.back().pos);
+    if(m_radar_display)
+        m_radar_display->setPos(m_posmv_location_history.back().pos);
     if(m_follow_robot)
-        emit centerMap(location);
-    update();
+        emit centerMap(m_posmv_location);
+    m_posmv_layer->invalidate();
 }
 
 void ROSLink::followRobot(bool follow)
@@ -815,24 +1215,255 @@ void ROSLink::followRobot(bool follow)
 
 void ROSLink::updateBaseLocation(const QGeoCoordinate& location)
 {
-    prepareGeometryChange();
-    m_base_location.location = location;
-    m_base_location.pos = geoToPixel(location,autonomousVehicleProject());
-    m_base_location_history.push_back(m_base_location);
-    while (m_base_location_history.size()>100)
-        m_base_location_history.pop_front();
-    update();
+    baseLocationChanged(addBaseLocation(TimedPosition{location, ros::Time::now().toSec()}));
 }
 
-void ROSLink::updateOriginLocation(const QGeoCoordinate& location)
-{   
-    auto pixel_location = geoToPixel(location,autonomousVehicleProject());
-    if(!m_have_local_reference || pixel_location != m_local_reference_position)
-    {
-        prepareGeometryChange();
+bool ROSLink::addBaseLocation(TimedPosition const &sample)
+{
+    m_base_location.location = sample.location;
+    m_base_location.pos = geoToPixel(sample.location,autonomousVehicleProject());
+    bool grown = m_base_location_history.add(m_base_location.location, m_base_location.pos, sample.time);
+    archive(m_base_location_archive, sample.time, m_base_location);
+    return grown;
+}
+
+void ROSLink::baseLocationChanged(bool grown)
+{
+    if(grown)
+        m_base_location_tail.setPoints(m_base_location_history.positions());
+    else
+        m_base_location_tail.setLastPoint(m_base_location_history.back().pos);
+    m_base_layer->invalidate();
+}
+
+void ROSLink::drainTelemetry()
+{
+    // Every pending sample goes into the histories, but each layer is
+    // rebuilt at most once per tick.
+    bool vehicle_changed = false;
+    bool posmv_changed = false;
+    bool base_changed = false;
+
+    std::vector<TimedPosition> positions;
+    if(m_location_mailbox.take(positions))
+    {
+        bool grown = false;
+        for(auto const &p: positions)
+            grown = addLocation(p) || grown;
+        locationChanged(grown);
+        vehicle_changed = true;
+    }
+    positions.clear();
+    if(m_posmv_location_mailbox.take(positions))
+    {
+        bool grown = false;
+        for(auto const &p: positions)
+            grown = addPosmvLocation(p) || grown;
+        posmvLocationChanged(grown);
+        posmv_changed = true;
+    }
+    positions.clear();
+    if(m_base_location_mailbox.take(positions))
+    {
+        bool grown = false;
+        for(auto const &p: positions)
+            grown = addBaseLocation(p) || grown;
+        baseLocationChanged(grown);
+        base_changed = true;
+    }
+
+    // Symbols are drawn with the heading at the time of the newest
+    // position, positions and headings arriving separately. The newest
+    // heading is used until the two overlap.
+    double heading;
+    bool heading_changed = m_heading_mailbox.takeLatest(heading);
+    if((vehicle_changed && headingAtNewestPosition("vehicle", heading)) || heading_changed)
+    {
+        m_heading = heading;
+        if(!vehicle_changed)
+            m_vehicle_layer->invalidate();
+    }
+    heading_changed = m_posmv_heading_mailbox.takeLatest(heading);
+    if((posmv_changed && headingAtNewestPosition("posmv", heading)) || heading_changed)
+    {
+        m_posmv_heading = heading;
+        if(!posmv_changed)
+            m_posmv_layer->invalidate();
+    }
+    heading_changed = m_base_heading_mailbox.takeLatest(heading);
+    if((base_changed && headingAtNewestPosition("base", heading)) || heading_changed)
+    {
+        m_base_heading = heading;
+        if(!base_changed)
+            m_base_layer->invalidate();
+    }
+
+    std::vector<qreal> sogs;
+    if(m_sog_mailbox.take(sogs))
+    {
+        for(auto s: sogs)
+            addSog(s);
+        m_details->sogUpdate(m_sog,m_sog_avg);
+    }
+
+    // Messages are converted here, on the GUI thread, where projecting
+    // against the current background is safe.
+    bool contacts_changed = false;
+    marine_msgs::Contact::ConstPtr contact;
+    while(m_contact_queue.pop(contact))
+    {
+        storeAISContact(makeAISContact(contact));
+        contacts_changed = true;
+    }
+    if(contacts_changed)
+        m_ais_layer->invalidate();
+
+    bool display_changed = false;
+    geographic_visualization_msgs::GeoVizItem::ConstPtr display_item;
+    while(m_display_queue.pop(display_item))
+    {
+        storeDisplayItem(makeDisplayItem(display_item));
+        display_changed = true;
+    }
+    if(display_changed)
+    {
+        enforceDisplayBudget();
+        m_display_layer->invalidate();
+    }
+
+    std::vector<CoverageUpdate> coverage_updates;
+    if(m_coverage_mailbox.take(coverage_updates))
+    {
+        if(m_coverage_mailbox.dropped() != m_reported_coverage_drops)
+        {
+            // A full mailbox lost updates, possibly a reset, so the mask is
+            // rebuilt from the polygons as received.
+            rebuildCoverage();
+            m_coverage_layer->invalidate();
+        }
+        else
+            for(auto const &update: coverage_updates)
+                addCoverage(update);
+    }
+
+    updatePingTiles();
+}
+
+QPolygonF ROSLink::coveragePolygon(std::vector<GeoPoint> const &polygon) const
+{
+    QPolygonF ret;
+    auto avp = autonomousVehicleProject();
+    if(!avp || !avp->getBackgroundRaster())
+        return ret;
+    ret.resize(polygon.size());
+    avp->getBackgroundRaster()->geoToPixel(polygon.data(), ret.data(), polygon.size());
+    // local positions are relative to the parent item, as in geoToPixel
+    if(parentItem())
+        ret.translate(-parentItem()->scenePos());
+    return ret;
+}
+
+void ROSLink::addCoverage(CoverageUpdate const &update)
+{
+    if(update.reset)
+    {
+        m_coverage_mask.clear();
+        m_coverage_changed = true;
+        m_coverage_layer->invalidate();
+        return;
+    }
+
+    QRectF bounds = m_coverage_mask.bounds();
+    QRectF dirty = m_coverage_mask.add(coveragePolygon(update.polygon));
+    if(dirty.isNull())
+        return;
+    m_coverage_changed = true;
+    if(bounds.contains(dirty))
+        m_coverage_layer->update(dirty);
+    else
+        m_coverage_layer->invalidate();
+}
+
+void ROSLink::rebuildCoverage()
+{
+    // Pending updates are already part of the received polygons.
+    std::vector<std::vector<GeoPoint> > coverage;
+    {
+        QMutexLocker lock(&m_received_coverage_mutex);
+        std::vector<CoverageUpdate> pending;
+        m_coverage_mailbox.take(pending);
+        m_reported_coverage_drops = m_coverage_mailbox.dropped();
+        coverage = m_received_coverage;
+    }
+
+    m_coverage_mask.clear();
+    auto avp = autonomousVehicleProject();
+    BackgroundRaster *bg = avp ? avp->getBackgroundRaster() : nullptr;
+    if(bg && bg->pixelSize() > 0.0)
+        m_coverage_mask.setCellSize(m_coverage_cell_size/bg->pixelSize());
+    for(auto const &polygon: coverage)
+        m_coverage_mask.add(coveragePolygon(polygon));
+    m_summarized_area.clear();
+    m_coverage_changed = true;
+}
+
+CoverageMask::Summary ROSLink::coverageSummary(SurveyArea const *area) const
+{
+    if(!area)
+        return CoverageMask::Summary();
+    std::vector<GeoPoint> vertices;
+    for(auto wp: area->waypoints())
+        vertices.push_back(wp->location());
+    return m_coverage_mask.summarize(coveragePolygon(vertices));
+}
+
+void ROSLink::updateCoverageSummary()
+{
+    auto avp = autonomousVehicleProject();
+    SurveyArea *area = avp ? qobject_cast<SurveyArea*>(avp->currentSelected()) : nullptr;
+    QPolygonF polygon;
+    if(area)
+    {
+        std::vector<GeoPoint> vertices;
+        for(auto wp: area->waypoints())
+            vertices.push_back(wp->location());
+        polygon = coveragePolygon(vertices);
+    }
+    // Summaries are only redone when the coverage, the selected area or its
+    // outline change.
+    if(!m_coverage_changed && polygon == m_summarized_area)
+        return;
+    m_coverage_changed = false;
+    m_summarized_area = polygon;
+
+    if(polygon.size() < 3)
+    {
+        if(!m_coverage_gaps.isEmpty())
+        {
+            m_coverage_gaps = QPainterPath();
+            m_coverage_layer->invalidate();
+        }
+        return;
+    }
+    CoverageMask::Summary summary = m_coverage_mask.summarize(polygon);
+    m_coverage_gaps = summary.gaps;
+    m_coverage_layer->invalidate();
+    emit coverageSummaryUpdated(QString("%1: %2% covered").arg(area->objectName()).arg(summary.fraction()*100.0, 0, 'f', 1));
+}
+
+void ROSLink::updateOriginLocation(const QGeoCoordinate& location)
+{   
+    auto pixel_location = geoToPixel(location,autonomousVehicleProject());
+    if(!m_have_local_reference || pixel_location != m_local_reference_position)
+    {
         setPos(geoToPixel(location,autonomousVehicleProject()));
         m_local_reference_position = geoToPixel(location,autonomousVehicleProject());
         m_have_local_reference = true;
+        // Binned soundings are relative to the previous origin.
+        GeoPoint origin(location);
+        if(m_ping_origin.isValid() && (origin.latitude() != m_ping_origin.latitude() || origin.longitude() != m_ping_origin.longitude()))
+            m_ping_grid.clear();
+        m_ping_origin = origin;
         recalculatePositions();
         emit originUpdated();
     }
@@ -840,43 +1471,45 @@ void ROSLink::updateOriginLocation(const QGeoCoordinate& location)
 
 void ROSLink::updateHeading(double heading)
 {
-    prepareGeometryChange();
     m_heading = heading;
-    for(auto rd:m_radar_displays)
-    {
-        //rd.second->setRotation(heading);
-    }
-    update();
+    //if(m_radar_display)
+    //    m_radar_display->setRotation(heading);
+    m_vehicle_layer->invalidate();
 }
 
 void ROSLink::updatePosmvHeading(double heading)
 {
-    prepareGeometryChange();
     m_posmv_heading = heading;
-    for(auto rd:m_radar_displays)
-    {
-        //rd.second->setRotation(heading);
-    }
-    update();
+    //if(m_radar_display)
+    //    m_radar_display->setRotation(heading);
+    m_posmv_layer->invalidate();
 }
 
 void ROSLink::updateBaseHeading(double heading)
 {
-    prepareGeometryChange();
     m_base_heading = heading;
-    update();
+    m_base_layer->invalidate();
 }
 
 void ROSLink::addAISContact(ROSAISContact *c)
 {
-    prepareGeometryChange();
+    storeAISContact(c);
+    m_ais_layer->invalidate();
+}
+
+void ROSLink::storeAISContact(ROSAISContact *c)
+{
     c->location_local = geoToPixel(c->location,autonomousVehicleProject());
-    m_contacts[c->mmsi].push_back(c);
-    while(!m_contacts[c->mmsi].empty() && (ros::Time::now() - m_contacts[c->mmsi].front()->timestamp) > ros::Duration(600))
-        m_contacts[c->mmsi].pop_front();
-    while(m_contacts[c->mmsi].size()>100)
-        m_contacts[c->mmsi].pop_front();
-    update();
+    ContactList &contacts = m_contacts[c->mmsi];
+    contacts.push_back(c);
+    while(!contacts.empty() && ((ros::Time::now() - contacts.front()->timestamp) > ros::Duration(600) || contacts.size() > 100))
+    {
+        if(m_spare_contacts.size() < maximumSpareContacts)
+            m_spare_contacts.push_back(contacts.front());
+        else
+            delete contacts.front();
+        contacts.pop_front();
+    }
 }
 
 void ROSLink::updateBackground(BackgroundRaster *bgr)
@@ -887,52 +1520,24 @@ void ROSLink::updateBackground(BackgroundRaster *bgr)
 
 void ROSLink::recalculatePositions()
 {
-    prepareGeometryChange();
     setPos(0,0);
-    m_local_location_history.clear();
     
     AutonomousVehicleProject *avp = autonomousVehicleProject();
     
-    for(auto l: m_location_history)
-    {
-        m_local_location_history.push_back(geoToPixel(l,avp));            
-    }
-
-    m_local_posmv_location_history.clear();
-    for(auto l: m_posmv_location_history)
-    {
-        m_local_posmv_location_history.push_back(geoToPixel(l,avp));            
-    }
+    auto project = [&](GeoPoint const &p){return geoToPixel(p,avp);};
+    m_location_history.reproject(project);
+    m_posmv_location_history.reproject(project);
 
     
-    for(std::pair<std::string, std::shared_ptr<geoviz::Item> > display_item: m_display_items)
+    m_display_stats = geoviz::Stats();
+    m_display_stats.items = m_display_items.size();
+    for(auto const &display_item: m_display_items)
     {
-        display_item.second->label_position.pos = geoToPixel(display_item.second->label_position.location,avp);
-        for(auto pl: display_item.second->point_groups)
-        {
-            for(auto& p: pl.points)
-                p.pos = geoToPixel(p.location,avp);
-        }
-        for(auto& l: display_item.second->lines)
-        {
-            for(auto& p: l.points)
-            {
-                //std::cerr << "old pos: " << p.pos.x() << ", " << p.pos.y() << std::endl;
-                p.pos = geoToPixel(p.location,avp);
-                //std::cerr << "new pos: " << p.pos.x() << ", " << p.pos.y() << std::endl;
-            }
-        }
-        for(auto& poly: display_item.second->polygons)
-        {
-            for(auto& op: poly.outer)
-                op.pos = geoToPixel(op.location,avp);
-            for(auto& ir: poly.inner)
-                for(auto& ip: ir)
-                    ip.pos = geoToPixel(ip.location,avp);
-        }
+        buildRenderBatch(*display_item.second.item);
+        countDisplayItem(m_display_stats, *display_item.second.item, 1);
     }
 
-    for(auto contactList: m_contacts)
+    for(auto const &contactList: m_contacts)
     {
         for(auto contact: contactList.second)
             contact->location_local = geoToPixel(contact->location,avp);
@@ -944,21 +1549,33 @@ void ROSLink::recalculatePositions()
     }
     
     m_base_location.pos = geoToPixel(m_base_location.location,avp);
-    for(LocationPosition &l: m_base_location_history)
-    {
-        l.pos = geoToPixel(l.location,avp);            
-    }
+    m_base_location_history.reproject(project);
+    m_location_tail.setPoints(m_location_history.positions());
+    m_posmv_location_tail.setPoints(m_posmv_location_history.positions());
+    m_base_location_tail.setPoints(m_base_location_history.positions());
+
+    rebuildCoverage();
+    m_coverage_layer->invalidate();
+    for(auto &tile: m_ping_tiles)
+        placePingTile(tile.first, tile.second);
+    m_ping_layer->invalidate();
+    updateDepthOverlay();
+
+    m_location_archive_cache.clear();
+    m_posmv_location_archive_cache.clear();
+    m_base_location_archive_cache.clear();
+    updateArchiveBounds();
     
-    for(auto rd: m_radar_displays)
+    if(m_radar_display)
     {
-        rd.second->setPos(m_base_location.pos);
+        m_radar_display->setPos(m_base_location.pos);
         
         auto bgr = avp->getBackgroundRaster();
         if(bgr)
-            rd.second->setPixelSize(bgr->pixelSize());
+            m_radar_display->setPixelSize(bgr->pixelSize());
     }
     
-    update();
+    invalidateLayers();
 }
 
 void ROSLink::setHelmMode(const std::string& helmMode)
@@ -996,39 +1613,85 @@ AutonomousVehicleProject * ROSLink::autonomousVehicleProject() const
 
 void ROSLink::coverageCallback(const geographic_msgs::GeoPath::ConstPtr& message)
 {
-    QList<QList<QGeoCoordinate> > coverage;
-    QList<QPolygonF> local_coverage;
-    coverage.push_back(QList<QGeoCoordinate>());
-    local_coverage.push_back(QPolygonF());
-    for(auto gp: message->poses)
+    // Each message holds all the coverage so far, as polygons separated by
+    // invalid positions. A growing polygon keeps most of its vertices, so
+    // the vertices it shares with the previous message at its start and end
+    // are skipped and only the span between them is handed on, closed back
+    // through the span it replaced. That polygon encloses the area added.
+    std::vector<std::vector<GeoPoint> > coverage(1);
+    for(auto const &gp: message->poses)
     {
-        QGeoCoordinate gc;
-        gc.setLatitude(gp.pose.position.latitude);
-        gc.setLongitude(gp.pose.position.longitude);
-        if(gc.isValid())
-        {
-            coverage.back().append(gc);
-            local_coverage.back().append(geoToPixel(gc,autonomousVehicleProject()));
-        }
+        GeoPoint p(gp.pose.position.latitude, gp.pose.position.longitude);
+        if(p.isValid())
+            coverage.back().push_back(p);
+        else
+            coverage.push_back(std::vector<GeoPoint>());
+    }
+
+    auto same = [](GeoPoint const &a, GeoPoint const &b)
+    {
+        return a.latitude() == b.latitude() && a.longitude() == b.longitude();
+    };
+
+    QMutexLocker lock(&m_received_coverage_mutex);
+    if(coverage.size() < m_received_coverage.size())
+    {
+        CoverageUpdate reset;
+        reset.reset = true;
+        m_coverage_mailbox.post(reset);
+        m_received_coverage.clear();
+    }
+    for(std::size_t i = 0; i < coverage.size(); i++)
+    {
+        auto const &polygon = coverage[i];
+        std::size_t n = polygon.size();
+        if(n < 3)
+            continue;
+        CoverageUpdate update;
+        if(i >= m_received_coverage.size() || m_received_coverage[i].size() < 3)
+            update.polygon = polygon;
         else
         {
-            coverage.push_back(QList<QGeoCoordinate>());
-            local_coverage.push_back(QPolygonF());
+            auto const &previous = m_received_coverage[i];
+            std::size_t m = previous.size();
+            std::size_t head = 0;
+            while(head < n && head < m && same(polygon[head], previous[head]))
+                head++;
+            std::size_t tail = 0;
+            while(tail < n-head && tail < m-head && same(polygon[n-1-tail], previous[m-1-tail]))
+                tail++;
+            // nothing gained, any area lost was already marked
+            if(head+tail == n)
+                continue;
+            if(head == 0 && tail == 0)
+                update.polygon = polygon;
+            else
+            {
+                // the new span, from the shared vertex before it to the one after
+                std::size_t count = n-head-tail+2;
+                for(std::size_t k = 0; k < count; k++)
+                    update.polygon.push_back(polygon[(head+n-1+k)%n]);
+                for(std::size_t k = m-tail; k > head; k--)
+                    update.polygon.push_back(previous[k-1]);
+            }
         }
+        m_coverage_mailbox.post(update);
     }
-    QMetaObject::invokeMethod(this,"updateCoverage", Qt::QueuedConnection, Q_ARG(QList<QList<QGeoCoordinate> >, coverage), Q_ARG(QList<QPolygonF>, local_coverage));
+    m_received_coverage.swap(coverage);
 }
 
 void ROSLink::geoVizDisplayCallback(const geographic_visualization_msgs::GeoVizItem::ConstPtr& message)
 {
-    AutonomousVehicleProject *avp = autonomousVehicleProject();
+    m_display_queue.push(message);
+}
+
+geoviz::Item *ROSLink::makeDisplayItem(const geographic_visualization_msgs::GeoVizItem::ConstPtr& message)
+{
     geoviz::Item *item = new geoviz::Item();
     item->id = message->id;
     item->label = message->label;
-    item->label_position.location.setLatitude(message->label_position.latitude);
-    item->label_position.location.setLongitude(message->label_position.longitude);
-    item->label_position.pos = geoToPixel(item->label_position.location,avp);
-    for(auto pg: message->point_groups)
+    item->label_position.location = GeoPoint(message->label_position.latitude, message->label_position.longitude);
+    for(auto const &pg: message->point_groups)
     {
         geoviz::PointList pl;
         pl.color.setRedF(pg.color.r);
@@ -1037,17 +1700,15 @@ void ROSLink::geoVizDisplayCallback(const geographic_visualization_msgs::GeoVizI
         pl.color.setAlphaF(pg.color.a);
         pl.size = pg.size;
         
-        for(auto p: pg.points)
+        for(auto const &p: pg.points)
         {
             LocationPosition lp;
-            lp.location.setLatitude(p.latitude);
-            lp.location.setLongitude(p.longitude);
-            lp.pos = geoToPixel(lp.location,avp);
+            lp.location = GeoPoint(p.latitude, p.longitude);
             pl.points.push_back(lp);
         }
         item->point_groups.push_back(pl);
     }
-    for(auto l: message->lines)
+    for(auto const &l: message->lines)
     {
         geoviz::PointList pl;
         pl.color.setRedF(l.color.r);
@@ -1056,47 +1717,33 @@ void ROSLink::geoVizDisplayCallback(const geographic_visualization_msgs::GeoVizI
         pl.color.setAlphaF(l.color.a);
         pl.size = l.size;
         
-        for(auto p: l.points)
+        for(auto const &p: l.points)
         {
             LocationPosition lp;
-            lp.location.setLatitude(p.latitude);
-            lp.location.setLongitude(p.longitude);
-            lp.pos = geoToPixel(lp.location,avp);
+            lp.location = GeoPoint(p.latitude, p.longitude);
             pl.points.push_back(lp);
         }
         item->lines.push_back(pl);
     }
-    for(auto p: message->polygons)
+    for(auto const &p: message->polygons)
     {
         geoviz::Polygon polygon;
-        QPolygonF qPoly;
-        for(auto op: p.outer.points) // outer points
+        for(auto const &op: p.outer.points) // outer points
         {
             LocationPosition lp;
-            lp.location.setLatitude(op.latitude);
-            lp.location.setLongitude(op.longitude);
-            lp.pos = geoToPixel(lp.location,avp);
-            qPoly << lp.pos;
+            lp.location = GeoPoint(op.latitude, op.longitude);
             polygon.outer.push_back(lp);
         }
-        polygon.path.addPolygon(qPoly);
-        QPainterPath innerPath;
-        for(auto ir: p.inner) //inner rings
+        for(auto const &ir: p.inner) //inner rings
         {
             polygon.inner.push_back(std::vector<LocationPosition>());
-            QPolygonF innerPoly;
-            for(auto ip: ir.points) // inner ring points
+            for(auto const &ip: ir.points) // inner ring points
             {
                 LocationPosition lp;
-                lp.location.setLatitude(ip.latitude);
-                lp.location.setLongitude(ip.longitude);
-                lp.pos = geoToPixel(lp.location,avp);
-                innerPoly << lp.pos;
+                lp.location = GeoPoint(ip.latitude, ip.longitude);
                 polygon.inner.back().push_back(lp);
             }
-            innerPath.addPolygon(innerPoly);
         }
-        polygon.path = polygon.path.subtracted(innerPath);
         polygon.fill_color.setRedF(p.fill_color.r);
         polygon.fill_color.setGreenF(p.fill_color.g);
         polygon.fill_color.setBlueF(p.fill_color.b);
@@ -1108,90 +1755,470 @@ void ROSLink::geoVizDisplayCallback(const geographic_visualization_msgs::GeoVizI
         polygon.edge_size = p.edge_size;
         item->polygons.push_back(polygon);
     }
-    
-    QMetaObject::invokeMethod(this,"updateDisplayItem", Qt::QueuedConnection, Q_ARG(geoviz::Item*, item));
+
+    buildRenderBatch(*item);
+    return item;
+}
+
+void ROSLink::buildRenderBatch(geoviz::Item &item) const
+{
+    AutonomousVehicleProject *avp = autonomousVehicleProject();
+    auto batch = std::make_shared<geoviz::RenderBatch>();
+
+    item.label_position.pos = geoToPixel(item.label_position.location,avp);
+
+    for(auto &pl: item.point_groups)
+    {
+        geoviz::RenderBatch::Points points;
+        points.color = pl.color;
+        points.size = pl.size;
+        for(auto &p: pl.points)
+        {
+            p.pos = geoToPixel(p.location,avp);
+            points.points << p.pos;
+            batch->shape.addEllipse(p.pos,pl.size,pl.size);
+        }
+        points.bounds = points.points.boundingRect();
+        batch->bounds |= points.bounds;
+        batch->max_size = std::max(batch->max_size, pl.size);
+        batch->point_groups.push_back(points);
+    }
+
+    for(auto &l: item.lines)
+    {
+        geoviz::RenderBatch::Line line;
+        line.color = l.color;
+        line.size = l.size;
+        QPolygonF polyline;
+        for(auto &p: l.points)
+        {
+            p.pos = geoToPixel(p.location,avp);
+            polyline << p.pos;
+        }
+        if(polyline.size() > 1)
+            line.path.addPolygon(polyline);
+        line.bounds = line.path.boundingRect();
+        batch->shape.addPath(line.path);
+        batch->bounds |= line.bounds;
+        batch->max_size = std::max(batch->max_size, l.size);
+        batch->lines.push_back(line);
+    }
+
+    for(auto &poly: item.polygons)
+    {
+        geoviz::RenderBatch::Area area;
+        QPolygonF outer;
+        for(auto &op: poly.outer)
+        {
+            op.pos = geoToPixel(op.location,avp);
+            outer << op.pos;
+        }
+        area.path.addPolygon(outer);
+        QPainterPath innerPath;
+        for(auto &ir: poly.inner)
+        {
+            QPolygonF inner;
+            for(auto &ip: ir)
+            {
+                ip.pos = geoToPixel(ip.location,avp);
+                inner << ip.pos;
+            }
+            innerPath.addPolygon(inner);
+        }
+        if(!innerPath.isEmpty())
+            area.path = area.path.subtracted(innerPath);
+        area.fill_color = poly.fill_color;
+        area.edge_color = poly.edge_color;
+        area.edge_size = poly.edge_size;
+        area.bounds = area.path.boundingRect();
+        batch->shape.addPath(area.path);
+        batch->bounds |= area.bounds;
+        batch->max_size = std::max(batch->max_size, poly.edge_size);
+        batch->polygons.push_back(area);
+    }
+
+    // Rough footprint: source positions, packed points, and path elements.
+    std::size_t vertices = 0;
+    for(auto const &points: batch->point_groups)
+        vertices += points.points.size();
+    for(auto const &line: batch->lines)
+        vertices += line.path.elementCount();
+    for(auto const &area: batch->polygons)
+        vertices += area.path.elementCount();
+    batch->vertices = vertices;
+    batch->bytes = sizeof(geoviz::Item)+sizeof(geoviz::RenderBatch)+vertices*(sizeof(LocationPosition)+sizeof(QPointF))+batch->shape.elementCount()*sizeof(QPainterPath::Element);
+
+    item.batch = batch;
 }
 
 void ROSLink::updateDisplayItem(geoviz::Item *item)
 {
-    prepareGeometryChange();
-    m_display_items[item->id] = std::shared_ptr<geoviz::Item>(item);
-    update();   
+    storeDisplayItem(item);
+    enforceDisplayBudget();
+    m_display_layer->invalidate();
 }
 
-void ROSLink::showRadar(bool show)
+void ROSLink::storeDisplayItem(geoviz::Item *item)
 {
-    m_show_radar = show;
-    for(auto rd:m_radar_displays)
+    auto existing = m_display_items.find(item->id);
+    // An item with nothing to draw deletes any previous item with its id.
+    if(item->point_groups.empty() && item->lines.empty() && item->polygons.empty())
     {
-        rd.second->showRadar(show);
+        if(existing != m_display_items.end())
+            eraseDisplayItem(existing);
+        delete item;
+        return;
     }
-    update();
+    item->last_update = ros::Time::now().toSec();
+    if(existing == m_display_items.end())
+    {
+        existing = m_display_items.insert(std::make_pair(item->id, DisplayEntry())).first;
+        existing->second.order = m_display_order.insert(m_display_order.end(), item->id);
+        m_display_stats.items++;
+    }
+    else
+    {
+        countDisplayItem(m_display_stats, *existing->second.item, -1);
+        m_display_order.splice(m_display_order.end(), m_display_order, existing->second.order);
+    }
+    existing->second.item = std::shared_ptr<geoviz::Item>(item);
+    countDisplayItem(m_display_stats, *item, 1);
 }
 
-void ROSLink::selectRadarColor()
+ROSLink::DisplayItemMap::iterator ROSLink::eraseDisplayItem(DisplayItemMap::iterator item)
 {
-    for(auto rd:m_radar_displays)
+    countDisplayItem(m_display_stats, *item->second.item, -1);
+    m_display_stats.items--;
+    m_display_order.erase(item->second.order);
+    return m_display_items.erase(item);
+}
+
+bool ROSLink::expireDisplayItems()
+{
+    if(m_display_item_ttl <= 0.0)
+        return false;
+    double now = ros::Time::now().toSec();
+    bool expired = false;
+    // Items are in update order, so the expired ones are at the front.
+    while(!m_display_order.empty())
     {
-        rd.second->setColor(QColorDialog::getColor(rd.second->getColor() , nullptr, "Select Color", QColorDialog::DontUseNativeDialog));
+        auto oldest = m_display_items.find(m_display_order.front());
+        if(now - oldest->second.item->last_update <= m_display_item_ttl)
+            break;
+        eraseDisplayItem(oldest);
+        expired = true;
     }
+    return expired;
+}
+
+bool ROSLink::enforceDisplayBudget()
+{
+    bool evicted = false;
+    // The newest item is always kept, however large.
+    while(m_display_stats.bytes > m_display_memory_budget && m_display_items.size() > 1)
+    {
+        eraseDisplayItem(m_display_items.find(m_display_order.front()));
+        evicted = true;
+    }
+    return evicted;
+}
+
+geoviz::Stats ROSLink::displayStats() const
+{
+    return m_display_stats;
+}
+
+void ROSLink::showRadar(bool show)
+{
+    m_show_radar = show;
+    if(m_radar_display)
+        m_radar_display->showRadar(show);
+    m_radar_target_layer->setVisible(show);
+    update();
+}
+
+void ROSLink::selectRadarColor()
+{
+    if(m_radar_display)
+        m_radar_display->setColor(QColorDialog::getColor(m_radar_display->getColor() , nullptr, "Select Color", QColorDialog::DontUseNativeDialog));
     update();   
 }
 
+void ROSLink::updateViewport(QPointF ll, QPointF ur)
+{
+    m_viewport = QRectF(ll, ur).normalized();
+    if(m_radar_display)
+        m_radar_display->setViewport(m_viewport);
+}
+
+void ROSLink::discoverRadars()
+{
+    if(!m_node)
+        return;
+    ros::master::V_TopicInfo topics;
+    if(!ros::master::getTopics(topics))
+        return;
+    CallbackGroup &group = m_callback_groups[RadarTraffic];
+    for(auto const &topic: topics)
+        if(topic.datatype == ros::message_traits::datatype<marine_msgs::RadarSectorStamped>() && !m_radar_subscribers.count(topic.name))
+        {
+            ros::SubscribeOptions ops = ros::SubscribeOptions::create<marine_msgs::RadarSectorStamped>(topic.name, group.queue_depth, boost::bind(&ROSLink::radarCallback, this, _1, topic.name), ros::VoidPtr(), &group.queue);
+            m_radar_subscribers[topic.name] = m_node->subscribe(ops);
+        }
+}
+
 void ROSLink::showTail(bool show)
 {
     m_show_tail = show;
-    update();
+    invalidateLayers();
 }
 
 
-// void ROSLink::radarCallback(const marine_msgs::RadarSectorStamped::ConstPtr &message, const std::string &topic)
-// {
-//     if (m_show_radar && !message->sector.scanlines.empty())
-//     {
-//         double angle1 = message->sector.scanlines[0].angle;
-//         double angle2 = message->sector.scanlines.back().angle;
-//         double range = message->sector.scanlines[0].range;
-//         int w = message->sector.scanlines[0].intensities.size();
-//         int h = message->sector.scanlines.size();
-//         QImage * sector = new QImage(w,h,QImage::Format_Grayscale8);
-//         sector->fill(Qt::darkGray);
-//         for(int i = 0; i < h; i++)
-//             for(int j = 0; j < w; j++)
-//                 sector->bits()[i*w+j] = message->sector.scanlines[i].intensities[j]*16; // *16 to convert from 4 to 8 bits
-//         //QMetaObject::invokeMethod(m_radar_displays[topic],"addSector", Qt::QueuedConnection, Q_ARG(double, angle1), Q_ARG(double, angle2), Q_ARG(double, range), Q_ARG(QImage *, sector), Q_ARG(ros::Time, message->header.stamp), Q_ARG(QString, message->header.frame_id.c_str()));
-//         m_radar_displays[topic]->addSector(angle1, angle2, range, sector, message->header.stamp, message->header.frame_id.c_str());
-//     }
-// }
+void ROSLink::radarCallback(const marine_msgs::RadarSectorStamped::ConstPtr &message, const std::string &topic)
+{
+    // Only queued here, sectors are stored and drawn on the overlay's workers.
+    if(m_radar_display)
+        m_radar_display->addSector(topic, message);
+}
 
-void ROSLink::pingCallback(const sensor_msgs::PointCloud::ConstPtr& message)
+void ROSLink::tfCallback(const tf2_msgs::TFMessage::ConstPtr& message)
 {
-    QList<QGeoCoordinate> ping;
-    QList<QPointF> local_ping;
-//     for(auto gp: message->poses)
-//     {
-//         QGeoCoordinate gc;
-//         gc.setLatitude(gp.pose.position.latitude);
-//         gc.setLongitude(gp.pose.position.longitude);
-//         ping.append(gc);
-//         local_ping.append(geoToPixel(gc,autonomousVehicleProject())-m_local_reference_position);
-//     }
-//     QMetaObject::invokeMethod(this,"addPing", Qt::QueuedConnection, Q_ARG(QList<QGeoCoordinate>, ping), Q_ARG(QList<QPointF>, local_ping));
+    updateTransforms(*message, false);
 }
 
+void ROSLink::tfStaticCallback(const tf2_msgs::TFMessage::ConstPtr& message)
+{
+    updateTransforms(*message, true);
+}
 
-void ROSLink::updateCoverage(QList<QList<QGeoCoordinate> > coverage, QList<QPolygonF> local_coverage)
+void ROSLink::updateTransforms(tf2_msgs::TFMessage const &message, bool is_static)
 {
-    prepareGeometryChange();
-    m_coverage = coverage;
-    m_local_coverage = local_coverage;
-    update();
+    // Poses of the frames the radar overlay asked for are sampled as TF
+    // updates, so sectors can be placed without TF lookups of their own.
+    // A frame is only looked up when the message moves its chain to the
+    // map frame, static chains and unrelated frames cost nothing.
+    std::set<std::string> moved;
+    QMutexLocker lock(&m_tf_chains_mutex);
+    for(auto const &t: message.transforms)
+    {
+        m_tf_buffer.setTransform(t, "ROSLink", is_static);
+        moved.insert(t.child_frame_id);
+        std::string &parent = m_tf_parents[t.child_frame_id];
+        if(parent != t.header.frame_id)
+        {
+            // reparented, chains through this frame have to be found again
+            parent = t.header.frame_id;
+            for(auto chain = m_tf_chains.begin(); chain != m_tf_chains.end();)
+                if(chain->second.count(t.child_frame_id))
+                    chain = m_tf_chains.erase(chain);
+                else
+                    ++chain;
+        }
+    }
+    for(auto const &frame: m_pose_cache.tracked())
+    {
+        auto chain = m_tf_chains.find(frame);
+        if(chain != m_tf_chains.end())
+        {
+            bool affected = false;
+            for(auto const &f: chain->second)
+                if(moved.count(f))
+                {
+                    affected = true;
+                    break;
+                }
+            if(!affected)
+                continue;
+        }
+        try
+        {
+            geometry_msgs::TransformStamped t = m_tf_buffer.lookupTransform(m_mapFrame, frame, ros::Time(0));
+            if(chain == m_tf_chains.end())
+            {
+                std::set<std::string> links;
+                if(tfChain(frame, links))
+                    m_tf_chains[frame].swap(links);
+            }
+            double heading = 90.0-180.0*tf2::getYaw(t.transform.rotation)/M_PI;
+            QPointF position(t.transform.translation.x, t.transform.translation.y);
+            // only static transforms between the frames
+            if(t.header.stamp.isZero())
+                m_pose_cache.setFixedPose(frame, heading, position);
+            else
+            {
+                m_pose_cache.addHeading(frame, t.header.stamp.toSec(), heading);
+                m_pose_cache.addMapPosition(frame, t.header.stamp.toSec(), position);
+            }
+        }
+        catch(tf2::TransformException &e)
+        {
+        }
+    }
 }
 
-void ROSLink::addPing(QList<QGeoCoordinate> ping, QList<QPointF> local_ping)
+bool ROSLink::tfChain(std::string const &frame, std::set<std::string> &links) const
 {
-    prepareGeometryChange();
-    m_pings.append(ping);
-    m_local_pings.append(local_ping);
-    update();
+    // Walks both frames up to the root, the links below their common
+    // ancestor are the ones that move one relative to the other.
+    auto toRoot = [this](std::string f)
+    {
+        std::vector<std::string> ret;
+        while(ret.size() <= m_tf_parents.size())
+        {
+            ret.push_back(f);
+            auto parent = m_tf_parents.find(f);
+            if(parent == m_tf_parents.end())
+                break;
+            f = parent->second;
+        }
+        return ret;
+    };
+    std::vector<std::string> up = toRoot(frame);
+    std::vector<std::string> down = toRoot(m_mapFrame);
+    if(up.back() != down.back())
+        return false;
+    while(up.size() > 1 && down.size() > 1 && up[up.size()-2] == down[down.size()-2])
+    {
+        up.pop_back();
+        down.pop_back();
+    }
+    // the common ancestor's own parent link moves neither
+    links.insert(up.begin(), up.end()-1);
+    links.insert(down.begin(), down.end()-1);
+    return true;
+}
+
+bool ROSLink::headingAtNewestPosition(std::string const &key, double &heading) const
+{
+    double time;
+    GeoPoint position;
+    return m_pose_cache.newestPosition(key, time, position) && m_pose_cache.heading(key, time, heading);
+}
+
+void ROSLink::pingCallback(const sensor_msgs::PointCloud::ConstPtr& message)
+{
+    // Soundings are binned here, on the callback thread, in map frame
+    // meters. The display tick only picks up the tiles recoloured as a result.
+    // The message filter only passes pings TF can already place.
+    if(message->points.empty())
+        return;
+    geometry_msgs::TransformStamped transform;
+    try
+    {
+        transform = m_tf_buffer.lookupTransform(m_mapFrame, message->header.frame_id, message->header.stamp);
+    }
+    catch(tf2::TransformException &e)
+    {
+        m_ping_drops++;
+        return;
+    }
+    tf2::Transform to_map;
+    tf2::fromMsg(transform.transform, to_map);
+
+    std::vector<double> east, north;
+    std::vector<float> depth;
+    east.reserve(message->points.size());
+    north.reserve(message->points.size());
+    depth.reserve(message->points.size());
+    for(auto const &p: message->points)
+    {
+        tf2::Vector3 v = to_map*tf2::Vector3(p.x, p.y, p.z);
+        east.push_back(v.x());
+        north.push_back(v.y());
+        depth.push_back(-v.z());
+    }
+    m_ping_grid.add(east.data(), north.data(), depth.data(), east.size());
+    m_depth_model.addSoundings(std::move(east), std::move(north), std::move(depth));
+}
+
+void ROSLink::updatePingTiles()
+{
+    std::vector<PingGrid::TileImage> tiles;
+    if(m_ping_grid.takeUpdated(tiles))
+    {
+        m_ping_tiles.clear();
+        m_ping_layer->invalidate();
+    }
+    if(tiles.empty())
+        return;
+    QRectF bounds = pingBounds();
+    QRectF dirty;
+    for(auto const &tile: tiles)
+    {
+        PingTileView &view = m_ping_tiles[tile.key];
+        if(view.image.isNull())
+            placePingTile(tile.key, view);
+        view.image = tile.image;
+        dirty |= view.bounds;
+    }
+    if(bounds.contains(dirty))
+        m_ping_layer->update(dirty);
+    else
+        m_ping_layer->invalidate();
+}
+
+void ROSLink::placePingTile(PingGrid::TileKey const &key, PingTileView &view) const
+{
+    // Tiles are squares in the map frame, a local tangent plane at the
+    // origin. Each is drawn through the quad its corners project to.
+    view.transform = QTransform();
+    view.bounds = QRectF();
+    auto avp = autonomousVehicleProject();
+    if(!m_ping_origin.isValid() || !avp || !avp->getBackgroundRaster())
+        return;
+    QRectF extent = m_ping_grid.tileExtent(key);
+    double east[4] = {extent.left(), extent.right(), extent.right(), extent.left()};
+    double north[4] = {extent.bottom(), extent.bottom(), extent.top(), extent.top()};
+    double latitudes[4], longitudes[4];
+    gz4d::LocalTangent(m_ping_origin.latitude(), m_ping_origin.longitude()).toGeodetic(east, north, latitudes, longitudes, 4);
+    std::vector<GeoPoint> corners;
+    for(int i = 0; i < 4; i++)
+        corners.push_back(GeoPoint(latitudes[i], longitudes[i]));
+    QPolygonF quad = coveragePolygon(corners);
+    QPolygonF image_corners;
+    image_corners << QPointF(0, 0) << QPointF(PingGrid::TileSize, 0) << QPointF(PingGrid::TileSize, PingGrid::TileSize) << QPointF(0, PingGrid::TileSize);
+    if(QTransform::quadToQuad(image_corners, quad, view.transform))
+        view.bounds = quad.boundingRect();
+}
+
+void ROSLink::updateDepthOverlay()
+{
+    auto avp = autonomousVehicleProject();
+    BackgroundRaster *raster = avp ? avp->getDepthRaster() : nullptr;
+    if(m_depth_overlay_raster && m_depth_overlay_raster != raster)
+    {
+        m_depth_overlay_raster->setDepthOverlay(nullptr);
+        m_depth_overlay_raster->setCostOverlay(nullptr);
+    }
+    m_depth_overlay_raster = raster;
+    if(!raster || !m_ping_origin.isValid())
+    {
+        m_depth_model.clearMapToPixel();
+        m_radar_occupancy.clearMapToPixel();
+        return;
+    }
+
+    // The map frame is tied to raster pixels by an affine fit at the
+    // origin, so the worker needs no projection library calls. Over the
+    // few kilometers of a survey, the error is well below a cell.
+    double east[3] = {0.0, 100.0, 0.0};
+    double north[3] = {0.0, 0.0, 100.0};
+    double latitudes[3], longitudes[3];
+    gz4d::LocalTangent(m_ping_origin.latitude(), m_ping_origin.longitude()).toGeodetic(east, north, latitudes, longitudes, 3);
+    QPointF p0 = raster->geoToPixel(GeoPoint(latitudes[0], longitudes[0]));
+    QPointF p1 = raster->geoToPixel(GeoPoint(latitudes[1], longitudes[1]));
+    QPointF p2 = raster->geoToPixel(GeoPoint(latitudes[2], longitudes[2]));
+    QTransform map_to_pixel((p1.x()-p0.x())/100.0, (p1.y()-p0.y())/100.0, (p2.x()-p0.x())/100.0, (p2.y()-p0.y())/100.0, p0.x(), p0.y());
+    m_depth_model.setMapToPixel(map_to_pixel, QSize(raster->width(), raster->height()));
+    raster->setDepthOverlay(&m_depth_model);
+    m_radar_occupancy.setMapToPixel(map_to_pixel, QSize(raster->width(), raster->height()));
+    raster->setCostOverlay(&m_radar_occupancy);
+}
+
+QRectF ROSLink::pingBounds() const
+{
+    QRectF ret;
+    for(auto const &tile: m_ping_tiles)
+        ret |= tile.second.bounds;
+    return ret;
 }
@@ -8,8 +8,9 @@
 #include "sensor_msgs/Imu.h"
 #include "marine_msgs/NavEulerStamped.h"
 #include "marine_msgs/Heartbeat.h"
-//#include "marine_msgs/RadarSectorStamped.h"
+#include "marine_msgs/RadarSectorStamped.h"
 #include "ros/ros.h"
+#include <ros/callback_queue.h>
 #include "marine_msgs/Contact.h"
 #include "std_msgs/String.h"
 #include "std_msgs/Float32.h"
@@ -17,14 +18,35 @@
 #include "geometry_msgs/Quaternion.h"
 #include "geographic_msgs/GeoPath.h"
 #include "sensor_msgs/PointCloud.h"
+#include "tf2_msgs/TFMessage.h"
 #include "locationposition.h"
+#include "track_history.h"
+#include "track_archive.h"
+#include "polyline_simplify.h"
+#include "telemetry_mailbox.h"
+#include "spsc_queue.h"
+#include "coverage_mask.h"
+#include "ping_grid.h"
+#include "depth_model.h"
+#include "radar_occupancy.h"
+#include "pose_cache.h"
 #include "geographic_visualization_msgs/GeoVizItem.h"
-#include <tf2_ros/transform_listener.h>
+#include <tf2_ros/buffer.h>
+#include <tf2_ros/message_filter.h>
+#include <message_filters/subscriber.h>
+#include <QElapsedTimer>
+#include <QTransform>
+#include <QPointer>
+#include <atomic>
+#include <deque>
+#include <list>
 
 //Q_DECLARE_METATYPE(ros::Time);
 
 class ROSDetails;
 class RadarDisplay;
+class PathLayer;
+class SurveyArea;
 
 struct ROSAISContact: public QObject
 {
@@ -34,7 +56,7 @@ public:
     ros::Time timestamp;
     uint32_t mmsi;
     std::string name;
-    QGeoCoordinate location;
+    GeoPoint location;
     QPointF location_local;
     double heading;
     float dimension_to_stbd; 
@@ -45,6 +67,21 @@ public:
     float sog;
 };
 
+// Position sample with the time it was received, in seconds.
+struct TimedPosition
+{
+    GeoPoint location;
+    double time;
+};
+
+// Area added to the coverage, as a small polygon enclosing the vertices a
+// coverage polygon gained. A reset update drops all coverage received so far.
+struct CoverageUpdate
+{
+    bool reset = false;
+    std::vector<GeoPoint> polygon;
+};
+
 namespace geoviz
 {
 
@@ -59,12 +96,60 @@ namespace geoviz
     {
         std::vector<LocationPosition> outer;
         std::vector<std::vector<LocationPosition> > inner;
-        QPainterPath path;
         QColor fill_color;
         QColor edge_color;
         float edge_size;
     };
 
+    // Drawable form of an Item, in item coordinates. It is built when the
+    // item arrives or is reprojected and not modified afterwards, so paint
+    // only reads it.
+    struct RenderBatch
+    {
+        struct Points
+        {
+            QPolygonF points;
+            QColor color;
+            float size;
+            QRectF bounds;
+        };
+
+        struct Line
+        {
+            QPainterPath path;
+            QColor color;
+            float size;
+            QRectF bounds;
+        };
+
+        struct Area
+        {
+            QPainterPath path;
+            QColor fill_color;
+            QColor edge_color;
+            float edge_size;
+            QRectF bounds;
+        };
+
+        std::vector<Points> point_groups;
+        std::vector<Line> lines;
+        std::vector<Area> polygons;
+        QPainterPath shape;
+        QRectF bounds;
+        // largest pen width, in pixels
+        float max_size = 0.0;
+        std::size_t vertices = 0;
+        // estimated memory used by the item and its batch
+        std::size_t bytes = 0;
+    };
+
+    struct Stats
+    {
+        std::size_t items = 0;
+        std::size_t vertices = 0;
+        std::size_t bytes = 0;
+    };
+
     struct Item: public QObject
     {
         Q_OBJECT
@@ -75,6 +160,9 @@ namespace geoviz
         std::vector<PointList> point_groups;
         std::vector<PointList> lines;
         std::vector<Polygon> polygons;
+        std::shared_ptr<RenderBatch const> batch;
+        // ros time of the last update, in seconds
+        double last_update = 0.0;
     };
 }
 
@@ -94,8 +182,15 @@ public:
     QPainterPath vehicleShapePosmv() const;
     QPainterPath baseShape() const;
     QPainterPath aisShape() const;
+    QPainterPath radarTargetShape() const;
     QPainterPath coverageShape() const;
-    QPainterPath pingsShape() const;
+    QPainterPath displayShape() const;
+
+    // Live geoviz display items and their estimated footprint.
+    geoviz::Stats displayStats() const;
+
+    // Share of a survey area covered so far, and its gaps.
+    CoverageMask::Summary coverageSummary(SurveyArea const *area) const;
 
     void write(QJsonObject &json) const;
     void read(const QJsonObject &json);
@@ -107,6 +202,9 @@ public:
     
     void setROSDetails(ROSDetails *details);
 
+    // Last reported vehicle location, invalid if none received yet.
+    QGeoCoordinate const &location() const;
+
     
 signals:
 
@@ -114,6 +212,8 @@ signals:
     void originUpdated();
     void robotNamespaceUpdated(QString robot_namespace);
     void centerMap(QGeoCoordinate location);
+    void coverageSummaryUpdated(QString const &summary);
+    void warning(QString const &message);
     
 public slots:
     void updateLocation(QGeoCoordinate const &location);
@@ -124,8 +224,6 @@ public slots:
     void updatePosmvHeading(double heading);
     void updateBaseHeading(double heading);
     void updateBackground(BackgroundRaster *bgr);
-    void updateCoverage(QList<QList<QGeoCoordinate> > coverage, QList<QPolygonF> local_coverage);
-    void addPing(QList<QGeoCoordinate> ping, QList<QPointF> local_ping);
     void updateDisplayItem(geoviz::Item *item);
 
     void recalculatePositions();
@@ -151,8 +249,13 @@ public slots:
     void updateSog(qreal sog);
     void showRadar(bool show);
     void selectRadarColor();
+    void updateViewport(QPointF ll, QPointF ur);
+    // Subscribes to radar topics that have appeared since last checked.
+    void discoverRadars();
     void showTail(bool show);
     void followRobot(bool follow);
+    void updateMapScale();
+    void drainTelemetry();
     
 private:
     void gpsPositionCallback(const sensor_msgs::NavSatFix::ConstPtr& message);
@@ -170,10 +273,91 @@ private:
     void coverageCallback(const geographic_msgs::GeoPath::ConstPtr& message);
     void pingCallback(const sensor_msgs::PointCloud::ConstPtr& message);
     void geoVizDisplayCallback(const geographic_visualization_msgs::GeoVizItem::ConstPtr& message);
-    //void radarCallback(const marine_msgs::RadarSectorStamped::ConstPtr &message, const std::string &topic);
+    void radarCallback(const marine_msgs::RadarSectorStamped::ConstPtr &message, const std::string &topic);
+    void tfCallback(const tf2_msgs::TFMessage::ConstPtr& message);
+    void tfStaticCallback(const tf2_msgs::TFMessage::ConstPtr& message);
+    // Adds a /tf or /tf_static message to the buffer, then samples the poses
+    // of tracked frames it moved.
+    void updateTransforms(tf2_msgs::TFMessage const &message, bool is_static);
+    // Frames whose transforms to their parents link frame to the map frame,
+    // false if the parents seen so far don't connect them.
+    bool tfChain(std::string const &frame, std::set<std::string> &links) const;
     
-    void drawTriangle(QPainterPath &path, QGeoCoordinate const &location, double heading_degrees, double scale=1.0) const;
-    void drawShipOutline(QPainterPath &path, QGeoCoordinate const &location, double heading_degrees, float dimension_to_bow, float dimension_to_port, float dimension_to_stbd, float dimension_to_stern) const;
+    // Return true if the history kept the sample as a new point.
+    bool addLocation(TimedPosition const &sample);
+    bool addPosmvLocation(TimedPosition const &sample);
+    bool addBaseLocation(TimedPosition const &sample);
+    // grown is set if a history gained a point since the last call,
+    // otherwise only the end of its tail moved.
+    void locationChanged(bool grown);
+    void posmvLocationChanged(bool grown);
+    void baseLocationChanged(bool grown);
+    void addSog(qreal sog);
+    void addCoverage(CoverageUpdate const &update);
+    QPolygonF coveragePolygon(std::vector<GeoPoint> const &polygon) const;
+    void rebuildCoverage();
+    void updateCoverageSummary();
+    void updatePingTiles();
+    void placePingTile(PingGrid::TileKey const &key, PingTileView &view) const;
+    QRectF pingBounds() const;
+    void updateDepthOverlay();
+    ROSAISContact *makeAISContact(const marine_msgs::Contact::ConstPtr& message);
+    void storeAISContact(ROSAISContact *c);
+    geoviz::Item *makeDisplayItem(const geographic_visualization_msgs::GeoVizItem::ConstPtr& message);
+
+    // Subscriptions are grouped by traffic class. Each class has its own
+    // callback queue and spinner, so a burst of display messages can't
+    // hold up navigation callbacks.
+    enum TrafficClass
+    {
+        NavigationTraffic,
+        ContactTraffic,
+        DisplayTraffic,
+        CommandTraffic,
+        RadarTraffic,
+        TrafficClassCount
+    };
+
+    struct CallbackGroup
+    {
+        ros::CallbackQueue queue;
+        std::shared_ptr<ros::AsyncSpinner> spinner;
+        int threads = 1;
+        int queue_depth = 10;
+    };
+
+    void configureCallbackGroups();
+    template<typename M> ros::Subscriber subscribe(TrafficClass traffic, std::string const &topic, void (ROSLink::*callback)(const boost::shared_ptr<M const>&));
+    void startSpinners();
+    void stopSpinners();
+
+    void createLayers();
+    void invalidateLayers();
+    void paintDisplayItems(QPainter *painter, QRectF const &exposed) const;
+    void buildRenderBatch(geoviz::Item &item) const;
+    void storeDisplayItem(geoviz::Item *item);
+    struct DisplayEntry
+    {
+        std::shared_ptr<geoviz::Item> item;
+        // position in m_display_order
+        std::list<std::string>::iterator order;
+    };
+    typedef std::map<std::string,DisplayEntry> DisplayItemMap;
+    DisplayItemMap::iterator eraseDisplayItem(DisplayItemMap::iterator item);
+    bool expireDisplayItems();
+    bool enforceDisplayBudget();
+
+    typedef std::map<std::pair<std::size_t, int>, QPolygonF> ArchiveCache;
+    QPainterPath archiveShape(TrackArchive const &archive, ArchiveCache &cache, QRectF const &rect);
+    void openArchives(std::string const &robotNamespace);
+    void archive(TrackArchive &archive, double time, LocationPosition const &location);
+    void updateArchiveBounds();
+
+    // Heading of a pose cache key at the time of its newest position.
+    bool headingAtNewestPosition(std::string const &key, double &heading) const;
+
+    void drawTriangle(QPainterPath &path, GeoPoint const &location, double heading_degrees, double scale=1.0) const;
+    void drawShipOutline(QPainterPath &path, GeoPoint const &location, double heading_degrees, float dimension_to_bow, float dimension_to_port, float dimension_to_stbd, float dimension_to_stern) const;
     
     QGeoCoordinate rosMapToGeo(QPointF const &location) const;
     
@@ -193,25 +377,59 @@ private:
     ros::Subscriber m_bearing_subscriber;
     ros::Subscriber m_sog_subscriber;
     ros::Subscriber m_coverage_subscriber;
-    ros::Subscriber m_ping_subscriber;
+    // Pings wait in the filter, on the display queue, until TF reaches
+    // their stamps.
+    std::shared_ptr<message_filters::Subscriber<sensor_msgs::PointCloud> > m_ping_subscriber;
+    std::shared_ptr<tf2_ros::MessageFilter<sensor_msgs::PointCloud> > m_ping_filter;
     ros::Subscriber m_display_subscriber;
     std::map<std::string, ros::Subscriber> m_radar_subscribers;
     ros::Subscriber m_clock_subscriber;
+    ros::Subscriber m_tf_subscriber;
+    ros::Subscriber m_tf_static_subscriber;
     
     ros::Publisher m_send_command_publisher;
     ros::Publisher m_look_at_publisher;
     ros::Publisher m_look_at_mode_publisher;
     
     ros::AsyncSpinner *m_spinner;
+    CallbackGroup m_callback_groups[TrafficClassCount];
     QGeoCoordinate m_location;
     QGeoCoordinate m_posmv_location;
     LocationPosition m_base_location; // location of the base operator station (ship, shore station, etc)
     QGeoCoordinate m_origin;
-    std::vector<QGeoCoordinate> m_location_history;
-    std::list<QPointF> m_local_location_history;
-    std::vector<QGeoCoordinate> m_posmv_location_history;
-    std::list<QPointF> m_local_posmv_location_history;
-    std::list<LocationPosition> m_base_location_history;
+    // Bounded, decimated tracks so memory and reprojection cost stay constant on long missions.
+    TrackHistory m_location_history{2000, 2.0, 10.0};
+    TrackHistory m_posmv_location_history{2000, 2.0, 10.0};
+    TrackHistory m_base_location_history{100};
+    // Tails simplified per zoom band, refreshed when a history changes.
+    SimplifiedPolyline m_location_tail;
+    SimplifiedPolyline m_posmv_location_tail;
+    SimplifiedPolyline m_base_location_tail;
+    // Complete tracks on disk, drawn chunk by chunk at the zoom's level of detail.
+    TrackArchive m_location_archive;
+    TrackArchive m_posmv_location_archive;
+    TrackArchive m_base_location_archive;
+    // Projected sealed chunks, keyed by chunk and level.
+    ArchiveCache m_location_archive_cache;
+    ArchiveCache m_posmv_location_archive_cache;
+    ArchiveCache m_base_location_archive_cache;
+    // A track along a meridian or a lone point has null bounds, so
+    // whether any were set is kept apart.
+    QRectF m_archive_bounds;
+    bool m_have_archive_bounds = false;
+    QElapsedTimer m_archive_refresh;
+
+    // Each kind of data is drawn by its own child item, so an update only
+    // rebuilds and repaints the layer whose data changed.
+    PathLayer *m_coverage_layer;
+    PathLayer *m_ping_layer;
+    PathLayer *m_ais_layer;
+    PathLayer *m_display_layer;
+    PathLayer *m_base_layer;
+    PathLayer *m_archive_layer;
+    PathLayer *m_vehicle_layer;
+    PathLayer *m_posmv_layer;
+    PathLayer *m_radar_target_layer;
     QPointF m_local_reference_position;
     bool m_have_local_reference;
     double m_heading;
@@ -223,10 +441,13 @@ private:
     float m_base_dimension_to_bow;
     float m_base_dimension_to_stern; 
     
-    typedef std::list<ROSAISContact*> ContactList;
+    typedef std::deque<ROSAISContact*> ContactList;
     typedef std::map<uint32_t,ContactList> ContactMap;
     
     ContactMap m_contacts;
+    // Contacts trimmed from the histories, reused for new reports so a
+    // steady AIS feed doesn't allocate a QObject per message.
+    std::vector<ROSAISContact*> m_spare_contacts;
     ROSDetails *m_details;
     
     QGeoCoordinate m_view_point;
@@ -241,23 +462,82 @@ private:
     QList<QPointF> m_local_view_polygon;
     bool m_view_polygon_active;
 
-    QList<QList<QGeoCoordinate> > m_coverage;
-    QList<QPolygonF> m_local_coverage;
+    // Polygons as last received by the coverage callback, guarded by
+    // m_received_coverage_mutex. The mask is rebuilt from them.
+    std::vector<std::vector<GeoPoint> > m_received_coverage;
+    QMutex m_received_coverage_mutex;
+    TelemetryMailbox<CoverageUpdate> m_coverage_mailbox{TelemetryMailbox<CoverageUpdate>::KeepAll};
+    // updates the mailbox had dropped at the last rebuild
+    std::size_t m_reported_coverage_drops = 0;
 
-    QList<QList<QGeoCoordinate> > m_pings;
-    QList<QList<QPointF> > m_local_pings;
+    CoverageMask m_coverage_mask;
+    // mask cell size, in meters
+    double m_coverage_cell_size = 1.0;
+    bool m_coverage_changed = false;
+    // gaps in the selected survey area
+    QPolygonF m_summarized_area;
+    QPainterPath m_coverage_gaps;
+
+    // Soundings are binned by the ping callback in map frame meters. The
+    // display keeps each tile's latest image and where it lands on the map.
+    PingGrid m_ping_grid;
+    // pings that never got a transform to the map frame
+    std::atomic<std::size_t> m_ping_drops{0};
+    std::size_t m_reported_ping_drops = 0;
+    struct PingTileView
+    {
+        QImage image;
+        QTransform transform;
+        QRectF bounds;
+    };
+    std::map<PingGrid::TileKey, PingTileView> m_ping_tiles;
+    GeoPoint m_ping_origin;
+
+    // The same soundings, gridded on the depth raster's cells for planning.
+    DepthModel m_depth_model;
+    QPointer<BackgroundRaster> m_depth_overlay_raster;
+    // Radar returns accumulated on the same cells, as obstacle costs.
+    RadarOccupancy m_radar_occupancy;
 
     QList<QGeoCoordinate> m_current_path;
     QList<QPointF> m_local_current_path;
     
-    std::map<std::string,std::shared_ptr<geoviz::Item> > m_display_items;
+    DisplayItemMap m_display_items;
+    // ids from the least to the most recently updated
+    std::list<std::string> m_display_order;
+    // totals over m_display_items, kept as they change
+    geoviz::Stats m_display_stats;
+    double m_display_item_ttl = 0.0;
+    std::size_t m_display_memory_budget = 64*1024*1024;
 
-    std::map<std::string,RadarDisplay*> m_radar_displays;
+    RadarDisplay *m_radar_display = nullptr;
+    bool m_log_radar_timings = false;
+    QElapsedTimer m_radar_timings_logged;
+    // scene area shown by the view
+    QRectF m_viewport;
     
-    bool m_show_radar;
+    bool m_show_radar = true;
     bool m_show_tail;
 
     QTimer * m_watchdog_timer;
+    QTimer * m_radar_discovery_timer;
+
+    // Filled by the ROS callbacks, emptied on each display tick.
+    QTimer * m_display_timer;
+    TelemetryMailbox<TimedPosition> m_location_mailbox{TelemetryMailbox<TimedPosition>::KeepAll};
+    TelemetryMailbox<TimedPosition> m_posmv_location_mailbox{TelemetryMailbox<TimedPosition>::KeepAll};
+    TelemetryMailbox<TimedPosition> m_base_location_mailbox{TelemetryMailbox<TimedPosition>::KeepAll};
+    TelemetryMailbox<double> m_heading_mailbox;
+    TelemetryMailbox<double> m_posmv_heading_mailbox;
+    TelemetryMailbox<double> m_base_heading_mailbox;
+    TelemetryMailbox<qreal> m_sog_mailbox{TelemetryMailbox<qreal>::KeepAll};
+
+    // Incoming messages are handed over as shared pointers, so a burst
+    // costs no allocation between the callback and the display tick.
+    SpscQueue<marine_msgs::Contact::ConstPtr> m_contact_queue{512};
+    SpscQueue<geographic_visualization_msgs::GeoVizItem::ConstPtr> m_display_queue{64};
+    std::size_t m_reported_contact_drops = 0;
+    std::size_t m_reported_display_drops = 0;
     
     double m_range;
     ros::Time m_range_timestamp;
@@ -268,9 +548,21 @@ private:
     qreal m_sog;
     qreal m_sog_avg;
 
+    // Filled by tfCallback and tfStaticCallback, rather than by a listener
+    // with its own subscription, so poses sampled from it are never a
+    // message behind.
     tf2_ros::Buffer m_tf_buffer;
-    tf2_ros::TransformListener m_tf_listener;
+    // Recent poses of the vehicle, base and posmv, by message time, and the
+    // headings of frames sampled from TF.
+    PoseCache m_pose_cache;
     std::string m_mapFrame;
+    // Frames between each tracked frame and the map frame, found on its
+    // first lookup, so only /tf messages moving one of them trigger
+    // another.
+    std::map<std::string, std::set<std::string> > m_tf_chains;
+    // parent of each frame, from the child/parent pairs seen on /tf and /tf_static
+    std::map<std::string, std::string> m_tf_parents;
+    QMutex m_tf_chains_mutex;
 
     bool m_follow_robot = false;
 };
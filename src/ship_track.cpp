@@ -1,19 +1,21 @@
 #include "ship_track.h"
+#include "gz4d_geo.h"
 
 ShipTrack::ShipTrack(QGraphicsItem *parentItem):GeoGraphicsItem(parentItem)
 {
 
 }
 
-void ShipTrack::drawTriangle(QPainterPath& path, BackgroundRaster* bg, const QGeoCoordinate& location, double heading_degrees, double scale) const
+void ShipTrack::drawTriangle(QPainterPath& path, BackgroundRaster* bg, const GeoPoint& location, double heading_degrees, double scale) const
 {
-  QGeoCoordinate tip = location.atDistanceAndAzimuth(15*scale,heading_degrees);
-  QGeoCoordinate llcorner = location.atDistanceAndAzimuth(15*scale,heading_degrees-150);
-  QGeoCoordinate lrcorner = location.atDistanceAndAzimuth(15*scale,heading_degrees+150);
+  double azimuths[3] = {heading_degrees, heading_degrees-150, heading_degrees+150};
+  double distances[3] = {15*scale, 15*scale, 15*scale};
+  double latitudes[3], longitudes[3];
+  gz4d::LocalTangent(location.latitude(), location.longitude()).direct(azimuths, distances, latitudes, longitudes, 3);
 
-  QPointF ltip = geoToPixel(tip, bg);
-  QPointF lllocal = geoToPixel(llcorner, bg);
-  QPointF lrlocal = geoToPixel(lrcorner, bg);
+  QPointF ltip = geoToPixel(GeoPoint(latitudes[0], longitudes[0]), bg);
+  QPointF lllocal = geoToPixel(GeoPoint(latitudes[1], longitudes[1]), bg);
+  QPointF lrlocal = geoToPixel(GeoPoint(latitudes[2], longitudes[2]), bg);
 
   path.moveTo(ltip);
   path.lineTo(lllocal);
@@ -21,22 +23,26 @@ void ShipTrack::drawTriangle(QPainterPath& path, BackgroundRaster* bg, const QGe
   path.lineTo(ltip);
 }
 
-void ShipTrack::drawShipOutline(QPainterPath& path, BackgroundRaster* bg, const QGeoCoordinate& location, double heading_degrees, float dimension_to_bow, float dimension_to_port, float dimension_to_stbd, float dimension_to_stern) const
+void ShipTrack::drawShipOutline(QPainterPath& path, BackgroundRaster* bg, const GeoPoint& location, double heading_degrees, float dimension_to_bow, float dimension_to_port, float dimension_to_stbd, float dimension_to_stern) const
 {
   float length = dimension_to_bow+dimension_to_stern;
   float width = dimension_to_port+dimension_to_stbd;
-  QGeoCoordinate llcorner = location.atDistanceAndAzimuth(dimension_to_port,270+heading_degrees).atDistanceAndAzimuth(dimension_to_stern,180+heading_degrees);
-  QGeoCoordinate lrcorner = llcorner.atDistanceAndAzimuth(width,90+heading_degrees);
-  QGeoCoordinate urcorner = lrcorner.atDistanceAndAzimuth(length,heading_degrees);
-  QGeoCoordinate ulcorner = urcorner.atDistanceAndAzimuth(width,270+heading_degrees);
-  QGeoCoordinate rkink = lrcorner.atDistanceAndAzimuth(length*.8,heading_degrees);
-  QGeoCoordinate lkink = llcorner.atDistanceAndAzimuth(length*.8,heading_degrees);
-  QGeoCoordinate bow = ulcorner.atDistanceAndAzimuth(width/2.0,90+heading_degrees);
-  QPointF lllocal = geoToPixel(llcorner, bg);
-  QPointF lrlocal = geoToPixel(lrcorner, bg);
-  QPointF lkinkl = geoToPixel(lkink, bg);
-  QPointF rkinkl = geoToPixel(rkink, bg);
-  QPointF bowl = geoToPixel(bow, bg);
+  // outline corners in ship frame: lower left, lower right, right kink, bow, left kink
+  double forward[5] = {-dimension_to_stern, -dimension_to_stern, length*.8-dimension_to_stern, dimension_to_bow, length*.8-dimension_to_stern};
+  double starboard[5] = {-dimension_to_port, dimension_to_stbd, dimension_to_stbd, width/2.0-dimension_to_port, -dimension_to_port};
+  double heading = gz4d::Radians(heading_degrees);
+  double east[5], north[5], latitudes[5], longitudes[5];
+  for(int i = 0; i < 5; i++)
+  {
+    east[i] = forward[i]*sin(heading)+starboard[i]*cos(heading);
+    north[i] = forward[i]*cos(heading)-starboard[i]*sin(heading);
+  }
+  gz4d::LocalTangent(location.latitude(), location.longitude()).toGeodetic(east, north, latitudes, longitudes, 5);
+  QPointF lllocal = geoToPixel(GeoPoint(latitudes[0], longitudes[0]), bg);
+  QPointF lrlocal = geoToPixel(GeoPoint(latitudes[1], longitudes[1]), bg);
+  QPointF rkinkl = geoToPixel(GeoPoint(latitudes[2], longitudes[2]), bg);
+  QPointF bowl = geoToPixel(GeoPoint(latitudes[3], longitudes[3]), bg);
+  QPointF lkinkl = geoToPixel(GeoPoint(latitudes[4], longitudes[4]), bg);
   
   path.moveTo(lllocal);
   path.lineTo(lrlocal);
@@ -0,0 +1,82 @@
+#ifndef CAMP_SPSC_QUEUE_H
+#define CAMP_SPSC_QUEUE_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+// Bounded lock free queue for one producer thread and one consumer thread.
+// Slots are allocated up front, so pushing and popping never allocate. When
+// the queue is full, the new value is dropped and counted; the producer
+// can't touch the oldest value, which belongs to the consumer.
+template<typename T> class SpscQueue
+{
+public:
+  // capacity is rounded up to a power of two.
+  explicit SpscQueue(std::size_t capacity)
+  {
+    std::size_t size = 1;
+    while(size < capacity)
+      size *= 2;
+    m_slots.resize(size);
+    m_mask = size-1;
+  }
+
+  std::size_t capacity() const {return m_slots.size();}
+
+  // Producer side. Returns false if the queue was full.
+  bool push(T const &value)
+  {
+    std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    if(tail - m_head.load(std::memory_order_acquire) >= m_slots.size())
+    {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    m_slots[tail & m_mask] = value;
+    m_tail.store(tail+1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. The slot is left empty so it doesn't keep the value
+  // alive, which matters for shared pointers.
+  bool pop(T &value)
+  {
+    std::size_t head = m_head.load(std::memory_order_relaxed);
+    if(head == m_tail.load(std::memory_order_acquire))
+      return false;
+    value = std::move(m_slots[head & m_mask]);
+    m_slots[head & m_mask] = T();
+    m_head.store(head+1, std::memory_order_release);
+    return true;
+  }
+
+  std::size_t size() const
+  {
+    return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+  }
+
+  // Values dropped because the queue was full.
+  std::size_t dropped() const
+  {
+    return m_dropped.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::vector<T> m_slots;
+  std::size_t m_mask;
+
+  // Kept on separate cache lines so the two threads don't share one.
+  // Padded rather than aligned, an over aligned queue would make its
+  // owners over aligned, which plain new doesn't support before C++17.
+  static const std::size_t cacheLine = 64;
+  char m_padding0[cacheLine];
+  std::atomic<std::size_t> m_head{0};
+  char m_padding1[cacheLine-sizeof(std::atomic<std::size_t>)];
+  std::atomic<std::size_t> m_tail{0};
+  char m_padding2[cacheLine-sizeof(std::atomic<std::size_t>)];
+  std::atomic<std::size_t> m_dropped{0};
+};
+
+#endif
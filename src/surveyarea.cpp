@@ -5,6 +5,7 @@
 #include <QJsonArray>
 #include "backgroundraster.h"
 #include "trackline.h"
+#include "gz4d_geo.h"
 #include <QDebug>
 
 
@@ -244,9 +245,19 @@ std::vector<QGeoCoordinate> SurveyArea::generateNextLine(std::vector<QGeoCoordin
         double swath_half_width = depth*tanHalfSwath;
         
         // Find the  heading between previous point and next point. Use current point if at either end.
-        double heading = guidePath[std::max<int>(0,i-1)].azimuthTo(guidePath[std::min<int>(guidePath.size()-1,i+1)]);
+        // Neighbours and the swath offset are short, so a tangent plane at the current point is enough.
+        QGeoCoordinate const &prev = guidePath[std::max<int>(0,i-1)];
+        QGeoCoordinate const &next = guidePath[std::min<int>(guidePath.size()-1,i+1)];
+        gz4d::LocalTangent tangent(guidePath[i].latitude(), guidePath[i].longitude());
+        double neighbour_lat[2] = {prev.latitude(), next.latitude()};
+        double neighbour_lon[2] = {prev.longitude(), next.longitude()};
+        double east[2], north[2];
+        tangent.toLocal(neighbour_lat, neighbour_lon, east, north, 2);
+        double heading = gz4d::Degrees(atan2(east[1]-east[0], north[1]-north[0]))+(90*side);
         
-        QGeoCoordinate candidate_point = guidePath[i].atDistanceAndAzimuth(swath_half_width,heading+(90*side));
+        double candidate_lat, candidate_lon;
+        tangent.direct(&heading, &swath_half_width, &candidate_lat, &candidate_lon, 1);
+        QGeoCoordinate candidate_point(candidate_lat, candidate_lon);
         
         // check if turning too abruptly
         if(ret.size()>=2)
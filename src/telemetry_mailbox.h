@@ -0,0 +1,87 @@
+#ifndef CAMP_TELEMETRY_MAILBOX_H
+#define CAMP_TELEMETRY_MAILBOX_H
+
+#include <deque>
+#include <vector>
+#include <cstddef>
+#include <QMutex>
+
+// Hands values from a ROS callback thread to the GUI thread, which collects
+// them on its display tick instead of receiving a queued call per message.
+// LatestOnly keeps only the newest value, for streams where older values
+// are of no use once a newer one arrives. KeepAll keeps every value, up to
+// capacity, for streams feeding histories.
+template<typename T> class TelemetryMailbox
+{
+public:
+  enum Policy
+  {
+    LatestOnly,
+    KeepAll
+  };
+
+  explicit TelemetryMailbox(Policy policy = LatestOnly, std::size_t capacity = 4096):m_policy(policy),m_capacity(capacity)
+  {
+  }
+
+  void setPolicy(Policy policy)
+  {
+    QMutexLocker lock(&m_mutex);
+    m_policy = policy;
+    while(m_policy == LatestOnly && m_pending.size() > 1)
+      m_pending.pop_front();
+  }
+
+  // Called from the producing thread.
+  void post(T const &value)
+  {
+    QMutexLocker lock(&m_mutex);
+    if(m_policy == LatestOnly)
+      m_pending.clear();
+    else if(m_pending.size() >= m_capacity)
+    {
+      m_pending.pop_front();
+      m_dropped++;
+    }
+    m_pending.push_back(value);
+  }
+
+  // Appends the pending values to out, oldest first, and empties the mailbox.
+  // Returns false if nothing was pending.
+  bool take(std::vector<T> &out)
+  {
+    QMutexLocker lock(&m_mutex);
+    if(m_pending.empty())
+      return false;
+    out.insert(out.end(), m_pending.begin(), m_pending.end());
+    m_pending.clear();
+    return true;
+  }
+
+  // Takes only the newest pending value.
+  bool takeLatest(T &out)
+  {
+    QMutexLocker lock(&m_mutex);
+    if(m_pending.empty())
+      return false;
+    out = m_pending.back();
+    m_pending.clear();
+    return true;
+  }
+
+  // Values discarded from a full KeepAll mailbox.
+  std::size_t dropped() const
+  {
+    QMutexLocker lock(&m_mutex);
+    return m_dropped;
+  }
+
+private:
+  mutable QMutex m_mutex;
+  std::deque<T> m_pending;
+  Policy m_policy;
+  std::size_t m_capacity;
+  std::size_t m_dropped = 0;
+};
+
+#endif
@@ -0,0 +1,438 @@
+#include "track_archive.h"
+#include "polyline_simplify.h"
+#include "gz4d_geo.h"
+#include <algorithm>
+
+namespace
+{
+  // Identifies <base>.idx files, the version changes with the layout of
+  // the header, chunks or records.
+  const char indexMagic[4] = {'C', 'T', 'R', 'K'};
+  const uint32_t indexVersion = 2;
+}
+
+double TrackArchive::levelTolerance(int level)
+{
+  static const double tolerances[LevelCount] = {0.0, 1.0, 4.0, 16.0, 64.0, 256.0};
+  return tolerances[std::max(0, std::min(LevelCount-1, level))];
+}
+
+int TrackArchive::levelFor(double resolution)
+{
+  int level = 0;
+  while(level+1 < LevelCount && levelTolerance(level+1) <= resolution)
+    level++;
+  return level;
+}
+
+TrackArchive::TrackArchive(double chunkDuration):m_chunkDuration(chunkDuration)
+{
+}
+
+TrackArchive::~TrackArchive()
+{
+  close();
+}
+
+bool TrackArchive::open(QString const &basePath, double oldestTime)
+{
+  close();
+
+  m_pointsFile.setFileName(basePath+".pts");
+  m_indexFile.setFileName(basePath+".idx");
+  m_lodFile.setFileName(basePath+".lod");
+  if(!m_pointsFile.open(QFile::ReadWrite) || !m_indexFile.open(QFile::ReadWrite) || !m_lodFile.open(QFile::ReadWrite))
+  {
+    close();
+    return false;
+  }
+
+  // A partial record at the end of a file means the last write was cut
+  // short, drop it.
+  m_recordCount = m_pointsFile.size()/sizeof(Record);
+  m_lodIndexCount = m_lodFile.size()/sizeof(uint32_t);
+
+  IndexHeader header;
+  m_indexFile.seek(0);
+  bool readable = m_indexFile.read(reinterpret_cast<char*>(&header), sizeof(IndexHeader)) == qint64(sizeof(IndexHeader)) && std::equal(indexMagic, indexMagic+4, header.magic) && header.version == indexVersion;
+  if(!readable)
+  {
+    // Without a header the index is from an older version, or was never
+    // written, and neither it nor the data it describes can be trusted.
+    header.sessions = 0;
+    m_indexFile.resize(0);
+    m_recordCount = 0;
+    m_lodIndexCount = 0;
+  }
+  m_session = header.sessions;
+
+  m_chunks.resize(std::max<qint64>(0, m_indexFile.size()-qint64(sizeof(IndexHeader)))/sizeof(Chunk));
+  if(!m_chunks.empty())
+  {
+    m_indexFile.seek(sizeof(IndexHeader));
+    m_indexFile.read(reinterpret_cast<char*>(m_chunks.data()), m_chunks.size()*sizeof(Chunk));
+  }
+  // Discard chunks referring to data that never made it to disk.
+  while(!m_chunks.empty())
+  {
+    Chunk const &last = m_chunks.back();
+    if(last.firstRecord+last.recordCount <= m_recordCount && last.lodOffset[LevelCount-1]+last.lodCount[LevelCount-1] <= m_lodIndexCount)
+      break;
+    m_chunks.pop_back();
+  }
+  m_indexFile.resize(sizeof(IndexHeader)+m_chunks.size()*sizeof(Chunk));
+  m_pointsFile.resize(m_recordCount*sizeof(Record));
+  m_lodFile.resize(m_lodIndexCount*sizeof(uint32_t));
+  dropOldChunks(oldestTime);
+  if(!isOpen())
+    return false;
+  m_indexFile.seek(m_indexFile.size());
+
+  uint64_t sealedRecords = 0;
+  if(!m_chunks.empty())
+    sealedRecords = m_chunks.back().firstRecord+m_chunks.back().recordCount;
+  if(m_recordCount > sealedRecords)
+  {
+    m_open.resize(m_recordCount-sealedRecords);
+    m_pointsFile.seek(sealedRecords*sizeof(Record));
+    m_pointsFile.read(reinterpret_cast<char*>(m_open.data()), m_open.size()*sizeof(Record));
+  }
+  m_pointsFile.resize(m_recordCount*sizeof(Record));
+  m_pointsFile.seek(m_pointsFile.size());
+  m_lodFile.seek(m_lodFile.size());
+
+  // The previous session's samples are kept apart from this one's, which
+  // may start somewhere else.
+  if(!m_open.empty())
+    seal();
+  m_session++;
+  if(!writeHeader())
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool TrackArchive::writeHeader()
+{
+  IndexHeader header;
+  std::copy(indexMagic, indexMagic+4, header.magic);
+  header.version = indexVersion;
+  header.sessions = m_session;
+  bool ret = m_indexFile.seek(0) && m_indexFile.write(reinterpret_cast<char const*>(&header), sizeof(IndexHeader)) == qint64(sizeof(IndexHeader)) && m_indexFile.flush();
+  m_indexFile.seek(m_indexFile.size());
+  return ret;
+}
+
+void TrackArchive::close()
+{
+  if(isOpen())
+    flush();
+  if(m_pointsMap)
+    m_pointsFile.unmap(m_pointsMap);
+  m_pointsMap = nullptr;
+  m_pointsMapSize = 0;
+  if(m_lodMap)
+    m_lodFile.unmap(m_lodMap);
+  m_lodMap = nullptr;
+  m_lodMapSize = 0;
+
+  m_pointsFile.close();
+  m_indexFile.close();
+  m_lodFile.close();
+
+  m_chunks.clear();
+  m_open.clear();
+  m_unwritten = 0;
+  m_recordCount = 0;
+  m_lodIndexCount = 0;
+  m_session = 0;
+}
+
+bool TrackArchive::isOpen() const
+{
+  return m_pointsFile.isOpen();
+}
+
+bool TrackArchive::append(double time, GeoPoint const &location)
+{
+  if(!isOpen() || !location.isValid())
+    return false;
+
+  bool sealed = false;
+  if(!m_open.empty() && time-m_open.front().time >= m_chunkDuration)
+  {
+    seal();
+    sealed = true;
+  }
+
+  Record record;
+  record.time = time;
+  record.latitude = location.latitude();
+  record.longitude = location.longitude();
+  m_open.push_back(record);
+  m_unwritten++;
+  m_recordCount++;
+  return sealed;
+}
+
+void TrackArchive::flush()
+{
+  if(m_unwritten == 0)
+    return;
+  m_pointsFile.write(reinterpret_cast<char const*>(&m_open[m_open.size()-m_unwritten]), m_unwritten*sizeof(Record));
+  m_pointsFile.flush();
+  m_unwritten = 0;
+}
+
+bool TrackArchive::dropFront(QFile &file, qint64 bytes)
+{
+  // Copied forward in place, the destination never overtakes the source.
+  std::vector<char> buffer(1 << 20);
+  qint64 size = file.size();
+  for(qint64 offset = bytes; offset < size; offset += buffer.size())
+  {
+    qint64 count = std::min<qint64>(buffer.size(), size-offset);
+    if(!file.seek(offset) || file.read(buffer.data(), count) != count)
+      return false;
+    if(!file.seek(offset-bytes) || file.write(buffer.data(), count) != count)
+      return false;
+  }
+  return file.resize(std::max<qint64>(0, size-bytes)) && file.flush();
+}
+
+void TrackArchive::dropOldChunks(double oldestTime)
+{
+  std::size_t dropped = 0;
+  while(dropped < m_chunks.size() && m_chunks[dropped].endTime < oldestTime)
+    dropped++;
+  if(dropped == 0)
+    return;
+
+  // What remains starts at the first kept chunk, or the unsealed samples.
+  uint64_t firstRecord = dropped < m_chunks.size() ? m_chunks[dropped].firstRecord : m_chunks.back().firstRecord+m_chunks.back().recordCount;
+  uint64_t firstIndex = dropped < m_chunks.size() ? m_chunks[dropped].lodOffset[1] : m_lodIndexCount;
+  m_chunks.erase(m_chunks.begin(), m_chunks.begin()+dropped);
+  for(auto &c: m_chunks)
+  {
+    c.firstRecord -= firstRecord;
+    for(int level = 1; level < LevelCount; level++)
+      c.lodOffset[level] -= firstIndex;
+  }
+
+  // The index is emptied first, so if this is cut short the kept samples
+  // come back as an unsealed chunk rather than as chunks pointing at moved
+  // data.
+  m_indexFile.resize(sizeof(IndexHeader));
+  m_indexFile.flush();
+  if(!dropFront(m_pointsFile, firstRecord*sizeof(Record)) || !dropFront(m_lodFile, firstIndex*sizeof(uint32_t)))
+  {
+    close();
+    return;
+  }
+  m_recordCount -= firstRecord;
+  m_lodIndexCount -= firstIndex;
+  m_indexFile.seek(sizeof(IndexHeader));
+  if(!m_chunks.empty())
+    m_indexFile.write(reinterpret_cast<char const*>(m_chunks.data()), m_chunks.size()*sizeof(Chunk));
+  m_indexFile.flush();
+}
+
+void TrackArchive::extend(Chunk &chunk, Record const &record)
+{
+  chunk.minLatitude = std::min(chunk.minLatitude, record.latitude);
+  chunk.maxLatitude = std::max(chunk.maxLatitude, record.latitude);
+  chunk.minLongitude = std::min(chunk.minLongitude, record.longitude);
+  chunk.maxLongitude = std::max(chunk.maxLongitude, record.longitude);
+}
+
+void TrackArchive::seal()
+{
+  // Records go to disk before the chunk referring to them.
+  flush();
+  Chunk chunk;
+  chunk.session = m_session;
+  chunk.startTime = m_open.front().time;
+  chunk.endTime = m_open.back().time;
+  chunk.minLatitude = chunk.maxLatitude = m_open.front().latitude;
+  chunk.minLongitude = chunk.maxLongitude = m_open.front().longitude;
+  for(auto const &r: m_open)
+    extend(chunk, r);
+  chunk.firstRecord = m_recordCount-m_open.size();
+  chunk.recordCount = m_open.size();
+
+  // Levels are simplified in meters, in a plane tangent at the chunk's center.
+  std::vector<double> latitudes(m_open.size()), longitudes(m_open.size());
+  for(std::size_t i = 0; i < m_open.size(); i++)
+  {
+    latitudes[i] = m_open[i].latitude;
+    longitudes[i] = m_open[i].longitude;
+  }
+  std::vector<double> east(m_open.size()), north(m_open.size());
+  gz4d::LocalTangent((chunk.minLatitude+chunk.maxLatitude)/2.0, (chunk.minLongitude+chunk.maxLongitude)/2.0).toLocal(latitudes.data(), longitudes.data(), east.data(), north.data(), m_open.size());
+
+  chunk.lodOffset[0] = 0;
+  chunk.lodCount[0] = 0;
+  for(int level = 1; level < LevelCount; level++)
+  {
+    std::vector<std::size_t> keep = simplifyPolyline(east.data(), north.data(), m_open.size(), levelTolerance(level));
+    std::vector<uint32_t> indices(keep.begin(), keep.end());
+    chunk.lodOffset[level] = m_lodIndexCount;
+    chunk.lodCount[level] = indices.size();
+    m_lodFile.write(reinterpret_cast<char const*>(indices.data()), indices.size()*sizeof(uint32_t));
+    m_lodIndexCount += indices.size();
+  }
+  m_lodFile.flush();
+
+  // The index entry goes last, so a chunk is only seen once its data is on disk.
+  m_indexFile.write(reinterpret_cast<char const*>(&chunk), sizeof(Chunk));
+  m_indexFile.flush();
+
+  m_chunks.push_back(chunk);
+  m_open.clear();
+}
+
+bool TrackArchive::remap(QFile &file, uchar *&map, qint64 &mapSize, qint64 needed) const
+{
+  if(needed <= mapSize)
+    return map != nullptr;
+  if(map)
+    file.unmap(map);
+  // Map the whole file, it has usually grown by more than what is needed.
+  mapSize = file.size();
+  map = mapSize > 0 ? file.map(0, mapSize) : nullptr;
+  if(!map)
+    mapSize = 0;
+  return map != nullptr && needed <= mapSize;
+}
+
+TrackArchive::Record const *TrackArchive::records() const
+{
+  if(m_chunks.empty())
+    return nullptr;
+  qint64 needed = (m_chunks.back().firstRecord+m_chunks.back().recordCount)*sizeof(Record);
+  if(!remap(m_pointsFile, m_pointsMap, m_pointsMapSize, needed))
+    return nullptr;
+  return reinterpret_cast<Record const*>(m_pointsMap);
+}
+
+uint32_t const *TrackArchive::lodIndices() const
+{
+  if(m_lodIndexCount == 0)
+    return nullptr;
+  if(!remap(m_lodFile, m_lodMap, m_lodMapSize, m_lodIndexCount*sizeof(uint32_t)))
+    return nullptr;
+  return reinterpret_cast<uint32_t const*>(m_lodMap);
+}
+
+std::size_t TrackArchive::chunkCount() const
+{
+  return m_chunks.size() + (m_open.empty() ? 0 : 1);
+}
+
+bool TrackArchive::sealed(std::size_t chunk) const
+{
+  return chunk < m_chunks.size();
+}
+
+std::vector<std::size_t> TrackArchive::visibleChunks(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude) const
+{
+  std::vector<std::size_t> ret;
+  for(std::size_t i = 0; i < m_chunks.size(); i++)
+  {
+    Chunk const &c = m_chunks[i];
+    if(c.maxLatitude >= minLatitude && c.minLatitude <= maxLatitude && c.maxLongitude >= minLongitude && c.minLongitude <= maxLongitude)
+      ret.push_back(i);
+  }
+  if(!m_open.empty())
+  {
+    Chunk c;
+    c.minLatitude = c.maxLatitude = m_open.front().latitude;
+    c.minLongitude = c.maxLongitude = m_open.front().longitude;
+    for(auto const &r: m_open)
+      extend(c, r);
+    if(c.maxLatitude >= minLatitude && c.minLatitude <= maxLatitude && c.maxLongitude >= minLongitude && c.minLongitude <= maxLongitude)
+      ret.push_back(m_chunks.size());
+  }
+  return ret;
+}
+
+std::vector<GeoPoint> TrackArchive::points(std::size_t chunk, int level) const
+{
+  std::vector<GeoPoint> ret;
+  level = std::max(0, std::min(LevelCount-1, level));
+
+  if(chunk < m_chunks.size())
+  {
+    Record const *r = records();
+    if(!r)
+      return ret;
+    Chunk const &c = m_chunks[chunk];
+    if(chunk > 0 && m_chunks[chunk-1].session == c.session)
+      ret.push_back(GeoPoint(r[c.firstRecord-1].latitude, r[c.firstRecord-1].longitude));
+    if(level == 0)
+    {
+      for(uint64_t i = 0; i < c.recordCount; i++)
+        ret.push_back(GeoPoint(r[c.firstRecord+i].latitude, r[c.firstRecord+i].longitude));
+    }
+    else
+    {
+      uint32_t const *indices = lodIndices();
+      if(!indices)
+        return ret;
+      for(uint64_t i = 0; i < c.lodCount[level]; i++)
+      {
+        Record const &p = r[c.firstRecord+indices[c.lodOffset[level]+i]];
+        ret.push_back(GeoPoint(p.latitude, p.longitude));
+      }
+    }
+  }
+  else if(chunk == m_chunks.size() && !m_open.empty())
+  {
+    // The chunk being filled is not simplified, it covers at most
+    // chunkDuration seconds.
+    if(!m_chunks.empty() && m_chunks.back().session == m_session)
+    {
+      Record const *r = records();
+      if(r)
+      {
+        Record const &p = r[m_chunks.back().firstRecord+m_chunks.back().recordCount-1];
+        ret.push_back(GeoPoint(p.latitude, p.longitude));
+      }
+    }
+    for(auto const &p: m_open)
+      ret.push_back(GeoPoint(p.latitude, p.longitude));
+  }
+  return ret;
+}
+
+bool TrackArchive::bounds(double &minLatitude, double &minLongitude, double &maxLatitude, double &maxLongitude) const
+{
+  if(m_chunks.empty() && m_open.empty())
+    return false;
+  Chunk all;
+  if(!m_chunks.empty())
+  {
+    all = m_chunks.front();
+    for(auto const &c: m_chunks)
+    {
+      all.minLatitude = std::min(all.minLatitude, c.minLatitude);
+      all.maxLatitude = std::max(all.maxLatitude, c.maxLatitude);
+      all.minLongitude = std::min(all.minLongitude, c.minLongitude);
+      all.maxLongitude = std::max(all.maxLongitude, c.maxLongitude);
+    }
+  }
+  else
+  {
+    all.minLatitude = all.maxLatitude = m_open.front().latitude;
+    all.minLongitude = all.maxLongitude = m_open.front().longitude;
+  }
+  for(auto const &r: m_open)
+    extend(all, r);
+  minLatitude = all.minLatitude;
+  minLongitude = all.minLongitude;
+  maxLatitude = all.maxLatitude;
+  maxLongitude = all.maxLongitude;
+  return true;
+}
@@ -0,0 +1,128 @@
+#ifndef CAMP_TRACK_ARCHIVE_H
+#define CAMP_TRACK_ARCHIVE_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <QFile>
+#include <QString>
+#include "geopoint.h"
+
+// On disk position track for one stream, meant to hold days of data.
+// Samples are appended to <base>.pts as fixed size records and grouped into
+// chunks covering chunkDuration seconds. When a chunk is complete, its
+// bounds and simplified polylines for each level of detail are written to
+// <base>.idx, after a header identifying the format, and <base>.lod. Sealed chunks are read back through memory
+// mapped files, so only the chunks and levels being drawn are paged in.
+// Only the chunk still being filled is kept in memory. Its samples are
+// written out by flush(), and when it is sealed.
+class TrackArchive
+{
+public:
+  // Simplification tolerance in meters for levels 1 to LevelCount-1.
+  // Level 0 is the full resolution track.
+  static const int LevelCount = 6;
+  static double levelTolerance(int level);
+
+  explicit TrackArchive(double chunkDuration = 600.0);
+  ~TrackArchive();
+
+  // Opens, or creates, the archive files starting with basePath. Samples
+  // left unsealed by the previous session are sealed as a chunk of their
+  // own. Chunks that ended before oldestTime are dropped from the files.
+  // Files written in another format are started over.
+  bool open(QString const &basePath, double oldestTime = 0.0);
+  void close();
+  bool isOpen() const;
+
+  // Returns true if the sample completed a chunk, which was sealed.
+  bool append(double time, GeoPoint const &location);
+  // Writes samples appended since the last flush to disk.
+  void flush();
+
+  // Number of chunks, including the one being filled if it has samples.
+  std::size_t chunkCount() const;
+  bool sealed(std::size_t chunk) const;
+
+  // Chunks overlapping the given latitude/longitude box.
+  std::vector<std::size_t> visibleChunks(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude) const;
+
+  // Coarsest level whose tolerance does not exceed resolution, in meters.
+  static int levelFor(double resolution);
+
+  // Polyline of a chunk at a level of detail. It starts at the last sample
+  // of the previous chunk if both were recorded in the same session, so
+  // consecutive chunks join up without bridging gaps between sessions.
+  std::vector<GeoPoint> points(std::size_t chunk, int level) const;
+
+  // Bounds of everything archived, false if empty.
+  bool bounds(double &minLatitude, double &minLongitude, double &maxLatitude, double &maxLongitude) const;
+
+private:
+  struct Record
+  {
+    double time;
+    double latitude;
+    double longitude;
+  };
+
+  // Start of <base>.idx, the chunks follow.
+  struct IndexHeader
+  {
+    char magic[4];
+    uint32_t version;
+    // sessions that opened the archive, the last one's number
+    uint64_t sessions;
+  };
+
+  struct Chunk
+  {
+    // number of the session that recorded it
+    uint64_t session;
+    double startTime;
+    double endTime;
+    double minLatitude;
+    double minLongitude;
+    double maxLatitude;
+    double maxLongitude;
+    uint64_t firstRecord;
+    uint64_t recordCount;
+    // offset, in indices, into the .lod file and index count of levels 1 and up.
+    uint64_t lodOffset[LevelCount];
+    uint64_t lodCount[LevelCount];
+  };
+
+  void seal();
+  bool writeHeader();
+  // Drops the chunks that ended before oldestTime.
+  void dropOldChunks(double oldestTime);
+  // Moves a file's contents after the first bytes to its start.
+  static bool dropFront(QFile &file, qint64 bytes);
+  Record const *records() const;
+  uint32_t const *lodIndices() const;
+  bool remap(QFile &file, uchar *&map, qint64 &mapSize, qint64 needed) const;
+  static void extend(Chunk &chunk, Record const &record);
+
+  double m_chunkDuration;
+
+  mutable QFile m_pointsFile;
+  mutable QFile m_lodFile;
+  QFile m_indexFile;
+
+  mutable uchar *m_pointsMap = nullptr;
+  mutable qint64 m_pointsMapSize = 0;
+  mutable uchar *m_lodMap = nullptr;
+  mutable qint64 m_lodMapSize = 0;
+
+  // Chunk descriptors are small, a day at the default duration is 144 of them.
+  std::vector<Chunk> m_chunks;
+
+  std::vector<Record> m_open;
+  // samples at the end of m_open not written yet
+  std::size_t m_unwritten = 0;
+  uint64_t m_recordCount = 0;
+  uint64_t m_lodIndexCount = 0;
+  uint64_t m_session = 0;
+};
+
+#endif
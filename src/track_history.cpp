@@ -0,0 +1,69 @@
+#include "track_history.h"
+#include "gz4d_geo.h"
+
+TrackHistory::TrackHistory(std::size_t capacity, double minDistance, double maxInterval):m_points(capacity),m_minDistance(minDistance),m_maxInterval(maxInterval)
+{
+}
+
+bool TrackHistory::add(GeoPoint const &location, QPointF const &pos, double time)
+{
+  Entry entry;
+  entry.location.location = location;
+  entry.location.pos = pos;
+  entry.time = time;
+
+  if(m_points.empty())
+  {
+    m_points.push_back(entry);
+    m_provisional = false;
+    return true;
+  }
+
+  Entry const &kept = (m_provisional && m_points.size() > 1) ? m_points[m_points.size()-2] : m_points.back();
+
+  bool keep = m_minDistance <= 0.0 && m_maxInterval <= 0.0;
+  if(!keep && m_maxInterval > 0.0 && time - kept.time >= m_maxInterval)
+    keep = true;
+  if(!keep && m_minDistance > 0.0)
+  {
+    double latitude = location.latitude();
+    double longitude = location.longitude();
+    double east, north;
+    gz4d::LocalTangent(kept.location.location.latitude(), kept.location.location.longitude()).toLocal(&latitude, &longitude, &east, &north, 1);
+    keep = east*east+north*north >= m_minDistance*m_minDistance;
+  }
+
+  bool added = !m_provisional;
+  if(m_provisional)
+    m_points.back() = entry;
+  else
+    m_points.push_back(entry);
+  m_provisional = !keep;
+  return added;
+}
+
+QPolygonF TrackHistory::positions() const
+{
+  QPolygonF ret;
+  ret.reserve(m_points.size());
+  for(std::size_t i = 0; i < m_points.size(); i++)
+    ret << m_points[i].location.pos;
+  return ret;
+}
+
+void TrackHistory::setCapacity(std::size_t capacity)
+{
+  m_points.setCapacity(capacity);
+}
+
+void TrackHistory::setDecimation(double minDistance, double maxInterval)
+{
+  m_minDistance = minDistance;
+  m_maxInterval = maxInterval;
+}
+
+void TrackHistory::clear()
+{
+  m_points.clear();
+  m_provisional = false;
+}
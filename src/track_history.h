@@ -0,0 +1,118 @@
+#ifndef CAMP_TRACK_HISTORY_H
+#define CAMP_TRACK_HISTORY_H
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <QPolygonF>
+#include "locationposition.h"
+
+// Fixed capacity buffer. Once full, each push overwrites the oldest element.
+// Index 0 is the oldest element.
+template<typename T> class RingBuffer
+{
+public:
+  explicit RingBuffer(std::size_t capacity = 0):m_data(capacity)
+  {
+  }
+
+  std::size_t capacity() const {return m_data.size();}
+  std::size_t size() const {return m_size;}
+  bool empty() const {return m_size == 0;}
+
+  T& operator[](std::size_t i) {return m_data[(m_start+i)%m_data.size()];}
+  T const& operator[](std::size_t i) const {return m_data[(m_start+i)%m_data.size()];}
+
+  T& front() {return (*this)[0];}
+  T const& front() const {return (*this)[0];}
+  T& back() {return (*this)[m_size-1];}
+  T const& back() const {return (*this)[m_size-1];}
+
+  void push_back(T const &value)
+  {
+    if(m_data.empty())
+      return;
+    if(m_size < m_data.size())
+    {
+      (*this)[m_size] = value;
+      m_size++;
+    }
+    else
+    {
+      m_data[m_start] = value;
+      m_start = (m_start+1)%m_data.size();
+    }
+  }
+
+  void clear()
+  {
+    m_start = 0;
+    m_size = 0;
+  }
+
+  // Changes the capacity, keeping the newest elements.
+  void setCapacity(std::size_t capacity)
+  {
+    std::vector<T> data(capacity);
+    std::size_t keep = std::min(capacity, m_size);
+    for(std::size_t i = 0; i < keep; i++)
+      data[i] = (*this)[m_size-keep+i];
+    m_data.swap(data);
+    m_start = 0;
+    m_size = keep;
+  }
+
+private:
+  std::vector<T> m_data;
+  std::size_t m_start = 0;
+  std::size_t m_size = 0;
+};
+
+// Vehicle track kept in a fixed size ring. A new sample is only kept as a
+// separate point once it is at least minDistance meters or maxInterval
+// seconds from the previous kept point. Until then it replaces the newest
+// point, so the track still ends at the latest position.
+class TrackHistory
+{
+public:
+  TrackHistory(std::size_t capacity, double minDistance = 0.0, double maxInterval = 0.0);
+
+  // Returns true if the sample was kept as a new point, false if it only
+  // moved the newest one.
+  bool add(GeoPoint const &location, QPointF const &pos, double time);
+
+  std::size_t size() const {return m_points.size();}
+  bool empty() const {return m_points.empty();}
+  LocationPosition const &operator[](std::size_t i) const {return m_points[i].location;}
+  LocationPosition const &back() const {return m_points.back().location;}
+
+  // Local positions, oldest first.
+  QPolygonF positions() const;
+
+  void setCapacity(std::size_t capacity);
+  void setDecimation(double minDistance, double maxInterval);
+  void clear();
+
+  // Recomputes the local positions, f maps a GeoPoint to a QPointF.
+  template<typename F> void reproject(F f)
+  {
+    for(std::size_t i = 0; i < m_points.size(); i++)
+      m_points[i].location.pos = f(m_points[i].location.location);
+  }
+
+private:
+  struct Entry
+  {
+    LocationPosition location;
+    double time;
+  };
+
+  RingBuffer<Entry> m_points;
+  double m_minDistance;
+  double m_maxInterval;
+
+  // true when the newest point has not yet passed decimation.
+  bool m_provisional = false;
+};
+
+#endif
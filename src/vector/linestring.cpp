@@ -47,15 +47,7 @@ void LineString::paint(QPainter* painter, const QStyleOptionGraphicsItem* option
         p.setWidth(3);
         painter->setPen(p);
 
-        auto first = m_points.begin();
-        auto second = first;
-        second++;
-        while(second != m_points.end())
-        {
-            painter->drawLine(first->pos,second->pos);
-            first++;
-            second++;
-        }
+        painter->drawPolyline(m_line.simplified(mapScale()));
 
         painter->restore();
 
@@ -67,14 +59,8 @@ QPainterPath LineString::shape() const
 {
     if (m_points.length() > 1)
     {
-        auto i = m_points.begin();
-        QPainterPath ret(i->pos);
-        i++;
-        while(i != m_points.end())
-        {
-            ret.lineTo(i->pos);
-            i++;
-        }
+        QPainterPath ret;
+        ret.addPolygon(m_line.simplified(mapScale()));
         QPainterPathStroker pps;
         pps.setWidth(5);
         return pps.createStroke(ret);
@@ -100,14 +86,27 @@ void LineString::addPoint(const QGeoCoordinate &location)
 
 void LineString::updateBBox()
 {
+    QPolygonF line;
     if(m_points.length() >0)
     {
         m_bbox = QRectF(m_points[0].pos,QSizeF());
         for(auto p:m_points)
+        {
             m_bbox = m_bbox.united(QRectF(p.pos,QSizeF()));
+            line << p.pos;
+        }
     }
     else
         m_bbox = QRectF();
+    m_line.setPoints(line);
+}
+
+qreal LineString::mapScale() const
+{
+    AutonomousVehicleProject *avp = autonomousVehicleProject();
+    if(avp)
+        return avp->mapScale();
+    return 0.0;
 }
 
 bool LineString::canBeSentToRobot() const
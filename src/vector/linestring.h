@@ -3,6 +3,7 @@
 
 #include "../geographicsmissionitem.h"
 #include "../locationposition.h"
+#include "../polyline_simplify.h"
 
 class LineString : public GeoGraphicsMissionItem
 {
@@ -33,8 +34,10 @@ public slots:
 private:
     QList<LocationPosition> m_points;
     QRectF m_bbox;
+    SimplifiedPolyline m_line;
     
     void updateBBox();
+    qreal mapScale() const;
     
 };
 
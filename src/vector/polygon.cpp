@@ -20,11 +20,12 @@ void Polygon::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, Q
     p.setCosmetic(true);
     p.setWidth(2);
     painter->setPen(p);
+    qreal scale = mapScale();
     if(m_exteriorRing.length() > 1)
-        painter->drawPolygon(m_exteriorPolygon);
+        painter->drawPolygon(m_exteriorPolygon.simplified(scale));
     
-    for(auto ip:m_interiorPolygons)
-        painter->drawPolygon(ip);
+    for(auto const &ip:m_interiorPolygons)
+        painter->drawPolygon(ip.simplified(scale));
         
     painter->restore();
 }
@@ -71,14 +72,8 @@ QPainterPath Polygon::shape() const
     
     if (m_exteriorRing.length() > 1)
     {
-        auto i = m_exteriorRing.begin();
-        QPainterPath ret(i->pos);
-        i++;
-        while(i != m_exteriorRing.end())
-        {
-            ret.lineTo(i->pos);
-            i++;
-        }
+        QPainterPath ret;
+        ret.addPolygon(m_exteriorPolygon.simplified(mapScale()));
         QPainterPathStroker pps;
         pps.setWidth(5);
         return pps.createStroke(ret);
@@ -99,18 +94,19 @@ void Polygon::updateProjectedPoints()
 
 void Polygon::updateBBox()
 {
+    QPolygonF exterior;
     if(m_exteriorRing.length() >0)
     {
-        m_exteriorPolygon.clear();
         m_bbox = QRectF(m_exteriorRing[0].pos,QSizeF());
         for(auto p:m_exteriorRing)
         {
             m_bbox = m_bbox.united(QRectF(p.pos,QSizeF()));
-            m_exteriorPolygon << p.pos;
+            exterior << p.pos;
         }
     }
     else
         m_bbox = QRectF();
+    m_exteriorPolygon.setPoints(exterior);
     m_interiorPolygons.clear();
     for(auto ip: m_interiorRings)
         if(ip.length() > 1)
@@ -118,10 +114,19 @@ void Polygon::updateBBox()
             QPolygonF pf;
             for(auto p: ip)
                 pf << p.pos;
-            m_interiorPolygons.append(pf);
+            m_interiorPolygons.append(SimplifiedPolyline());
+            m_interiorPolygons.last().setPoints(pf);
         }
 }
 
+qreal Polygon::mapScale() const
+{
+    AutonomousVehicleProject *avp = autonomousVehicleProject();
+    if(avp)
+        return avp->mapScale();
+    return 0.0;
+}
+
 void Polygon::addExteriorPoint(const QGeoCoordinate& location)
 {
     LocationPosition lp;
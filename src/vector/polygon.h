@@ -3,6 +3,7 @@
 
 #include "../geographicsmissionitem.h"
 #include "../locationposition.h"
+#include "../polyline_simplify.h"
 
 class Polygon : public GeoGraphicsMissionItem
 {
@@ -33,10 +34,12 @@ public slots:
 
 private:
     QList<LocationPosition> m_exteriorRing;
-    QPolygonF m_exteriorPolygon;
+    SimplifiedPolyline m_exteriorPolygon;
     QList<QList<LocationPosition> > m_interiorRings;
-    QList<QPolygonF> m_interiorPolygons;
+    QList<SimplifiedPolyline> m_interiorPolygons;
     QRectF m_bbox;
+
+    qreal mapScale() const;
     
     
 };
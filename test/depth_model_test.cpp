@@ -0,0 +1,154 @@
+#include "depth_model.h"
+#include <gtest/gtest.h>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace
+{
+  // One pixel per meter, with the map frame origin in the middle of the
+  // raster.
+  const QSize rasterSize(512, 512);
+  const QTransform mapToPixel(1.0, 0.0, 0.0, -1.0, 256.0, 256.0);
+
+  // The cell 56 meters north of the origin.
+  const int cellX = 256;
+  const int cellY = 200;
+
+  DepthGrid::Batch batch(std::vector<double> east, std::vector<double> north, std::vector<float> depth)
+  {
+    return DepthGrid::Batch{east, north, depth};
+  }
+
+  // Soundings at the center of the cell.
+  DepthGrid::Batch centered(int count, float depth)
+  {
+    return batch(std::vector<double>(count, 0.5), std::vector<double>(count, 55.5), std::vector<float>(count, depth));
+  }
+
+  // The model publishes from the event loop, which needs an application.
+  void ensureApplication()
+  {
+    static int argc = 1;
+    static char name[] = "depth_model_test";
+    static char *argv[] = {name, nullptr};
+    static QCoreApplication application(argc, argv);
+  }
+
+  // Runs events until done, false if a few seconds pass first.
+  bool waitFor(std::function<bool()> done)
+  {
+    QElapsedTimer timer;
+    timer.start();
+    while(!done())
+    {
+      if(timer.elapsed() > 5000)
+        return false;
+      QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+    return true;
+  }
+}
+
+TEST(DepthGrid, weightedMeanFavorsCenter)
+{
+  DepthGrid grid;
+  // One sounding at the center, weighing 1, one at a corner, weighing 2/3.
+  grid.add(batch({0.5, 0.0}, {55.5, 56.0}, {10.0f, 20.0f}), mapToPixel, rasterSize);
+  float depth;
+  ASSERT_TRUE(grid.depth(cellX, cellY, 2, depth));
+  EXPECT_NEAR(14.0f, depth, 1e-5);
+
+  // the order they arrive in doesn't matter
+  DepthGrid reversed;
+  reversed.add(batch({0.0, 0.5}, {56.0, 55.5}, {20.0f, 10.0f}), mapToPixel, rasterSize);
+  float reversedDepth;
+  ASSERT_TRUE(reversed.depth(cellX, cellY, 2, reversedDepth));
+  EXPECT_NEAR(depth, reversedDepth, 1e-5);
+}
+
+TEST(DepthGrid, needsMinimumSoundings)
+{
+  DepthGrid grid;
+  float depth;
+  EXPECT_FALSE(grid.depth(cellX, cellY, 1, depth));
+  for(int count = 1; count <= 3; count++)
+  {
+    grid.add(centered(1, 12.0f), mapToPixel, rasterSize);
+    EXPECT_EQ(count >= 3, grid.depth(cellX, cellY, 3, depth)) << count << " soundings";
+  }
+  EXPECT_FLOAT_EQ(12.0f, depth);
+  EXPECT_FALSE(grid.depth(cellX, cellY, 4, depth));
+  // neighbours are untouched
+  EXPECT_FALSE(grid.depth(cellX+1, cellY, 1, depth));
+}
+
+TEST(DepthGrid, ignoresSoundingsOutsideRaster)
+{
+  DepthGrid grid;
+  grid.add(batch({-300.0, 0.5, 0.5}, {55.5, 300.0, 55.5}, {10.0f, 10.0f, NAN}), mapToPixel, rasterSize);
+  EXPECT_EQ(0u, grid.tileCount());
+}
+
+TEST(DepthGrid, publishesChangedTiles)
+{
+  DepthGrid worker;
+  DepthGrid gui;
+  std::map<DepthGrid::TileKey, DepthGrid::Tile> changes;
+  worker.add(centered(3, 8.0f), mapToPixel, rasterSize);
+  worker.takeChanges(changes);
+  ASSERT_EQ(1u, changes.size());
+  QRect pixels = gui.apply(changes);
+  EXPECT_TRUE(pixels.contains(cellX, cellY));
+  EXPECT_EQ(QRect(cellX/DepthGrid::TileSize*DepthGrid::TileSize, cellY/DepthGrid::TileSize*DepthGrid::TileSize, DepthGrid::TileSize, DepthGrid::TileSize), gui.bounds());
+  float depth;
+  ASSERT_TRUE(gui.depth(cellX, cellY, 3, depth));
+  EXPECT_FLOAT_EQ(8.0f, depth);
+
+  // nothing new, nothing taken
+  changes.clear();
+  worker.takeChanges(changes);
+  EXPECT_TRUE(changes.empty());
+
+  worker.clear();
+  EXPECT_EQ(0u, worker.tileCount());
+  EXPECT_TRUE(worker.bounds().isNull());
+}
+
+TEST(DepthModel, mappingChangeDropsSoundings)
+{
+  ensureApplication();
+  DepthModel model;
+  QRect changed;
+  QObject::connect(&model, &DepthModel::depthChanged, [&](QRect const &pixels){changed |= pixels;});
+  model.setMapToPixel(mapToPixel, rasterSize);
+  model.addSoundings({0.5, 0.5, 0.5}, {55.5, 55.5, 55.5}, {10.0f, 10.0f, 10.0f});
+  float depth;
+  ASSERT_TRUE(waitFor([&]{return model.depth(cellX, cellY, depth);}));
+  EXPECT_FLOAT_EQ(10.0f, depth);
+  EXPECT_TRUE(changed.contains(cellX, cellY));
+
+  // The raster moved 100 meters east, what was gridded is gone.
+  changed = QRect();
+  QTransform moved(1.0, 0.0, 0.0, -1.0, 156.0, 256.0);
+  model.setMapToPixel(moved, rasterSize);
+  EXPECT_TRUE(changed.contains(cellX, cellY));
+  EXPECT_FALSE(model.depth(cellX, cellY, depth));
+  EXPECT_TRUE(model.bounds().isNull());
+
+  // The same soundings now land elsewhere, the old cell stays empty.
+  model.addSoundings({0.5, 0.5, 0.5}, {55.5, 55.5, 55.5}, {12.0f, 12.0f, 12.0f});
+  ASSERT_TRUE(waitFor([&]{return model.depth(cellX-100, cellY, depth);}));
+  EXPECT_FLOAT_EQ(12.0f, depth);
+  EXPECT_FALSE(model.depth(cellX, cellY, depth));
+
+  // Lowering the minimum reports cells with fewer soundings.
+  model.addSoundings({-99.5}, {55.5}, {5.0f});
+  ASSERT_TRUE(waitFor([&]{return model.bounds().contains(cellX-200, cellY);}));
+  EXPECT_FALSE(model.depth(cellX-200, cellY, depth));
+  model.setMinimumSoundings(1);
+  ASSERT_TRUE(model.depth(cellX-200, cellY, depth));
+  EXPECT_FLOAT_EQ(5.0f, depth);
+}
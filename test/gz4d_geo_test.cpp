@@ -0,0 +1,263 @@
+#include "gz4d_geo.h"
+#include <gtest/gtest.h>
+#include <QGeoCoordinate>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+  // Flinders Peak to Buninyong, the worked example from Vincenty's paper.
+  const double flindersLatitude = -(37.0+57.0/60.0+3.72030/3600.0);
+  const double flindersLongitude = 144.0+25.0/60.0+29.52440/3600.0;
+  const double buninyongLatitude = -(37.0+39.0/60.0+10.15610/3600.0);
+  const double buninyongLongitude = 143.0+55.0/60.0+35.38390/3600.0;
+  const double flindersAzimuth = 306.0+52.0/60.0+5.37/3600.0;
+  const double flindersDistance = 54972.271;
+
+  // Near Portsmouth, NH.
+  const double referenceLatitude = 43.07;
+  const double referenceLongitude = -70.71;
+
+  typedef std::chrono::steady_clock Clock;
+
+  double nanoseconds(Clock::time_point start, std::size_t count)
+  {
+    return std::chrono::duration<double, std::nano>(Clock::now()-start).count()/count;
+  }
+
+  void randomAzimuthsAndDistances(std::size_t count, double maxDistance, std::vector<double> &azimuths, std::vector<double> &distances)
+  {
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> azimuth(0.0, 360.0);
+    std::uniform_real_distribution<double> distance(0.0, maxDistance);
+    azimuths.resize(count);
+    distances.resize(count);
+    for(std::size_t i = 0; i < count; i++)
+    {
+      azimuths[i] = azimuth(generator);
+      distances[i] = distance(generator);
+    }
+  }
+}
+
+TEST(WGS84Ellipsoid, directMatchesVincentyExample)
+{
+  double latitude, longitude;
+  gz4d::WGS84Ellipsoid::direct(flindersLatitude, flindersLongitude, &flindersAzimuth, &flindersDistance, &latitude, &longitude, 1);
+  EXPECT_NEAR(buninyongLatitude, latitude, 1e-8);
+  EXPECT_NEAR(buninyongLongitude, longitude, 1e-8);
+}
+
+TEST(WGS84Ellipsoid, inverseMatchesVincentyExample)
+{
+  double azimuth, distance;
+  gz4d::WGS84Ellipsoid::inverse(&flindersLatitude, &flindersLongitude, &buninyongLatitude, &buninyongLongitude, &azimuth, &distance, 1);
+  EXPECT_NEAR(flindersAzimuth, azimuth, 1e-6);
+  EXPECT_NEAR(flindersDistance, distance, 1e-3);
+}
+
+// Hoisting the starting point's terms out of the loop mustn't change the
+// results, so a batch is compared with the same points solved one at a time.
+TEST(WGS84Ellipsoid, batchedDirectMatchesSingle)
+{
+  const std::size_t count = 1000;
+  std::vector<double> azimuths, distances;
+  randomAzimuthsAndDistances(count, 100000.0, azimuths, distances);
+  std::vector<double> latitudes(count), longitudes(count);
+  gz4d::WGS84Ellipsoid::direct(referenceLatitude, referenceLongitude, azimuths.data(), distances.data(), latitudes.data(), longitudes.data(), count);
+
+  std::vector<double> startLatitudes(count, referenceLatitude), startLongitudes(count, referenceLongitude);
+  std::vector<double> manyLatitudes(count), manyLongitudes(count);
+  gz4d::WGS84Ellipsoid::direct(startLatitudes.data(), startLongitudes.data(), azimuths.data(), distances.data(), manyLatitudes.data(), manyLongitudes.data(), count);
+
+  for(std::size_t i = 0; i < count; i++)
+  {
+    gz4d::GeoPointLatLong start(referenceLatitude, referenceLongitude, 0.0);
+    gz4d::GeoPointLatLong single = gz4d::WGS84Ellipsoid::direct(start, azimuths[i], distances[i]);
+    ASSERT_EQ(single[0], latitudes[i]);
+    ASSERT_EQ(single[1], longitudes[i]);
+    ASSERT_EQ(single[0], manyLatitudes[i]);
+    ASSERT_EQ(single[1], manyLongitudes[i]);
+  }
+}
+
+TEST(WGS84Ellipsoid, inverseUndoesDirect)
+{
+  const std::size_t count = 1000;
+  std::vector<double> azimuths, distances;
+  randomAzimuthsAndDistances(count, 100000.0, azimuths, distances);
+  std::vector<double> latitudes(count), longitudes(count);
+  gz4d::WGS84Ellipsoid::direct(referenceLatitude, referenceLongitude, azimuths.data(), distances.data(), latitudes.data(), longitudes.data(), count);
+
+  std::vector<double> startLatitudes(count, referenceLatitude), startLongitudes(count, referenceLongitude);
+  std::vector<double> inverseAzimuths(count), inverseDistances(count);
+  gz4d::WGS84Ellipsoid::inverse(startLatitudes.data(), startLongitudes.data(), latitudes.data(), longitudes.data(), inverseAzimuths.data(), inverseDistances.data(), count);
+  for(std::size_t i = 0; i < count; i++)
+  {
+    EXPECT_NEAR(distances[i], inverseDistances[i], 1e-4);
+    if(distances[i] > 1.0)
+      EXPECT_NEAR(0.0, std::remainder(azimuths[i]-inverseAzimuths[i], 360.0), 1e-6);
+  }
+}
+
+// LocalTangent promises under a meter of error within a couple of
+// kilometers of its reference point.
+TEST(LocalTangent, directNearEllipsoid)
+{
+  const std::size_t count = 1000;
+  std::vector<double> azimuths, distances;
+  randomAzimuthsAndDistances(count, 2000.0, azimuths, distances);
+  std::vector<double> latitudes(count), longitudes(count);
+  gz4d::WGS84Ellipsoid::direct(referenceLatitude, referenceLongitude, azimuths.data(), distances.data(), latitudes.data(), longitudes.data(), count);
+
+  gz4d::LocalTangent tangent(referenceLatitude, referenceLongitude);
+  std::vector<double> tangentLatitudes(count), tangentLongitudes(count);
+  tangent.direct(azimuths.data(), distances.data(), tangentLatitudes.data(), tangentLongitudes.data(), count);
+
+  std::vector<double> errors(count);
+  gz4d::WGS84Ellipsoid::inverse(latitudes.data(), longitudes.data(), tangentLatitudes.data(), tangentLongitudes.data(), azimuths.data(), errors.data(), count);
+  for(std::size_t i = 0; i < count; i++)
+    EXPECT_LT(errors[i], 1.0) << "distance " << distances[i];
+}
+
+TEST(LocalTangent, roundTrips)
+{
+  const std::size_t count = 1000;
+  std::vector<double> azimuths, distances;
+  randomAzimuthsAndDistances(count, 2000.0, azimuths, distances);
+  gz4d::LocalTangent tangent(referenceLatitude, referenceLongitude);
+
+  std::vector<double> latitudes(count), longitudes(count);
+  tangent.direct(azimuths.data(), distances.data(), latitudes.data(), longitudes.data(), count);
+  std::vector<double> inverseAzimuths(count), inverseDistances(count);
+  tangent.inverse(latitudes.data(), longitudes.data(), inverseAzimuths.data(), inverseDistances.data(), count);
+
+  std::vector<double> east(count), north(count);
+  tangent.toLocal(latitudes.data(), longitudes.data(), east.data(), north.data(), count);
+  std::vector<double> geodeticLatitudes(count), geodeticLongitudes(count);
+  tangent.toGeodetic(east.data(), north.data(), geodeticLatitudes.data(), geodeticLongitudes.data(), count);
+
+  for(std::size_t i = 0; i < count; i++)
+  {
+    EXPECT_NEAR(distances[i], inverseDistances[i], 1e-6);
+    if(distances[i] > 1.0)
+      EXPECT_NEAR(azimuths[i], inverseAzimuths[i], 1e-6);
+    EXPECT_NEAR(distances[i], std::sqrt(east[i]*east[i]+north[i]*north[i]), 1e-6);
+    EXPECT_NEAR(latitudes[i], geodeticLatitudes[i], 1e-12);
+    EXPECT_NEAR(longitudes[i], geodeticLongitudes[i], 1e-12);
+  }
+}
+
+TEST(LocalTangent, wrapsAntimeridian)
+{
+  gz4d::LocalTangent tangent(52.0, 179.999);
+  double latitude = 52.0;
+  double longitude = -179.999;
+  double east, north;
+  tangent.toLocal(&latitude, &longitude, &east, &north, 1);
+  EXPECT_GT(east, 100.0);
+  EXPECT_LT(east, 150.0);
+  EXPECT_NEAR(0.0, north, 1e-9);
+
+  double backLatitude, backLongitude;
+  tangent.toGeodetic(&east, &north, &backLatitude, &backLongitude, 1);
+  EXPECT_NEAR(longitude, backLongitude, 1e-9);
+
+  double azimuth = 90.0;
+  double distance = 500.0;
+  tangent.direct(&azimuth, &distance, &latitude, &longitude, 1);
+  EXPECT_LT(longitude, -179.99);
+  EXPECT_GE(longitude, -180.0);
+
+  tangent.inverse(&latitude, &longitude, &azimuth, &distance, 1);
+  EXPECT_NEAR(90.0, azimuth, 1e-6);
+  EXPECT_NEAR(500.0, distance, 1e-6);
+}
+
+// Not a pass/fail check, reports the time per point of QtPositioning's
+// spherical atDistanceAndAzimuth, the batched ellipsoidal solution and the
+// local tangent approximation, over a ship outline sized batch and a survey
+// sized one.
+TEST(Geodesic, directBenchmark)
+{
+  const std::size_t total = 200000;
+  const std::size_t batchSizes[] = {8, 1000};
+  for(std::size_t batch: batchSizes)
+  {
+    std::vector<double> azimuths, distances;
+    randomAzimuthsAndDistances(batch, 2000.0, azimuths, distances);
+    std::vector<double> latitudes(batch), longitudes(batch);
+    std::size_t rounds = total/batch;
+    QGeoCoordinate start(referenceLatitude, referenceLongitude);
+    gz4d::LocalTangent tangent(referenceLatitude, referenceLongitude);
+
+    double sum = 0.0;
+    Clock::time_point clock = Clock::now();
+    for(std::size_t r = 0; r < rounds; r++)
+      for(std::size_t i = 0; i < batch; i++)
+        sum += start.atDistanceAndAzimuth(distances[i], azimuths[i]).latitude();
+    double qt = nanoseconds(clock, rounds*batch);
+
+    clock = Clock::now();
+    for(std::size_t r = 0; r < rounds; r++)
+    {
+      gz4d::WGS84Ellipsoid::direct(referenceLatitude, referenceLongitude, azimuths.data(), distances.data(), latitudes.data(), longitudes.data(), batch);
+      sum += latitudes[r%batch];
+    }
+    double ellipsoid = nanoseconds(clock, rounds*batch);
+
+    clock = Clock::now();
+    for(std::size_t r = 0; r < rounds; r++)
+    {
+      gz4d::LocalTangent(referenceLatitude, referenceLongitude).direct(azimuths.data(), distances.data(), latitudes.data(), longitudes.data(), batch);
+      sum += latitudes[r%batch];
+    }
+    double local = nanoseconds(clock, rounds*batch);
+
+    EXPECT_TRUE(std::isfinite(sum));
+    std::cout << "direct, batches of " << batch << ": QGeoCoordinate " << qt << " ns, WGS84Ellipsoid " << ellipsoid << " ns, LocalTangent " << local << " ns per point" << std::endl;
+  }
+}
+
+TEST(Geodesic, inverseBenchmark)
+{
+  const std::size_t count = 1000;
+  const std::size_t rounds = 200;
+  std::vector<double> azimuths, distances;
+  randomAzimuthsAndDistances(count, 2000.0, azimuths, distances);
+  std::vector<double> latitudes(count), longitudes(count);
+  gz4d::WGS84Ellipsoid::direct(referenceLatitude, referenceLongitude, azimuths.data(), distances.data(), latitudes.data(), longitudes.data(), count);
+  std::vector<QGeoCoordinate> coordinates;
+  for(std::size_t i = 0; i < count; i++)
+    coordinates.push_back(QGeoCoordinate(latitudes[i], longitudes[i]));
+  std::vector<double> startLatitudes(count, referenceLatitude), startLongitudes(count, referenceLongitude);
+  QGeoCoordinate start(referenceLatitude, referenceLongitude);
+
+  double sum = 0.0;
+  Clock::time_point clock = Clock::now();
+  for(std::size_t r = 0; r < rounds; r++)
+    for(std::size_t i = 0; i < count; i++)
+      sum += start.distanceTo(coordinates[i])+start.azimuthTo(coordinates[i]);
+  double qt = nanoseconds(clock, rounds*count);
+
+  clock = Clock::now();
+  for(std::size_t r = 0; r < rounds; r++)
+  {
+    gz4d::WGS84Ellipsoid::inverse(startLatitudes.data(), startLongitudes.data(), latitudes.data(), longitudes.data(), azimuths.data(), distances.data(), count);
+    sum += distances[r%count];
+  }
+  double ellipsoid = nanoseconds(clock, rounds*count);
+
+  clock = Clock::now();
+  for(std::size_t r = 0; r < rounds; r++)
+  {
+    gz4d::LocalTangent(referenceLatitude, referenceLongitude).inverse(latitudes.data(), longitudes.data(), azimuths.data(), distances.data(), count);
+    sum += distances[r%count];
+  }
+  double local = nanoseconds(clock, rounds*count);
+
+  EXPECT_TRUE(std::isfinite(sum));
+  std::cout << "inverse: QGeoCoordinate " << qt << " ns, WGS84Ellipsoid " << ellipsoid << " ns, LocalTangent " << local << " ns per point" << std::endl;
+}
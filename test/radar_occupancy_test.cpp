@@ -0,0 +1,164 @@
+#include "radar_occupancy.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+  // One pixel per meter, with the radar in the middle of the raster.
+  const QSize rasterSize(512, 512);
+  const QTransform mapToPixel(1.0, 0.0, 0.0, -1.0, 256.0, 256.0);
+
+  // A single scanline due north, 200 meters long in 1 meter samples, with
+  // a return from 150 to 159 meters.
+  OccupancyEvidence::Sector northSector(uint8_t intensity = 15)
+  {
+    OccupancyEvidence::Sector ret;
+    ret.east = 0.0;
+    ret.north = 0.0;
+    ret.range = 200.0;
+    ret.samples = 200;
+    ret.bearings = {0.0f};
+    ret.intensities.assign(200, 0);
+    for(int i = 150; i < 160; i++)
+      ret.intensities[i] = intensity;
+    return ret;
+  }
+
+  // pixel of the sample at the given range north of the radar
+  const int hitX = 256;
+  int northY(int meters)
+  {
+    return 256-meters-1;
+  }
+}
+
+TEST(OccupancyEvidence, hitsSaturateAtLimit)
+{
+  OccupancyEvidence grid;
+  for(int i = 0; i < 100; i++)
+    grid.trace(northSector(), mapToPixel, rasterSize, 8);
+  EXPECT_FLOAT_EQ(OccupancyEvidence::evidenceLimit(), grid.evidence(hitX, northY(155)));
+  EXPECT_FLOAT_EQ(-OccupancyEvidence::evidenceLimit(), grid.evidence(hitX, northY(100)));
+  // within the blind range and beyond the scanline nothing is known
+  EXPECT_EQ(0.0f, grid.evidence(hitX, northY(20)));
+  EXPECT_EQ(0.0f, grid.evidence(hitX+1, northY(155)));
+}
+
+TEST(OccupancyEvidence, weakReturnsAreMisses)
+{
+  OccupancyEvidence grid;
+  grid.trace(northSector(7), mapToPixel, rasterSize, 8);
+  EXPECT_LT(grid.evidence(hitX, northY(155)), 0.0f);
+  grid.trace(northSector(7), mapToPixel, rasterSize, 7);
+  EXPECT_NEAR(0.45f, grid.evidence(hitX, northY(155)), 1e-5);
+}
+
+TEST(OccupancyEvidence, ignoresCellsOutsideRaster)
+{
+  OccupancyEvidence grid;
+  grid.trace(northSector(), mapToPixel, QSize(100, 512), 8);
+  EXPECT_EQ(0u, grid.tileCount());
+}
+
+TEST(OccupancyEvidence, decayRemovesPublishedTiles)
+{
+  OccupancyEvidence worker;
+  OccupancyEvidence gui;
+  for(int i = 0; i < 5; i++)
+    worker.trace(northSector(), mapToPixel, rasterSize, 8);
+  std::map<OccupancyEvidence::TileKey, OccupancyEvidence::Tile> changes;
+  worker.takeChanges(changes);
+  // tiles only crossed by misses cost nothing and aren't published
+  std::size_t tiles = changes.size();
+  ASSERT_GT(tiles, 0u);
+  ASSERT_LT(tiles, worker.tileCount());
+  gui.apply(changes);
+  EXPECT_EQ(tiles, gui.tileCount());
+
+  // a third of the evidence is left per decay time, ten of them leave
+  // nothing
+  std::size_t traced = worker.tileCount();
+  worker.decay(1.0, 10.0);
+  EXPECT_EQ(traced, worker.tileCount());
+  worker.decay(100.0, 10.0);
+  EXPECT_EQ(0u, worker.tileCount());
+
+  changes.clear();
+  worker.takeChanges(changes);
+  ASSERT_EQ(tiles, changes.size());
+  for(auto const &t: changes)
+    EXPECT_TRUE(t.second.empty());
+  QRect removed = gui.apply(changes);
+  EXPECT_EQ(0u, gui.tileCount());
+  EXPECT_TRUE(removed.contains(hitX, northY(155)));
+  EXPECT_EQ(0.0f, gui.cost(hitX, northY(155)));
+}
+
+TEST(OccupancyEvidence, decayDropsUnpublishedTilesQuietly)
+{
+  OccupancyEvidence grid;
+  grid.trace(northSector(), mapToPixel, rasterSize, 8);
+  grid.decay(100.0, 10.0);
+  EXPECT_EQ(0u, grid.tileCount());
+  std::map<OccupancyEvidence::TileKey, OccupancyEvidence::Tile> changes;
+  grid.takeChanges(changes);
+  EXPECT_TRUE(changes.empty());
+}
+
+TEST(OccupancyEvidence, publishedCostMatchesEvidence)
+{
+  OccupancyEvidence worker;
+  OccupancyEvidence gui;
+  std::map<OccupancyEvidence::TileKey, OccupancyEvidence::Tile> changes;
+  for(int i = 0; i < 3; i++)
+  {
+    worker.trace(northSector(), mapToPixel, rasterSize, 8);
+    worker.takeChanges(changes);
+    gui.apply(changes);
+    changes.clear();
+  }
+  for(int meters = 0; meters < 200; meters++)
+  {
+    float evidence = worker.evidence(hitX, northY(meters));
+    EXPECT_FLOAT_EQ(OccupancyEvidence::evidenceCost(evidence), gui.cost(hitX, northY(meters))) << meters << " meters";
+  }
+  EXPECT_GT(gui.cost(hitX, northY(155)), 0.8f);
+  EXPECT_EQ(0.0f, gui.cost(hitX, northY(100)));
+  EXPECT_EQ(0.0f, gui.cost(-1, -1));
+}
+
+TEST(OccupancyEvidence, evidenceCostRange)
+{
+  EXPECT_EQ(0.0f, OccupancyEvidence::evidenceCost(0.0f));
+  EXPECT_EQ(0.0f, OccupancyEvidence::evidenceCost(-OccupancyEvidence::evidenceLimit()));
+  float previous = 0.0f;
+  for(float evidence = 0.5f; evidence <= OccupancyEvidence::evidenceLimit(); evidence += 0.5f)
+  {
+    float cost = OccupancyEvidence::evidenceCost(evidence);
+    EXPECT_GT(cost, previous);
+    EXPECT_LT(cost, 1.0f);
+    previous = cost;
+  }
+}
+
+TEST(OccupancyEvidence, smallChangesAreNotRetaken)
+{
+  OccupancyEvidence grid;
+  for(int i = 0; i < 100; i++)
+    grid.trace(northSector(), mapToPixel, rasterSize, 8);
+  std::map<OccupancyEvidence::TileKey, OccupancyEvidence::Tile> changes;
+  grid.takeChanges(changes);
+  EXPECT_FALSE(changes.empty());
+
+  // saturated cells don't move, and a slight decay barely changes the cost
+  changes.clear();
+  grid.trace(northSector(), mapToPixel, rasterSize, 8);
+  grid.decay(0.1, 60.0);
+  grid.takeChanges(changes);
+  EXPECT_TRUE(changes.empty());
+
+  grid.decay(10.0, 10.0);
+  grid.takeChanges(changes);
+  EXPECT_FALSE(changes.empty());
+}
@@ -0,0 +1,82 @@
+#include "radar_scan_converter.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+  void expandScalar(uint8_t const *intensities, int count, uint8_t *spoke)
+  {
+    for(int i = 0; i < count; i++)
+      spoke[i] = intensities[i]*16;
+  }
+
+  std::vector<uint8_t> randomBytes(std::size_t count, unsigned seed)
+  {
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> distribution(0, 255);
+    std::vector<uint8_t> ret(count);
+    for(auto &b: ret)
+      b = distribution(generator);
+    return ret;
+  }
+}
+
+// Every length around the vector width, from every alignment, with the
+// high nibble set as often as not so the masking is exercised.
+TEST(RadarScanConverter, expandIntensitiesMatchesScalar)
+{
+  std::vector<uint8_t> intensities = randomBytes(256, 1);
+  for(int offset = 0; offset < 16; offset++)
+    for(int count = 0; count <= 100; count++)
+    {
+      std::vector<uint8_t> expected(128, 0xaa);
+      std::vector<uint8_t> spoke(128, 0xaa);
+      expandScalar(intensities.data()+offset, count, expected.data()+offset);
+      RadarScanConverter::expandIntensities(intensities.data()+offset, count, spoke.data()+offset);
+      ASSERT_EQ(expected, spoke) << "offset " << offset << " count " << count;
+    }
+}
+
+TEST(RadarScanConverter, expandIntensitiesAllValues)
+{
+  std::vector<uint8_t> intensities(256);
+  for(int i = 0; i < 256; i++)
+    intensities[i] = i;
+  std::vector<uint8_t> spoke(256);
+  RadarScanConverter::expandIntensities(intensities.data(), 256, spoke.data());
+  for(int i = 0; i < 256; i++)
+    EXPECT_EQ(uint8_t(i << 4), spoke[i]) << "intensity " << i;
+}
+
+// Not a pass/fail check, reports the time per spoke of both versions for a
+// full turn of 4096 spokes of 1024 samples.
+TEST(RadarScanConverter, expandIntensitiesBenchmark)
+{
+  const int spokeCount = 4096;
+  const int sampleCount = 1024;
+  const int turns = 20;
+  std::vector<uint8_t> intensities = randomBytes(std::size_t(spokeCount)*sampleCount, 2);
+  std::vector<uint8_t> spokes(intensities.size());
+
+  typedef std::chrono::steady_clock Clock;
+  auto time = [&](void (*expand)(uint8_t const *, int, uint8_t *))
+  {
+    Clock::time_point start = Clock::now();
+    for(int t = 0; t < turns; t++)
+      for(int s = 0; s < spokeCount; s++)
+        expand(intensities.data()+std::size_t(s)*sampleCount, sampleCount, spokes.data()+std::size_t(s)*sampleCount);
+    return std::chrono::duration<double, std::nano>(Clock::now()-start).count()/(double(turns)*spokeCount);
+  };
+
+  double scalar = time(expandScalar);
+  uint8_t check = spokes[spokes.size()/2];
+  double converter = time(RadarScanConverter::expandIntensities);
+  EXPECT_EQ(check, spokes[spokes.size()/2]);
+
+  std::cout << "expandIntensities, " << sampleCount << " samples: scalar " << scalar << " ns, converter " << converter << " ns per spoke" << std::endl;
+  RecordProperty("scalar_ns_per_spoke", int(scalar));
+  RecordProperty("converter_ns_per_spoke", int(converter));
+}
@@ -0,0 +1,227 @@
+#include "radar_targets.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+  const int binCount = 64;
+  const int stride = 32;
+  // meters, so each sample is 10 meters long
+  const double range = 320.0;
+
+  // A turn of empty spokes, all of full length.
+  struct Turn
+  {
+    std::vector<uint8_t> spokes = std::vector<uint8_t>(binCount*stride, 0);
+    std::vector<uint16_t> samples = std::vector<uint16_t>(binCount, stride);
+
+    void set(int bin, int first, int last, uint8_t intensity = 0xf0)
+    {
+      bin = (bin+binCount)%binCount;
+      for(int i = first; i <= last; i++)
+        spokes[bin*stride+i] = intensity;
+    }
+
+    std::vector<RadarBlob> extract(RadarTargetParameters const &parameters)
+    {
+      std::vector<RadarBlob> blobs;
+      extractor.extract(spokes.data(), stride, samples.data(), binCount, range, parameters, blobs);
+      return blobs;
+    }
+
+    RadarBlobExtractor extractor;
+  };
+
+  RadarTargetParameters parameters()
+  {
+    RadarTargetParameters ret;
+    ret.blind_range = 0.0;
+    return ret;
+  }
+
+  RadarBlob blobAt(double east, double north)
+  {
+    RadarBlob ret;
+    ret.position = QPointF(east, north);
+    ret.extent = 10.0;
+    ret.cells = 10;
+    return ret;
+  }
+}
+
+TEST(RadarBlobExtractor, joinsAcrossBinZero)
+{
+  Turn turn;
+  for(int bin: {-2, -1, 0, 1})
+    turn.set(bin, 10, 12);
+  std::vector<RadarBlob> blobs = turn.extract(parameters());
+  ASSERT_EQ(1u, blobs.size());
+  EXPECT_EQ(12, blobs[0].cells);
+  // symmetric about north
+  EXPECT_NEAR(0.0, blobs[0].position.x(), 1e-6);
+  EXPECT_NEAR(115.0, blobs[0].position.y(), 1.0);
+}
+
+TEST(RadarBlobExtractor, keepsSeparateBlobsApart)
+{
+  Turn turn;
+  turn.set(4, 5, 8);
+  turn.set(5, 5, 8);
+  turn.set(4, 20, 23);
+  turn.set(5, 20, 23);
+  turn.set(40, 5, 8);
+  turn.set(41, 5, 8);
+  EXPECT_EQ(3u, turn.extract(parameters()).size());
+}
+
+TEST(RadarBlobExtractor, ignoresReturnsBelowThreshold)
+{
+  Turn turn;
+  turn.set(10, 5, 8, 0x70);
+  turn.set(11, 5, 8, 0x70);
+  RadarTargetParameters p = parameters();
+  p.threshold = 8;
+  EXPECT_TRUE(turn.extract(p).empty());
+  p.threshold = 7;
+  EXPECT_EQ(1u, turn.extract(p).size());
+}
+
+TEST(RadarBlobExtractor, ignoresBlindRange)
+{
+  Turn turn;
+  turn.set(10, 2, 4);
+  turn.set(11, 2, 4);
+  RadarTargetParameters p = parameters();
+  p.blind_range = 50.0;
+  EXPECT_TRUE(turn.extract(p).empty());
+}
+
+TEST(RadarBlobExtractor, filtersSmallBlobs)
+{
+  Turn turn;
+  turn.set(10, 5, 6);
+  turn.set(11, 5, 5);
+  RadarTargetParameters p = parameters();
+  p.min_cells = 4;
+  EXPECT_TRUE(turn.extract(p).empty());
+  p.min_cells = 3;
+  EXPECT_EQ(1u, turn.extract(p).size());
+}
+
+TEST(RadarBlobExtractor, filtersLargeBlobs)
+{
+  // 200 meters along two spokes
+  Turn turn;
+  turn.set(10, 5, 24);
+  turn.set(11, 5, 24);
+  RadarTargetParameters p = parameters();
+  p.max_extent = 150.0;
+  EXPECT_TRUE(turn.extract(p).empty());
+  p.max_extent = 250.0;
+  std::vector<RadarBlob> blobs = turn.extract(p);
+  ASSERT_EQ(1u, blobs.size());
+  EXPECT_GT(blobs[0].extent, 150.0);
+}
+
+TEST(RadarTracker, confirmsAfterEnoughHits)
+{
+  RadarTargetParameters p = parameters();
+  p.confirm_hits = 3;
+  RadarTracker tracker;
+  for(int sweep = 0; sweep < 3; sweep++)
+  {
+    EXPECT_TRUE(tracker.confirmed(p).empty());
+    tracker.update(sweep*2.0, {blobAt(100.0+sweep, 200.0)}, p);
+  }
+  std::vector<RadarTarget> targets = tracker.confirmed(p);
+  ASSERT_EQ(1u, targets.size());
+  EXPECT_EQ(3, targets[0].hits);
+  // moving east at half a meter per second
+  EXPECT_GT(targets[0].velocity.x(), 0.0);
+  EXPECT_NEAR(0.0, targets[0].velocity.y(), 1e-9);
+}
+
+TEST(RadarTracker, startsNewTracksOutsideGate)
+{
+  RadarTargetParameters p = parameters();
+  p.gate = 50.0;
+  p.confirm_hits = 1;
+  RadarTracker tracker;
+  tracker.update(0.0, {blobAt(0.0, 0.0)}, p);
+  int id = tracker.confirmed(p).front().id;
+
+  tracker.update(1.0, {blobAt(40.0, 0.0)}, p);
+  std::vector<RadarTarget> targets = tracker.confirmed(p);
+  ASSERT_EQ(1u, targets.size());
+  EXPECT_EQ(id, targets[0].id);
+
+  // too far from the prediction, the old track coasts and a new one starts
+  tracker.update(2.0, {blobAt(40.0, 200.0)}, p);
+  targets = tracker.confirmed(p);
+  ASSERT_EQ(2u, targets.size());
+  EXPECT_EQ(id, targets[0].id);
+  EXPECT_EQ(1, targets[0].misses);
+  EXPECT_NE(id, targets[1].id);
+}
+
+TEST(RadarTracker, pairsNearestFirst)
+{
+  RadarTargetParameters p = parameters();
+  p.confirm_hits = 1;
+  RadarTracker tracker;
+  tracker.update(0.0, {blobAt(0.0, 0.0), blobAt(30.0, 0.0)}, p);
+  std::vector<RadarTarget> before = tracker.confirmed(p);
+  ASSERT_EQ(2u, before.size());
+
+  tracker.update(1.0, {blobAt(28.0, 0.0), blobAt(2.0, 0.0)}, p);
+  std::vector<RadarTarget> after = tracker.confirmed(p);
+  ASSERT_EQ(2u, after.size());
+  for(int i = 0; i < 2; i++)
+  {
+    EXPECT_EQ(before[i].id, after[i].id);
+    EXPECT_LT(std::abs(after[i].position.x()-before[i].position.x()), 2.0);
+  }
+}
+
+TEST(RadarTracker, dropsTentativeTracksAtFirstMiss)
+{
+  RadarTargetParameters p = parameters();
+  p.confirm_hits = 3;
+  RadarTracker tracker;
+  tracker.update(0.0, {blobAt(0.0, 0.0)}, p);
+  tracker.update(1.0, {blobAt(0.0, 0.0)}, p);
+  tracker.update(2.0, {}, p);
+  p.confirm_hits = 1;
+  EXPECT_TRUE(tracker.confirmed(p).empty());
+}
+
+TEST(RadarTracker, coastsConfirmedTracksForMaxMisses)
+{
+  RadarTargetParameters p = parameters();
+  p.confirm_hits = 2;
+  p.max_misses = 3;
+  RadarTracker tracker;
+  tracker.update(0.0, {blobAt(0.0, 0.0)}, p);
+  tracker.update(1.0, {blobAt(1.0, 0.0)}, p);
+  ASSERT_EQ(1u, tracker.confirmed(p).size());
+  for(int miss = 1; miss <= 3; miss++)
+  {
+    tracker.update(1.0+miss, {}, p);
+    std::vector<RadarTarget> targets = tracker.confirmed(p);
+    ASSERT_EQ(1u, targets.size());
+    EXPECT_EQ(miss, targets[0].misses);
+  }
+  tracker.update(5.0, {}, p);
+  EXPECT_TRUE(tracker.confirmed(p).empty());
+}
+
+TEST(RadarTracker, clearDropsEverything)
+{
+  RadarTargetParameters p = parameters();
+  p.confirm_hits = 1;
+  RadarTracker tracker;
+  tracker.update(0.0, {blobAt(0.0, 0.0)}, p);
+  tracker.clear();
+  EXPECT_TRUE(tracker.confirmed(p).empty());
+}
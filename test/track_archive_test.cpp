@@ -0,0 +1,189 @@
+#include "track_archive.h"
+#include <gtest/gtest.h>
+#include <QTemporaryDir>
+#include <vector>
+
+namespace
+{
+  const double chunkDuration = 60.0;
+
+  // Heading north at about a meter per second, one sample a second.
+  GeoPoint north(double time)
+  {
+    return GeoPoint(43.0+time*1e-5, -70.0);
+  }
+
+  // Somewhere else entirely, heading east.
+  GeoPoint east(double time)
+  {
+    return GeoPoint(44.0, -69.0+time*1e-5);
+  }
+
+  void appendNorth(TrackArchive &archive, int first, int last)
+  {
+    for(int t = first; t <= last; t++)
+      archive.append(t, north(t));
+  }
+
+  std::vector<GeoPoint> northPoints(int first, int last)
+  {
+    std::vector<GeoPoint> ret;
+    for(int t = first; t <= last; t++)
+      ret.push_back(north(t));
+    return ret;
+  }
+
+  class TrackArchiveTest: public ::testing::Test
+  {
+  protected:
+    void SetUp() override
+    {
+      ASSERT_TRUE(directory.isValid());
+      base = directory.path()+"/track";
+    }
+
+    QTemporaryDir directory;
+    QString base;
+  };
+}
+
+TEST_F(TrackArchiveTest, appendSealsChunks)
+{
+  TrackArchive archive(chunkDuration);
+  ASSERT_TRUE(archive.open(base));
+  int sealed = 0;
+  for(int t = 0; t < 300; t++)
+    if(archive.append(t, north(t)))
+      sealed++;
+  EXPECT_EQ(4, sealed);
+  ASSERT_EQ(5u, archive.chunkCount());
+  EXPECT_TRUE(archive.sealed(3));
+  EXPECT_FALSE(archive.sealed(4));
+
+  EXPECT_EQ(northPoints(0, 59), archive.points(0, 0));
+  // later chunks start at the previous one's last sample
+  EXPECT_EQ(northPoints(59, 119), archive.points(1, 0));
+  EXPECT_EQ(northPoints(239, 299), archive.points(4, 0));
+  // a straight line simplifies to its ends
+  std::vector<GeoPoint> simplified = archive.points(1, 3);
+  ASSERT_EQ(3u, simplified.size());
+  EXPECT_EQ(north(59), simplified[0]);
+  EXPECT_EQ(north(60), simplified[1]);
+  EXPECT_EQ(north(119), simplified[2]);
+
+  double minLatitude, minLongitude, maxLatitude, maxLongitude;
+  ASSERT_TRUE(archive.bounds(minLatitude, minLongitude, maxLatitude, maxLongitude));
+  EXPECT_DOUBLE_EQ(north(0).latitude(), minLatitude);
+  EXPECT_DOUBLE_EQ(north(299).latitude(), maxLatitude);
+  EXPECT_EQ(std::vector<std::size_t>({1, 2}), archive.visibleChunks(north(100).latitude(), -71.0, north(130).latitude(), -69.0));
+}
+
+TEST_F(TrackArchiveTest, reopenKeepsSamples)
+{
+  {
+    TrackArchive archive(chunkDuration);
+    ASSERT_TRUE(archive.open(base));
+    appendNorth(archive, 0, 149);
+  }
+  TrackArchive archive(chunkDuration);
+  ASSERT_TRUE(archive.open(base));
+  // the unsealed samples are sealed on their own
+  ASSERT_EQ(3u, archive.chunkCount());
+  EXPECT_TRUE(archive.sealed(2));
+  EXPECT_EQ(northPoints(0, 59), archive.points(0, 0));
+  EXPECT_EQ(northPoints(59, 119), archive.points(1, 0));
+  EXPECT_EQ(northPoints(119, 149), archive.points(2, 0));
+}
+
+TEST_F(TrackArchiveTest, sessionsAreNotJoined)
+{
+  {
+    TrackArchive archive(chunkDuration);
+    ASSERT_TRUE(archive.open(base));
+    appendNorth(archive, 0, 99);
+  }
+  TrackArchive archive(chunkDuration);
+  ASSERT_TRUE(archive.open(base));
+  ASSERT_EQ(2u, archive.chunkCount());
+
+  std::vector<GeoPoint> expected;
+  for(int t = 1000; t < 1070; t++)
+  {
+    archive.append(t, east(t));
+    expected.push_back(east(t));
+    if(t == 1000)
+    {
+      EXPECT_EQ(expected, archive.points(2, 0));
+    }
+  }
+  ASSERT_EQ(4u, archive.chunkCount());
+  expected.resize(60);
+  EXPECT_EQ(expected, archive.points(2, 0));
+  EXPECT_EQ(east(1000), archive.points(2, 3).front());
+  // within a session they still join
+  EXPECT_EQ(east(1059), archive.points(3, 0).front());
+}
+
+TEST_F(TrackArchiveTest, dropsOldChunks)
+{
+  {
+    TrackArchive archive(chunkDuration);
+    ASSERT_TRUE(archive.open(base));
+    appendNorth(archive, 0, 299);
+  }
+  {
+    TrackArchive archive(chunkDuration);
+    ASSERT_TRUE(archive.open(base, 130.0));
+    // the chunks ending at 59 and 119 are gone
+    ASSERT_EQ(3u, archive.chunkCount());
+    EXPECT_EQ(northPoints(120, 179), archive.points(0, 0));
+    EXPECT_EQ(northPoints(179, 239), archive.points(1, 0));
+    EXPECT_EQ(northPoints(239, 299), archive.points(2, 0));
+    std::vector<GeoPoint> simplified = archive.points(1, 3);
+    ASSERT_EQ(3u, simplified.size());
+    EXPECT_EQ(north(180), simplified[1]);
+    appendNorth(archive, 300, 310);
+  }
+  TrackArchive archive(chunkDuration);
+  ASSERT_TRUE(archive.open(base, 130.0));
+  ASSERT_EQ(4u, archive.chunkCount());
+  EXPECT_EQ(northPoints(120, 179), archive.points(0, 0));
+  EXPECT_EQ(northPoints(300, 310), archive.points(3, 0));
+}
+
+TEST_F(TrackArchiveTest, dropsEverythingOld)
+{
+  {
+    TrackArchive archive(chunkDuration);
+    ASSERT_TRUE(archive.open(base));
+    appendNorth(archive, 0, 299);
+  }
+  TrackArchive archive(chunkDuration);
+  ASSERT_TRUE(archive.open(base, 1000.0));
+  // the unsealed samples are kept, they are sealed after dropping
+  ASSERT_EQ(1u, archive.chunkCount());
+  EXPECT_EQ(northPoints(240, 299), archive.points(0, 0));
+}
+
+TEST_F(TrackArchiveTest, startsOverWithoutHeader)
+{
+  {
+    TrackArchive archive(chunkDuration);
+    ASSERT_TRUE(archive.open(base));
+    appendNorth(archive, 0, 149);
+  }
+  {
+    // an index as written before it had a header
+    QFile index(base+".idx");
+    ASSERT_TRUE(index.open(QFile::ReadWrite));
+    ASSERT_TRUE(index.resize(0));
+    std::vector<char> chunk(200, 1);
+    index.write(chunk.data(), chunk.size());
+  }
+  TrackArchive archive(chunkDuration);
+  ASSERT_TRUE(archive.open(base));
+  EXPECT_EQ(0u, archive.chunkCount());
+  appendNorth(archive, 500, 570);
+  ASSERT_EQ(2u, archive.chunkCount());
+  EXPECT_EQ(northPoints(500, 559), archive.points(0, 0));
+}